@@ -0,0 +1,440 @@
+/**
+ * @file Agenda.c
+ * @brief This file contains the agenda, the activity store together with the indexes built over it.
+ *
+ * The agenda is what the main loop and the headless simulator run: one tick announces everything due at the
+ * current minute, and agenda_next() tells the loop how long it may sleep. The events live in a timer wheel, so
+ * a tick only touches the events that are due and marking an activity as done cancels its reminders in O(1).
+ */
+
+#include "Agenda.h"
+#include "Stats.h"
+
+// Names of the built-in agenda, interned first by activity_names_init() so activity i of default_day has id i
+const char* const default_names[] = {
+    "Breakfast", "Morning walk", "House cleaning", "Lunch", "Afternoon nap", "Grocery shopping", "Cooking",
+    "Dinner", "Evening reading", "Get medicine"
+};
+
+// Activities of the built-in agenda
+const activity default_day[] = {
+    {0, {8, 50}, {9, 30}, 0},
+    {1, {9, 00},{10, 15}, 0},
+    {2, {10, 20},{10, 55}, 0},
+    {3, {11, 00},{12, 00}, 0},
+    {4, {13, 45},{15, 00}, 0},
+    {5, {15, 20}, {15, 45}, 0},
+    {6, {16, 15}, {17, 30}, 0},
+    {7, {17, 45},{18, 30}, 0},
+    {8, {19, 00},{21, 30}, 0},
+    {9, {21, 30},{21, 45}, 0}
+};
+const size_t default_day_count = sizeof(default_day) / sizeof(default_day[0]);
+
+
+/**
+ * @brief Orders expired events by minute, then starts before warnings, then by activity index
+ *
+ * @param[in] lhs Pointer to the first event
+ * @param[in] rhs Pointer to the second event
+ *
+ * @return Returns a negative, zero or positive value like strcmp()
+ */
+static int compare_due(const void* lhs, const void* rhs) {
+    const agenda_due* a = lhs;
+    const agenda_due* b = rhs;
+
+    return agenda_event_compare(a->minute, a->event, b->minute, b->event);
+}
+
+
+/**
+ * @brief Collects an expired event, called by the timer wheel
+ *
+ * @param[in,out] ctx Pointer to the agenda
+ * @param[in] id Id of the expired timer
+ * @param[in] data Event of the timer
+ * @param[in] expiry Minute the event was scheduled for
+ */
+static void collect_due(void* ctx, uint32_t id, uint32_t data, uint32_t expiry) {
+    agenda* ag = ctx;
+
+    (void)id;
+    ag->timers[data] = WHEEL_INVALID;
+    ag->due[ag->due_count++] = (agenda_due){ expiry, data };
+}
+
+
+/**
+ * @brief Cancels the reminders of an activity the user marked as done, called by the prompts
+ *
+ * @param[in,out] ctx Pointer to the agenda
+ * @param[in] a Pointer to the activity
+ */
+static void cancel_done(void* ctx, activity* a) {
+    agenda* ag = ctx;
+
+    if (a >= ag->store.items && a < ag->store.items + ag->store.count) {
+        agenda_cancel(ag, (size_t)(a - ag->store.items));
+    }
+}
+
+
+/**
+ * @brief Schedules the events of one activity that are at or after the given minute
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] i Index of the activity
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int schedule_activity(agenda* ag, size_t i, int minute) {
+    const activity* a = &ag->store.items[i];
+    int start = atime_minutes(&a->start_time);
+    int warning = atime_minutes(&a->end_time) - WARNING_MINUTES;
+
+    ag->timers[2 * i] = WHEEL_INVALID;
+    ag->timers[2 * i + 1] = WHEEL_INVALID;
+    if (a->done) {
+        return 0;
+    }
+    if (start >= minute
+        && (ag->timers[2 * i] = wheel_add(&ag->wheel, (uint32_t)start, (uint32_t)(2 * i))) == WHEEL_INVALID) {
+        return -1;
+    }
+    // Activities shorter than the warning time never get a warning
+    if (warning >= start && warning >= minute
+        && (ag->timers[2 * i + 1] = wheel_add(&ag->wheel, (uint32_t)warning, (uint32_t)(2 * i + 1))) == WHEEL_INVALID) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Schedules the events of every activity not done yet, from the given minute on
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int schedule_events(agenda* ag, int minute) {
+    wheel_clear(&ag->wheel, (uint32_t)minute);
+
+    for (size_t i = 0; i < ag->store.count; i++) {
+        if (schedule_activity(ag, i, minute)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Makes sure the per-activity arrays of the agenda have room for the given number of activities
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] n Number of activities
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int reserve_events(agenda* ag, size_t n) {
+    if (n <= ag->room && ag->timers) {
+        return 0;
+    }
+
+    size_t room = ag->room * 2 > n ? ag->room * 2 : (n ? n : 1);
+    size_t old_words = bitset_words(ag->room);
+    uint32_t* timers = realloc(ag->timers, 2 * room * sizeof(uint32_t));
+    if (!timers) {
+        return -1;
+    }
+    ag->timers = timers;
+    agenda_due* due = realloc(ag->due, 2 * room * sizeof(agenda_due));
+    if (!due) {
+        return -1;
+    }
+    ag->due = due;
+    uint64_t* removed = realloc(ag->removed.words, bitset_words(room) * sizeof(uint64_t));
+    if (!removed) {
+        return -1;
+    }
+    memset(removed + old_words, 0, (bitset_words(room) - old_words) * sizeof(uint64_t));
+    ag->removed = (bitset){ removed, room };
+    uint64_t* fixed = realloc(ag->fixed.words, bitset_words(room) * sizeof(uint64_t));
+    if (!fixed) {
+        return -1;
+    }
+    memset(fixed + old_words, 0, (bitset_words(room) - old_words) * sizeof(uint64_t));
+    ag->fixed = (bitset){ fixed, room };
+    ag->room = room;
+    return 0;
+}
+
+
+/**
+ * @brief Moves an agenda loaded from a compiled table over to the minute table and the timer wheel
+ *
+ * @param[in,out] ag Pointer to the agenda
+ *
+ * @return Returns 0 on success or if the agenda was not compiled, -1 if memory could not be allocated
+ */
+static int leave_table(agenda* ag) {
+    if (!ag->table) {
+        return 0;
+    }
+    if (store_index_minutes(&ag->store) || schedule_events(ag, (int)ag->wheel.now)) {
+        return -1;
+    }
+    ag->table = NULL;
+    return 0;
+}
+
+
+int agenda_init(agenda* ag, const activity* day, size_t n) {
+    memset(ag, 0, sizeof(*ag));
+    wheel_init(&ag->wheel, 0);
+    if (store_init(&ag->store, n)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (store_add(&ag->store, day[i].name, day[i].start_time, day[i].end_time) < 0) {
+            agenda_free(ag);
+            return -1;
+        }
+        ag->store.items[i].done = day[i].done;
+    }
+
+    if (reserve_events(ag, n) || store_index_minutes(&ag->store) || schedule_events(ag, 0)) {
+        agenda_free(ag);
+        return -1;
+    }
+    return 0;
+}
+
+
+int agenda_init_table(agenda* ag, const agenda_table* t) {
+    memset(ag, 0, sizeof(*ag));
+    wheel_init(&ag->wheel, 0);
+    if (store_init(&ag->store, t->count) || reserve_events(ag, t->count)) {
+        agenda_free(ag);
+        return -1;
+    }
+
+    for (size_t i = 0; i < t->count; i++) {
+        const agenda_table_item* item = &t->items[i];
+        uint32_t name = name_intern(item->name, strlen(item->name));
+        atime start = { item->start / 60, item->start % 60 };
+        atime end = { item->end / 60, item->end % 60 };
+        if (name == POOL_INVALID_ID || store_add(&ag->store, name, start, end) < 0) {
+            agenda_free(ag);
+            return -1;
+        }
+    }
+    ag->table = t;
+    return 0;
+}
+
+
+void agenda_free(agenda* ag) {
+    if (on_done.ctx == ag) {
+        on_done = (done_hook){ NULL, NULL };
+    }
+    wheel_free(&ag->wheel);
+    free(ag->timers);
+    free(ag->due);
+    free(ag->removed.words);
+    free(ag->fixed.words);
+    store_free(&ag->store);
+    ag->timers = NULL;
+    ag->due = NULL;
+    ag->removed = (bitset){ NULL, 0 };
+    ag->fixed = (bitset){ NULL, 0 };
+    ag->room = 0;
+}
+
+
+void agenda_seek(agenda* ag, int minute) {
+    if (ag->table) {
+        // The events are sorted by minute, so the ones that are over are a prefix
+        ag->cursor = 0;
+        while (ag->cursor < ag->table->event_count && ag->table->events[ag->cursor].minute < minute) {
+            ag->cursor++;
+        }
+        ag->wheel.now = (uint32_t)minute;
+        return;
+    }
+    // The timer pool already has room for every event, so this does not allocate
+    schedule_events(ag, minute);
+}
+
+
+size_t agenda_tick(agenda* ag, int minute) {
+    size_t fired = 0;
+
+    ag->due_count = 0;
+    if (ag->table) {
+        // The compiled events are already in the order they are announced
+        const agenda_table* t = ag->table;
+        while (ag->cursor < t->event_count && t->events[ag->cursor].minute <= minute) {
+            ag->due[ag->due_count++] = (agenda_due){ t->events[ag->cursor].minute, t->events[ag->cursor].event };
+            ag->cursor++;
+        }
+        // The wheel stays empty, it only keeps track of the first minute not processed for leave_table()
+        ag->wheel.now = (uint32_t)minute + 1;
+    }
+    else {
+        wheel_advance(&ag->wheel, (uint32_t)minute, collect_due, ag);
+        qsort(ag->due, ag->due_count, sizeof(agenda_due), compare_due);
+    }
+
+    // Simulated start of the current minute, the lag of an event is measured from the start of its own minute
+    int64_t minute_start = 0;
+    if (ag->due_count && time_info.local_time) {
+        minute_start = (int64_t)(time_info.current_time - time_info.local_time->tm_sec) * NSEC_PER_SEC;
+    }
+    int64_t sim_now = minute_start ? clock_now_ns(&agenda_clock) : 0;
+    int speed = agenda_clock.speed > 0 ? agenda_clock.speed : 1;
+
+    for (size_t k = 0; k < ag->due_count; k++) {
+        size_t i = ag->due[k].event / 2;
+        activity* a = &ag->store.items[i];
+
+        int left = atime_minutes(&a->end_time) - minute;
+
+        if (a->done || ((ag->due[k].event & 1) && left <= 0)) {
+            continue;
+        }
+        if (ag->due[k].event & 1) {
+            announce_warning(a, left);
+        }
+        else {
+            announce_start(a);
+        }
+        fired++;
+
+        // Count the events a stall made late
+        uint32_t late = (uint32_t)minute - ag->due[k].minute;
+        if (minute_start) {
+            int64_t lag = (sim_now - minute_start + (int64_t)late * 60 * NSEC_PER_SEC) / speed;
+            stats_add((ag->due[k].event & 1) ? STATS_LAG_WARNING : STATS_LAG_START, lag);
+        }
+        if (late) {
+            ag->late++;
+            ag->max_late = late > ag->max_late ? late : ag->max_late;
+        }
+
+        // A start answered with "yes" makes the warning pointless
+        if (a->done) {
+            agenda_cancel(ag, i);
+        }
+    }
+    return fired;
+}
+
+
+int agenda_next(agenda* ag) {
+    if (ag->table) {
+        for (size_t k = ag->cursor; k < ag->table->event_count; k++) {
+            if (!ag->store.items[ag->table->events[k].event / 2].done) {
+                return ag->table->events[k].minute;
+            }
+        }
+        return -1;
+    }
+    return (int)wheel_next(&ag->wheel);
+}
+
+
+void agenda_cancel(agenda* ag, size_t i) {
+    // Walking a compiled table skips the events of activities that are done
+    if (ag->table) {
+        return;
+    }
+    wheel_cancel(&ag->wheel, ag->timers[2 * i]);
+    wheel_cancel(&ag->wheel, ag->timers[2 * i + 1]);
+    ag->timers[2 * i] = WHEEL_INVALID;
+    ag->timers[2 * i + 1] = WHEEL_INVALID;
+}
+
+
+long agenda_add(agenda* ag, const activity* a) {
+    if (leave_table(ag) || reserve_events(ag, ag->store.count + 1)) {
+        return -1;
+    }
+
+    long i = store_add(&ag->store, a->name, a->start_time, a->end_time);
+    if (i < 0) {
+        return -1;
+    }
+    ag->store.items[i].done = a->done;
+    // Events before the first minute the wheel has not processed yet are over
+    if (schedule_activity(ag, (size_t)i, (int)ag->wheel.now)) {
+        return -1;
+    }
+    return i;
+}
+
+
+int agenda_update(agenda* ag, size_t i, atime start, atime end) {
+    activity* a = &ag->store.items[i];
+
+    if (leave_table(ag)) {
+        return -1;
+    }
+    agenda_cancel(ag, i);
+    minute_table_remove(ag->store.occupancy, (uint32_t)i, atime_minutes(&a->start_time), atime_minutes(&a->end_time));
+    a->start_time = start;
+    a->end_time = end;
+    a->done = 0;
+    if (minute_table_add(ag->store.occupancy, (uint32_t)i, atime_minutes(&start), atime_minutes(&end))) {
+        return -1;
+    }
+    return schedule_activity(ag, i, (int)ag->wheel.now);
+}
+
+
+void agenda_remove(agenda* ag, size_t i) {
+    activity* a = &ag->store.items[i];
+
+    // Without the indexes the done flag alone keeps the activity from being announced
+    if (leave_table(ag) == 0) {
+        agenda_cancel(ag, i);
+        minute_table_remove(ag->store.occupancy, (uint32_t)i, atime_minutes(&a->start_time), atime_minutes(&a->end_time));
+    }
+    a->done = 1;
+    bitset_set(&ag->removed, i);
+}
+
+
+void agenda_attach(agenda* ag) {
+    on_done = (done_hook){ cancel_done, ag };
+}
+
+
+/**
+ * @brief Generates a random agenda
+ *
+ * The activities start at random minutes of the day and last between 5 and 59 minutes. The sequence is taken
+ * from rand(), so seeding it with srand() makes the agenda reproducible.
+ *
+ * @param[out] day Array receiving the activities
+ * @param[in] n Number of activities to generate
+ */
+void generate_day(activity* day, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int start = rand() % (MINUTES_PER_DAY - 60);
+        int end = start + 5 + rand() % 55;
+
+        char name[32];
+        int len = snprintf(name, sizeof(name), "Activity %u", (unsigned)i);
+
+        memset(&day[i], 0, sizeof(day[i]));
+        day[i].name = name_intern(name, (size_t)len);
+        day[i].start_time = (atime){ start / 60, start % 60 };
+        day[i].end_time = (atime){ end / 60, end % 60 };
+    }
+}
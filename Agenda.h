@@ -0,0 +1,212 @@
+#ifndef HEADER_AGENDA_H
+#define HEADER_AGENDA_H
+
+// Include any necessary headers here
+#include "Store.h"
+#include "Wheel.h"
+
+// Define struct for an event that expired during a tick
+typedef struct {
+    uint32_t minute; ///< Minute of the day the event was scheduled for
+    uint32_t event; ///< 2 * activity index, plus 1 for a warning
+} agenda_due;
+
+// Define struct for an activity of an agenda compiled into the program, see grandmas-convert -c
+typedef struct {
+    uint16_t start; ///< Start in minutes since midnight
+    uint16_t end; ///< End in minutes since midnight
+    const char* name; ///< Name of the activity
+} agenda_table_item;
+
+// Define struct for an event of an agenda compiled into the program
+typedef struct {
+    uint16_t minute; ///< Minute of the day of the event
+    uint16_t event; ///< 2 * activity index, plus 1 for a warning
+} agenda_table_event;
+
+// Define struct for an agenda compiled into the program, its events already in the order they are announced
+typedef struct {
+    const agenda_table_item* items; ///< Activities
+    size_t count; ///< Number of activities
+    const agenda_table_event* events; ///< Start and warning events, ordered like agenda_tick() announces them
+    size_t event_count; ///< Number of events
+} agenda_table;
+
+// Define struct for an agenda with its indexes
+typedef struct {
+    activity_store store; ///< Activities of the agenda
+    timer_wheel wheel; ///< Pending start and warning events, one tick per minute of the day
+    uint32_t* timers; ///< Timer of every event (start of activity i at 2 * i, its warning at 2 * i + 1), or WHEEL_INVALID
+    agenda_due* due; ///< Events that expired during the current tick, room for every event
+    size_t due_count; ///< Number of events in due
+    bitset removed; ///< Activities dropped by agenda_remove(), they stay in the store as done
+    bitset fixed; ///< Activities that did not come from the agenda file, agenda_file_reload() leaves them alone
+    size_t room; ///< Number of activities timers, due and removed have room for
+    uint64_t late; ///< Number of events announced after their minute, caught up after a stall
+    uint32_t max_late; ///< Longest delay of an announced event in minutes
+    const agenda_table* table; ///< Compiled agenda whose events replace the timer wheel, NULL once it was edited
+    size_t cursor; ///< Next event of table to announce
+} agenda;
+
+// Declare any global variables here
+extern const char* const default_names[]; ///< Names of the built-in agenda, in the order of default_day
+extern const activity default_day[]; ///< Activities of the built-in agenda
+extern const size_t default_day_count; ///< Number of activities in default_day
+
+/**
+ * @brief Orders two events like agenda_tick() announces them: by minute, then starts before warnings, then by activity
+ *
+ * grandmas-convert -c sorts the events of a compiled agenda with it too, so both announce them in the same order.
+ *
+ * @param[in] minute_a Minute of the first event
+ * @param[in] event_a First event, 2 * activity index, plus 1 for a warning
+ * @param[in] minute_b Minute of the second event
+ * @param[in] event_b Second event, 2 * activity index, plus 1 for a warning
+ *
+ * @return Returns a negative, zero or positive value like strcmp()
+ */
+static inline int agenda_event_compare(uint32_t minute_a, uint32_t event_a, uint32_t minute_b, uint32_t event_b) {
+    if (minute_a != minute_b) {
+        return minute_a < minute_b ? -1 : 1;
+    }
+    if ((event_a & 1) != (event_b & 1)) {
+        return (event_a & 1) ? 1 : -1;
+    }
+    return (event_a > event_b) - (event_a < event_b);
+}
+
+/**
+ * @brief Loads a list of activities into a new agenda
+ *
+ * This function copies the activities into the store, indexes them by minute and schedules their start and
+ * warning events from midnight on. Use agenda_seek() to skip what is already over.
+ *
+ * @param[out] ag Pointer to the agenda to initialize
+ * @param[in] day Activities to load
+ * @param[in] n Number of activities
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int agenda_init(agenda* ag, const activity* day, size_t n); ///< Function for creating an agenda
+
+/**
+ * @brief Loads an agenda compiled into the program
+ *
+ * Nothing is parsed, sorted or indexed: the events are walked straight from the table and the activities in
+ * progress during a minute are found by a scan, which is cheap for the small agendas this is meant for. The
+ * first agenda_add(), agenda_update() or agenda_remove() builds the indexes and carries on with the timer wheel.
+ *
+ * @param[out] ag Pointer to the agenda to initialize
+ * @param[in] t Pointer to the compiled agenda, it has to stay valid as long as the agenda
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int agenda_init_table(agenda* ag, const agenda_table* t); ///< Function for creating an agenda from a compiled table
+
+/**
+ * @brief Releases the memory held by an agenda
+ *
+ * @param[in,out] ag Pointer to the agenda to free
+ */
+void agenda_free(agenda* ag); ///< Function for freeing an agenda
+
+/**
+ * @brief Reschedules the events of every activity not done yet, skipping those before the given minute
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] minute Minute of the day
+ */
+void agenda_seek(agenda* ag, int minute); ///< Function for positioning an agenda in the day
+
+/**
+ * @brief Announces every start and warning due since the previous tick, up to and including the given minute
+ *
+ * The timer wheel is advanced to the minute, so every event in the interval (previous tick, minute] is announced,
+ * even when the clock jumped over whole minutes. The events are announced by minute, starts before warnings, then
+ * in activity order. Events of activities that are already done are skipped, and so are warnings of activities
+ * that are over by now. Each event is announced at most once.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] minute Current minute of the day
+ *
+ * @return Returns the number of events announced
+ */
+size_t agenda_tick(agenda* ag, int minute); ///< Function for running one tick of an agenda
+
+/**
+ * @brief Finds the minute of the next event that still has to be announced
+ *
+ * @param[in,out] ag Pointer to the agenda
+ *
+ * @return Returns the minute of the next event, or -1 if nothing is left today
+ */
+int agenda_next(agenda* ag); ///< Function for finding the next boundary of an agenda
+
+/**
+ * @brief Cancels the pending events of an activity
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] i Index of the activity in the store
+ */
+void agenda_cancel(agenda* ag, size_t i); ///< Function for cancelling the reminders of an activity
+
+/**
+ * @brief Appends an activity to a running agenda
+ *
+ * The events of the activity are scheduled unless they are before the minute of the next tick. The store may
+ * move its activities to grow, so pointers into it have to be taken again afterwards.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] a Pointer to the activity to copy, its done flag is kept
+ *
+ * @return Returns the index of the new activity, or -1 if memory could not be allocated
+ */
+long agenda_add(agenda* ag, const activity* a); ///< Function for adding an activity to an agenda
+
+/**
+ * @brief Changes the times of an activity of a running agenda
+ *
+ * The activity is moved in the minute table, it is no longer done and its events are scheduled again like in
+ * agenda_add().
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] i Index of the activity in the store
+ * @param[in] start New start time
+ * @param[in] end New end time
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int agenda_update(agenda* ag, size_t i, atime start, atime end); ///< Function for moving an activity
+
+/**
+ * @brief Removes an activity from a running agenda
+ *
+ * The index stays taken, so the other activities keep theirs. The activity leaves the minute table, its events
+ * are cancelled and it is marked as done, so pending prompts about it are dropped.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] i Index of the activity in the store
+ */
+void agenda_remove(agenda* ag, size_t i); ///< Function for removing an activity
+
+/**
+ * @brief Makes the prompts cancel the reminders of every activity of this agenda the user marks as done
+ *
+ * Only one agenda can be attached at a time, agenda_free() detaches it.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ */
+void agenda_attach(agenda* ag); ///< Function for connecting an agenda to the prompts
+
+/**
+ * @brief Generates a random agenda
+ *
+ * The activities start at random minutes of the day and last between 5 and 59 minutes. The sequence is taken
+ * from rand(), so seeding it with srand() makes the agenda reproducible.
+ *
+ * @param[out] day Array receiving the activities
+ * @param[in] n Number of activities to generate
+ */
+void generate_day(activity* day, size_t n); ///< Function for generating a random agenda
+
+#endif /* HEADER_AGENDA_H */
@@ -0,0 +1,334 @@
+/**
+ * @file AgendaFile.c
+ * @brief This file contains the binary agenda file format, read through a read-only mapping.
+ *
+ * An agenda file is a fixed header, one packed record per activity and a string table with the names. Opening a
+ * file maps it and checks the header, nothing is parsed, so even a facility-wide agenda is ready in microseconds
+ * and the processes using the same file share its pages.
+ */
+
+#include "AgendaFile.h"
+#include "Util.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Define struct for the scratch space used to match a reloaded file against the agenda
+typedef struct {
+    uint32_t* head; // First unmatched activity with the name of every id, or UINT32_MAX
+    uint32_t* tail; // Last activity with the name of every id while the chains are built
+    uint32_t* next; // Next activity with the same name, or UINT32_MAX
+    bitset matched; // Activities that got a record of the file
+} reload_match;
+
+
+/**
+ * @brief Checks that a mapped agenda file still has the size it was mapped with
+ *
+ * @param[in] f Pointer to the agenda file
+ *
+ * @return Returns 0 if it does, -1 with errno set to EINVAL if it was truncated or grown by a writer in place
+ */
+static int check_size(const agenda_file* f) {
+    struct stat st;
+
+    if (fstat(f->fd, &st)) {
+        return -1;
+    }
+    if ((uint64_t)st.st_size != f->size) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+
+int agenda_file_open(agenda_file* f, const char* path) {
+    struct stat st;
+    int fd;
+
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st)) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(agenda_file_header)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    const agenda_file_header* h = map;
+    uint64_t expected = sizeof(agenda_file_header) + (uint64_t)h->count * sizeof(agenda_file_record) + h->names_size;
+    // Every name offset must point into a table that ends with a null byte, so no read can run past the mapping
+    if (memcmp(h->magic, AGENDA_FILE_MAGIC, sizeof(h->magic)) != 0 || h->version != AGENDA_FILE_VERSION
+        || expected != (uint64_t)st.st_size || (h->count && (!h->names_size || ((const char*)map)[st.st_size - 1]))) {
+        munmap(map, (size_t)st.st_size);
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    f->fd = fd;
+    f->map = map;
+    f->size = (size_t)st.st_size;
+    f->header = h;
+    f->records = (const agenda_file_record*)(h + 1);
+    f->names = (const char*)(f->records + h->count);
+    f->count = h->count;
+    return 0;
+}
+
+
+void agenda_file_close(agenda_file* f) {
+    if (f->map) {
+        munmap(f->map, f->size);
+    }
+    if (f->fd >= 0) {
+        close(f->fd);
+    }
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+}
+
+
+int agenda_file_get(const agenda_file* f, size_t i, activity* a) {
+    if (i >= f->count) {
+        return -1;
+    }
+
+    const agenda_file_record* r = &f->records[i];
+    if (r->start > r->end || r->end > MINUTES_PER_DAY || r->name >= f->header->names_size) {
+        return -1;
+    }
+
+    memset(a, 0, sizeof(*a));
+    a->name = name_intern(f->names + r->name, strlen(f->names + r->name));
+    if (a->name == POOL_INVALID_ID) {
+        return -1;
+    }
+    a->start_time = (atime){ r->start / 60, r->start % 60 };
+    a->end_time = (atime){ r->end / 60, r->end % 60 };
+    return 0;
+}
+
+
+int agenda_file_load(agenda* ag, const agenda_file* f) {
+    // A file cut short since it was opened would raise SIGBUS on the first lost page
+    if (check_size(f)) {
+        return -1;
+    }
+    activity* day = malloc((f->count ? f->count : 1) * sizeof(activity));
+    if (!day) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < f->count; i++) {
+        if (agenda_file_get(f, i, &day[i])) {
+            free(day);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    int result = agenda_init(ag, day, f->count);
+    free(day);
+    return result;
+}
+
+
+/**
+ * @brief Matches the records of an agenda file against the activities of an agenda and applies the differences
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] f Pointer to the agenda file, all of its records are valid
+ * @param[in,out] m Pointer to the scratch space, room for every activity of the agenda
+ * @param[out] c Pointer to the counts of the changes applied
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int apply_changes(agenda* ag, const agenda_file* f, reload_match* m, agenda_changes* c) {
+    size_t n = ag->store.count;
+    activity a;
+
+    // Chain the activities still in the agenda by the id of their name, in store order
+    for (uint32_t id = 0; id < activity_names.count; id++) {
+        m->head[id] = UINT32_MAX;
+    }
+    for (size_t i = 0; i < n; i++) {
+        m->next[i] = UINT32_MAX;
+        if (bitset_test(&ag->removed, i) || bitset_test(&ag->fixed, i)) {
+            continue;
+        }
+        uint32_t id = ag->store.items[i].name;
+        if (m->head[id] == UINT32_MAX) {
+            m->head[id] = (uint32_t)i;
+        }
+        else {
+            m->next[m->tail[id]] = (uint32_t)i;
+        }
+        m->tail[id] = (uint32_t)i;
+    }
+
+    for (size_t r = 0; r < f->count; r++) {
+        agenda_file_get(f, r, &a);
+
+        // Names that are not in the agenda have empty chains
+        uint32_t id = a.name;
+        uint32_t i = m->head[id];
+        if (i == UINT32_MAX) {
+            if (agenda_add(ag, &a) < 0) {
+                return -1;
+            }
+            c->added++;
+            continue;
+        }
+        m->head[id] = m->next[i];
+        bitset_set(&m->matched, i);
+
+        const activity* old = &ag->store.items[i];
+        if (atime_minutes(&old->start_time) == atime_minutes(&a.start_time)
+            && atime_minutes(&old->end_time) == atime_minutes(&a.end_time)) {
+            c->kept++;
+            continue;
+        }
+        if (agenda_update(ag, i, a.start_time, a.end_time)) {
+            return -1;
+        }
+        c->updated++;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (!bitset_test(&ag->removed, i) && !bitset_test(&ag->fixed, i) && !bitset_test(&m->matched, i)) {
+            agenda_remove(ag, i);
+            c->removed++;
+        }
+    }
+    return 0;
+}
+
+
+int agenda_file_reload(agenda* ag, const agenda_file* f, agenda_changes* changes) {
+    agenda_changes c = { 0 };
+    size_t n = ag->store.count ? ag->store.count : 1;
+    reload_match m;
+    activity a;
+
+    // Check the whole file first, so a broken file does not leave the agenda half updated, and make sure a writer
+    // did not cut it short in place since it was opened, reading the lost pages would raise SIGBUS
+    if (check_size(f)) {
+        return -1;
+    }
+    for (size_t r = 0; r < f->count; r++) {
+        if (agenda_file_get(f, r, &a)) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    // Checking the file interned its names, so every id the chains see is below the size of the pool
+    size_t ids = activity_names.count ? activity_names.count : 1;
+    m.next = malloc(n * sizeof(uint32_t));
+    m.head = malloc(ids * sizeof(uint32_t));
+    m.tail = malloc(ids * sizeof(uint32_t));
+    m.matched = (bitset){ calloc(bitset_words(n), sizeof(uint64_t)), ag->store.count };
+
+    int result = -1;
+    if (m.next && m.head && m.tail && m.matched.words) {
+        result = apply_changes(ag, f, &m, &c);
+    }
+    free(m.next);
+    free(m.head);
+    free(m.tail);
+    free(m.matched.words);
+
+    if (changes) {
+        *changes = c;
+    }
+    if (result) {
+        errno = ENOMEM;
+    }
+    return result;
+}
+
+
+int agenda_file_write(const char* path, const activity* day, size_t n) {
+    agenda_file_header h;
+    size_t names_size = 0;
+    char tmp[4096];
+
+    if (n > UINT32_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    agenda_file_record* records = malloc((n ? n : 1) * sizeof(agenda_file_record));
+    if (!records) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        int start = atime_minutes(&day[i].start_time);
+        int end = atime_minutes(&day[i].end_time);
+        if (start < 0 || start > end || end > MINUTES_PER_DAY) {
+            free(records);
+            errno = EINVAL;
+            return -1;
+        }
+        records[i] = (agenda_file_record){ (uint16_t)start, (uint16_t)end, (uint32_t)names_size };
+        names_size += strlen(activity_name(&day[i])) + 1;
+    }
+    memcpy(h.magic, AGENDA_FILE_MAGIC, sizeof(h.magic));
+    h.version = AGENDA_FILE_VERSION;
+    h.count = (uint32_t)n;
+    h.names_size = (uint32_t)names_size;
+
+    // Write next to the target, so the rename below stays on the same file system
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        free(records);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    FILE* out = fopen(tmp, "wb");
+    if (!out) {
+        free(records);
+        return -1;
+    }
+
+    int failed = fwrite(&h, sizeof(h), 1, out) != 1;
+    if (!failed && n) {
+        failed = fwrite(records, sizeof(agenda_file_record), n, out) != n;
+    }
+    for (size_t i = 0; i < n && !failed; i++) {
+        size_t len;
+        const char* name = pool_get(&activity_names, day[i].name, &len);
+        failed = fwrite(name, 1, len, out) != len || fputc('\0', out) == EOF;
+    }
+    free(records);
+    // The data must be on disk before the rename, or a crash can leave an empty or partial file under the path
+    failed = failed || fflush(out) || fsync(fileno(out));
+    if (fclose(out) || failed) {
+        int saved = errno;
+        unlink(tmp);
+        errno = saved;
+        return -1;
+    }
+    if (rename(tmp, path)) {
+        int saved = errno;
+        unlink(tmp);
+        errno = saved;
+        return -1;
+    }
+    util_sync_dir(path);
+    return 0;
+}
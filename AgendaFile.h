@@ -0,0 +1,127 @@
+#ifndef HEADER_AGENDAFILE_H
+#define HEADER_AGENDAFILE_H
+
+// Include any necessary headers here
+#include "Agenda.h"
+
+// Declare any constants here
+#define AGENDA_FILE_MAGIC   "GAGD"  ///< First four bytes of every agenda file
+#define AGENDA_FILE_VERSION 1       ///< Version of the layout described below
+
+// Define struct for the fixed header at the start of an agenda file
+typedef struct {
+    char magic[4]; ///< AGENDA_FILE_MAGIC, not null terminated
+    uint32_t version; ///< AGENDA_FILE_VERSION
+    uint32_t count; ///< Number of records following the header
+    uint32_t names_size; ///< Size of the string table following the records, in bytes
+} agenda_file_header;
+
+// Define struct for the packed times of one activity, the records follow the header directly
+typedef struct {
+    uint16_t start; ///< Start of the activity in minutes since midnight
+    uint16_t end; ///< End of the activity in minutes since midnight
+    uint32_t name; ///< Offset of the null terminated name in the string table
+} agenda_file_record;
+
+// Define struct for the changes applied by agenda_file_reload()
+typedef struct {
+    size_t kept; ///< Activities found unchanged, their done flags are kept
+    size_t updated; ///< Activities whose times changed
+    size_t added; ///< Activities new in the file
+    size_t removed; ///< Activities no longer in the file
+} agenda_changes;
+
+// Define struct for an agenda file mapped into memory
+typedef struct {
+    const agenda_file_header* header; ///< Header at the start of the mapping
+    const agenda_file_record* records; ///< Records of the activities, header->count of them
+    const char* names; ///< String table, header->names_size bytes ending with a null byte
+    size_t count; ///< Number of activities
+    void* map; ///< Start of the read-only mapping, or NULL
+    size_t size; ///< Size of the mapping in bytes
+    int fd; ///< Descriptor of the file, kept open to notice a truncation, or -1
+} agenda_file;
+
+/**
+ * @brief Maps an agenda file into memory
+ *
+ * The file is mapped read-only and private. Pages that are never written stay those of the page cache, so every
+ * process opening the same file uses the same physical pages.
+ * Only the header and the sizes are checked here, which takes the same time for any number of activities. The
+ * records are checked when they are read. All fields are stored in the byte order of the machine.
+ *
+ * A file truncated while it is mapped makes reading the lost pages raise SIGBUS. agenda_file_load() and
+ * agenda_file_reload() check the size again before they read, but writers must still replace the file with a
+ * rename(), like agenda_file_write() does, instead of rewriting it in place.
+ *
+ * @param[out] f Pointer to the agenda file to open
+ * @param[in] path Path of the file
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise, EINVAL if the file is not a valid agenda file
+ */
+int agenda_file_open(agenda_file* f, const char* path); ///< Function for opening an agenda file
+
+/**
+ * @brief Unmaps an agenda file and closes its descriptor
+ *
+ * @param[in,out] f Pointer to the agenda file to close
+ */
+void agenda_file_close(agenda_file* f); ///< Function for closing an agenda file
+
+/**
+ * @brief Reads one activity of an agenda file
+ *
+ * The name is interned into activity_names, so it stays valid after the file is closed.
+ *
+ * @param[in] f Pointer to the agenda file
+ * @param[in] i Index of the activity
+ * @param[out] a Pointer to the activity to fill, it is not done
+ *
+ * @return Returns 0 on success, -1 if the record is out of range, has invalid times or name offset, or the name
+ *         could not be interned
+ */
+int agenda_file_get(const agenda_file* f, size_t i, activity* a); ///< Function for reading an activity
+
+/**
+ * @brief Loads the activities of an agenda file into a new agenda
+ *
+ * @param[out] ag Pointer to the agenda to initialize
+ * @param[in] f Pointer to the agenda file
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise, EINVAL if a record is invalid or the file changed size
+ */
+int agenda_file_load(agenda* ag, const agenda_file* f); ///< Function for creating an agenda from a file
+
+/**
+ * @brief Applies a new version of an agenda file to a running agenda
+ *
+ * The activities are matched by name, activities with the same name are matched in file order. Unchanged
+ * activities are not touched and keep their done flags and pending events. Only the changed ones go through
+ * agenda_update(), agenda_add() and agenda_remove(), so the cost depends on the size of the file and the number
+ * of changes, never on rebuilding the indexes. Activities marked in the fixed bitset of the agenda, such as the
+ * occurrences of recurring activities, are neither matched nor removed. Nothing is applied if a record of the file
+ * is invalid. The store may move its activities to grow.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] f Pointer to the new version of the file
+ * @param[out] changes Pointer to the counts of the changes applied, may be NULL
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise, EINVAL if a record is invalid or the file changed size
+ */
+int agenda_file_reload(agenda* ag, const agenda_file* f, agenda_changes* changes); ///< Function for reloading an agenda
+
+/**
+ * @brief Writes a list of activities as an agenda file
+ *
+ * The file is written under a temporary name next to the target, flushed to disk and renamed over it, so a process
+ * mapping the old file keeps seeing it whole and a crash leaves either the old or the new file.
+ *
+ * @param[in] path Path of the file to write
+ * @param[in] day Activities to write
+ * @param[in] n Number of activities
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int agenda_file_write(const char* path, const activity* day, size_t n); ///< Function for writing an agenda file
+
+#endif /* HEADER_AGENDAFILE_H */
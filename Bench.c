@@ -0,0 +1,499 @@
+/**
+ * @file Bench.c
+ * @brief This file contains the microbenchmarks of the scheduling and input parsing primitives.
+ *
+ * Every primitive runs over generated agendas of several sizes. A batch of calls is timed at once and doubled
+ * until it is long enough for the clock, then run a few times to warm up and repeated to get the median, the
+ * spread and the best time per call. The results are printed as a table or, with -m, as CSV so runs on
+ * different machines or branches can be compared by a script.
+ */
+
+#include "Helper.h"
+#include "Agenda.h"
+#include "Store.h"
+#include "Packed.h"
+#include "Prompt.h"
+#include "Render.h"
+#include "Stats.h"
+
+#include <math.h>
+
+#define BENCH_MIN_BATCH_NS  2000000     // Shortest a timed batch may take, shorter ones get more calls
+#define BENCH_MAX_OPS       (1U << 30)  // Most calls in one batch
+#define BENCH_MAX_REPEATS   1000        // Most timed repeats of a batch
+#define BENCH_INPUTS        64          // Number of generated queries, a power of two
+#define BENCH_INVALID       16          // Number of the generated queries that check_input() rejects
+
+// Define struct for the state the benchmarks run on
+typedef struct {
+    agenda ag; // Generated agenda
+    packed_agenda packed; // The same activities in the packed layout the server uses
+    bitset starts; // Activities starting at the minute of a packed_due() call
+    bitset warnings; // Activities due for a warning at the minute of a packed_due() call
+    struct tm now; // Local time the queries and the checks run at
+    Time time_info; // Time handed to parse_time(), pointing to now
+    char inputs[BENCH_INPUTS][8]; // Queries, the invalid ones come first
+    char stream[BENCH_INPUTS * 8]; // The same queries as a command log, one per line
+    size_t stream_len; // Number of characters in stream
+    int day_minutes[MINUTES_PER_DAY]; // Every minute of the day, the queries of a batch lookup
+    uint32_t* answers; // Answers of a batch lookup of the whole day
+    size_t answer_capacity; // Number of indices answers has room for
+    size_t offsets[MINUTES_PER_DAY + 1]; // Offsets of the answers of a batch lookup
+} bench_context;
+
+// Define the function running a benchmark, it returns a value depending on every call so none can be left out
+typedef uint64_t (*bench_fn)(bench_context* c, size_t ops);
+
+// Define struct for one microbenchmark
+typedef struct {
+    const char* name; // Name in the report
+    bench_fn run; // Function running the given number of calls
+    size_t unit; // Operations one call handles, the batches are multiples of it
+} bench_case;
+
+// Define struct for the result of one benchmark at one agenda size
+typedef struct {
+    size_t ops; // Calls per timed batch
+    double median; // Median time per call in nanoseconds
+    double mean; // Mean time per call in nanoseconds
+    double min; // Best time per call in nanoseconds
+    double max; // Worst time per call in nanoseconds
+    double stddev; // Standard deviation of the time per call in nanoseconds
+} bench_result;
+
+static volatile uint64_t sink = 0; // Collects the returned values so the calls are not optimized away
+
+
+/**
+ * @brief Moves the time of the checks to another minute of the day
+ *
+ * @param[in,out] c Pointer to the benchmark state
+ * @param[in] minute Minute of the day
+ */
+static void set_minute(bench_context* c, int minute) {
+    c->now.tm_hour = minute / 60;
+    c->now.tm_min = minute % 60;
+}
+
+
+/**
+ * @brief Runs is_activity_time() over the activities, moving to another minute after every pass
+ */
+static uint64_t run_activity_time(bench_context* c, size_t ops) {
+    const activity* items = c->ag.store.items;
+    size_t n = c->ag.store.count, i = 0;
+    int minute = 0;
+    uint64_t hits = 0;
+
+    for (size_t k = 0; k < ops; k++) {
+        hits += (uint64_t)is_activity_time(&items[i], minute);
+        if (++i == n) {
+            i = 0;
+            minute = (minute + 7) % MINUTES_PER_DAY;
+        }
+    }
+    return hits;
+}
+
+
+/**
+ * @brief Runs is_scheduled() over the activities, moving to another minute after every pass
+ */
+static uint64_t run_scheduled(bench_context* c, size_t ops) {
+    size_t n = c->ag.store.count, i = 0;
+    int minute = 0;
+    uint64_t hits = 0;
+
+    set_minute(c, minute);
+    for (size_t k = 0; k < ops; k++) {
+        hits += (uint64_t)is_scheduled(&c->ag.store, i, &c->now);
+        if (++i == n) {
+            i = 0;
+            minute = (minute + 7) % MINUTES_PER_DAY;
+            set_minute(c, minute);
+        }
+    }
+    return hits;
+}
+
+
+/**
+ * @brief Runs is_due_soon() over the activities, moving to another minute after every pass
+ */
+static uint64_t run_due_soon(bench_context* c, size_t ops) {
+    size_t n = c->ag.store.count, i = 0;
+    int minute = 0;
+    uint64_t hits = 0;
+
+    set_minute(c, minute);
+    for (size_t k = 0; k < ops; k++) {
+        hits += (uint64_t)is_due_soon(&c->ag.store, i, &c->now);
+        if (++i == n) {
+            i = 0;
+            minute = (minute + 7) % MINUTES_PER_DAY;
+            set_minute(c, minute);
+        }
+    }
+    return hits;
+}
+
+
+/**
+ * @brief Runs packed_due() on the due kernel over the packed activities, one call checks every activity at a minute
+ */
+static uint64_t run_packed_due(bench_context* c, size_t ops) {
+    size_t n = c->packed.count ? c->packed.count : 1;
+    int minute = 0;
+    uint64_t hits = 0;
+
+    for (size_t k = 0; k < ops; k += n) {
+        hits += packed_due(&c->packed, minute, &c->starts, &c->warnings);
+        minute = (minute + 7) % MINUTES_PER_DAY;
+    }
+    return hits;
+}
+
+
+/**
+ * @brief Runs agenda_tick() on the timer wheel over every minute of the day, one call announces a whole day
+ */
+static uint64_t run_wheel_day(bench_context* c, size_t ops) {
+    uint64_t fired = 0;
+
+    for (size_t k = 0; k < ops; k += MINUTES_PER_DAY) {
+        agenda_seek(&c->ag, 0);
+        for (int m = 0; m < MINUTES_PER_DAY; m++) {
+            fired += agenda_tick(&c->ag, m);
+        }
+        // The questions of a whole day would pile up over the batch
+        prompt_free(&prompts);
+    }
+    return fired;
+}
+
+
+/**
+ * @brief Runs check_input() over the generated queries, valid and invalid ones
+ */
+static uint64_t run_check_input(bench_context* c, size_t ops) {
+    uint64_t valid = 0;
+
+    for (size_t k = 0; k < ops; k++) {
+        valid += (uint64_t)check_input(c->inputs[k & (BENCH_INPUTS - 1)]);
+    }
+    return valid;
+}
+
+
+/**
+ * @brief Runs parse_query() over the generated queries, valid and invalid ones
+ */
+static uint64_t run_parse_query(bench_context* c, size_t ops) {
+    uint64_t sum = 0;
+
+    for (size_t k = 0; k < ops; k++) {
+        sum += (uint64_t)parse_query(c->inputs[k & (BENCH_INPUTS - 1)], 720);
+    }
+    return sum;
+}
+
+
+/**
+ * @brief Runs parse_queries() over the command log, one call decodes BENCH_INPUTS lines
+ */
+static uint64_t run_parse_queries(bench_context* c, size_t ops) {
+    int minutes[BENCH_INPUTS];
+    uint64_t sum = 0;
+
+    for (size_t k = 0; k < ops; k += BENCH_INPUTS) {
+        sum += parse_queries(c->stream, c->stream_len, 720, minutes, BENCH_INPUTS);
+        sum += (uint64_t)minutes[k & (BENCH_INPUTS - 1)];
+    }
+    return sum;
+}
+
+
+/**
+ * @brief Runs parse_time() over the valid generated queries, including the announcements and questions it queues
+ */
+static uint64_t run_parse_time(bench_context* c, size_t ops) {
+    for (size_t k = 0; k < ops; k++) {
+        parse_time(&c->ag.store, &c->time_info, c->inputs[BENCH_INVALID + k % (BENCH_INPUTS - BENCH_INVALID)]);
+    }
+    return prompts.count;
+}
+
+
+/**
+ * @brief Runs store_query_batch() over every minute of the day on the indexed store, one call answers 1440 queries
+ */
+static uint64_t run_query_batch(bench_context* c, size_t ops) {
+    uint64_t sum = 0;
+
+    for (size_t k = 0; k < ops; k += MINUTES_PER_DAY) {
+        store_query_batch(&c->ag.store, c->day_minutes, MINUTES_PER_DAY, c->answers, c->answer_capacity, c->offsets);
+        sum += c->offsets[MINUTES_PER_DAY];
+    }
+    return sum;
+}
+
+
+/**
+ * @brief Runs store_query_batch() over every minute of the day on the store without its minute table
+ */
+static uint64_t run_query_sweep(bench_context* c, size_t ops) {
+    activity_store flat = c->ag.store;
+    uint64_t sum = 0;
+
+    flat.occupancy = NULL;
+    for (size_t k = 0; k < ops; k += MINUTES_PER_DAY) {
+        store_query_batch(&flat, c->day_minutes, MINUTES_PER_DAY, c->answers, c->answer_capacity, c->offsets);
+        sum += c->offsets[MINUTES_PER_DAY];
+    }
+    return sum;
+}
+
+
+// Benchmarks in the order they are run and reported
+static const bench_case cases[] = {
+    { "is_activity_time", run_activity_time, 1 },
+    { "is_scheduled", run_scheduled, 1 },
+    { "is_due_soon", run_due_soon, 1 },
+    { "packed_due", run_packed_due, 1 },
+    { "wheel_day", run_wheel_day, MINUTES_PER_DAY },
+    { "check_input", run_check_input, 1 },
+    { "parse_query", run_parse_query, 1 },
+    { "parse_queries", run_parse_queries, BENCH_INPUTS },
+    { "parse_time", run_parse_time, 1 },
+    { "query_batch", run_query_batch, MINUTES_PER_DAY },
+    { "query_sweep", run_query_sweep, MINUTES_PER_DAY },
+};
+
+// Agenda sizes the benchmarks run at unless -n is given
+static const size_t sizes[] = { 10, 1000, 100000 };
+
+
+/**
+ * @brief Fills the queries, invalid ones first, then "now" and random times of the day
+ *
+ * @param[out] c Pointer to the benchmark state
+ */
+static void generate_inputs(bench_context* c) {
+    static const char* const invalid[] = { "24:00", "12:60", "1230", "ab:cd", "12:3", "", "now!", "12:345" };
+
+    for (int k = 0; k < BENCH_INVALID; k++) {
+        snprintf(c->inputs[k], sizeof(c->inputs[k]), "%s", invalid[k % (int)(sizeof(invalid) / sizeof(invalid[0]))]);
+    }
+    snprintf(c->inputs[BENCH_INVALID], sizeof(c->inputs[0]), "now");
+    for (int k = BENCH_INVALID + 1; k < BENCH_INPUTS; k++) {
+        int minute = rand() % MINUTES_PER_DAY;
+        snprintf(c->inputs[k], sizeof(c->inputs[k]), "%02d:%02d", minute / 60, minute % 60);
+    }
+
+    c->stream_len = 0;
+    for (int k = 0; k < BENCH_INPUTS; k++) {
+        c->stream_len += (size_t)snprintf(c->stream + c->stream_len, sizeof(c->stream) - c->stream_len, "%s\n",
+            c->inputs[k]);
+    }
+}
+
+
+/**
+ * @brief Times one batch of calls and throws away what the calls queued
+ *
+ * @param[in] b Pointer to the benchmark
+ * @param[in,out] c Pointer to the benchmark state
+ * @param[in] ops Number of calls
+ *
+ * @return Returns the time the batch took in nanoseconds
+ */
+static int64_t time_batch(const bench_case* b, bench_context* c, size_t ops) {
+    int64_t t0 = stats_now();
+    sink += b->run(c, ops);
+    int64_t elapsed = stats_now() - t0;
+
+    prompt_free(&prompts);
+    render_clear();
+    return elapsed;
+}
+
+
+/**
+ * @brief Orders doubles ascending, for qsort()
+ */
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * @brief Runs one benchmark: calibrates the batch size, warms up and collects the timed repeats
+ *
+ * @param[in] b Pointer to the benchmark
+ * @param[in,out] c Pointer to the benchmark state
+ * @param[in] warmup Number of untimed batches
+ * @param[in] repeats Number of timed batches
+ * @param[out] r Pointer to the result
+ */
+static void measure(const bench_case* b, bench_context* c, int warmup, int repeats, bench_result* r) {
+    double samples[BENCH_MAX_REPEATS];
+    size_t ops = b->unit;
+
+    while (ops < BENCH_MAX_OPS && time_batch(b, c, ops) < BENCH_MIN_BATCH_NS) {
+        ops *= 2;
+    }
+    for (int w = 0; w < warmup; w++) {
+        time_batch(b, c, ops);
+    }
+
+    double total = 0.0;
+    for (int k = 0; k < repeats; k++) {
+        samples[k] = (double)time_batch(b, c, ops) / (double)ops;
+        total += samples[k];
+    }
+    qsort(samples, (size_t)repeats, sizeof(double), compare_double);
+
+    r->ops = ops;
+    r->mean = total / repeats;
+    r->min = samples[0];
+    r->max = samples[repeats - 1];
+    r->median = repeats % 2 ? samples[repeats / 2] : (samples[repeats / 2 - 1] + samples[repeats / 2]) / 2.0;
+
+    double squares = 0.0;
+    for (int k = 0; k < repeats; k++) {
+        squares += (samples[k] - r->mean) * (samples[k] - r->mean);
+    }
+    r->stddev = repeats > 1 ? sqrt(squares / (repeats - 1)) : 0.0;
+}
+
+
+/**
+ * @brief Prints how to call the benchmarks
+ *
+ * @param[in] name Name the program was started with
+ */
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-n entries] [-b benchmark] [-r repeats] [-w warmup] [-s seed] [-m] [-h]\n", name);
+    fprintf(stderr, "  -n entries    run at this agenda size only (default 10, 1000 and 100000)\n");
+    fprintf(stderr, "  -b benchmark  run this benchmark only, one of is_activity_time, is_scheduled, is_due_soon,\n");
+    fprintf(stderr, "                packed_due, wheel_day, check_input, parse_query, parse_queries, parse_time,\n");
+    fprintf(stderr, "                query_batch, query_sweep\n");
+    fprintf(stderr, "  -r repeats    timed batches per benchmark (default 15, at most %d)\n", BENCH_MAX_REPEATS);
+    fprintf(stderr, "  -w warmup     untimed batches per benchmark (default 3)\n");
+    fprintf(stderr, "  -s seed       seed of the generated agendas and queries (default 1)\n");
+    fprintf(stderr, "  -m            print CSV instead of a table\n");
+    fprintf(stderr, "  -h            print this help\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    int repeats = 15, warmup = 3, machine = 0, opt;
+    long entries = 0;
+    unsigned seed = 1;
+    const char* only = NULL;
+
+    while ((opt = getopt(argc, argv, "n:b:r:w:s:mh")) != -1) {
+        switch (opt) {
+        case 'n': entries = atol(optarg); break;
+        case 'b': only = optarg; break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'w': warmup = atoi(optarg); break;
+        case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'm': machine = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (entries < 0 || repeats < 1 || repeats > BENCH_MAX_REPEATS || warmup < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    int known = !only;
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]) && !known; k++) {
+        known = strcmp(only, cases[k].name) == 0;
+    }
+    if (!known) {
+        fprintf(stderr, "%s: unknown benchmark %s\n", argv[0], only);
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Frames are only drawn by render_flush(), which is never called, so the announcements stay in memory
+    render_init(true);
+
+    if (machine) {
+        printf("benchmark,entries,ops,median_ns,mean_ns,min_ns,max_ns,stddev_ns\n");
+    }
+    else {
+        printf("%-18s %8s %11s %12s %12s %12s %12s\n", "benchmark", "entries", "ops/batch", "median ns", "mean ns",
+            "min ns", "stddev ns");
+    }
+
+    size_t size_count = entries ? 1 : sizeof(sizes) / sizeof(sizes[0]);
+    for (size_t z = 0; z < size_count; z++) {
+        size_t n = entries ? (size_t)entries : sizes[z];
+        static bench_context c;
+
+        srand(seed);
+        activity* day = malloc(n * sizeof(activity));
+        if (!day) {
+            perror("agenda");
+            return 1;
+        }
+        generate_day(day, n);
+        if (agenda_init(&c.ag, day, n)) {
+            perror("agenda");
+            free(day);
+            return 1;
+        }
+        free(day);
+        generate_inputs(&c);
+
+        // Size the answer buffer of the batch lookups to the whole day
+        for (int m = 0; m < MINUTES_PER_DAY; m++) {
+            c.day_minutes[m] = m;
+        }
+        store_query_batch(&c.ag.store, c.day_minutes, MINUTES_PER_DAY, NULL, 0, c.offsets);
+        c.answer_capacity = c.offsets[MINUTES_PER_DAY];
+        c.answers = malloc((c.answer_capacity ? c.answer_capacity : 1) * sizeof(uint32_t));
+        if (!c.answers) {
+            perror("agenda");
+            agenda_free(&c.ag);
+            return 1;
+        }
+        // The packed layout is built from the store, like the server does for its schedules
+        c.starts = (bitset){ calloc(bitset_words(n) + 1, sizeof(uint64_t)), n };
+        c.warnings = (bitset){ calloc(bitset_words(n) + 1, sizeof(uint64_t)), n };
+        if (packed_build(&c.packed, &c.ag.store) || !c.starts.words || !c.warnings.words) {
+            perror("agenda");
+            return 1;
+        }
+        c.now = (struct tm){ .tm_hour = 12 };
+        c.time_info.local_time = &c.now;
+
+        for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+            bench_result r;
+            if (only && strcmp(only, cases[k].name)) {
+                continue;
+            }
+            measure(&cases[k], &c, warmup, repeats, &r);
+            if (machine) {
+                printf("%s,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f\n", cases[k].name, n, r.ops, r.median, r.mean, r.min,
+                    r.max, r.stddev);
+            }
+            else {
+                printf("%-18s %8zu %11zu %12.2f %12.2f %12.2f %12.2f\n", cases[k].name, n, r.ops, r.median, r.mean,
+                    r.min, r.stddev);
+            }
+            fflush(stdout);
+        }
+        free(c.answers);
+        free(c.starts.words);
+        free(c.warnings.words);
+        packed_free(&c.packed);
+        agenda_free(&c.ag);
+    }
+    prompt_free(&prompts);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef HEADER_BITSET_H
+#define HEADER_BITSET_H
+
+// Include any necessary headers here
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Declare any constants here
+#define BITSET_WORD_BITS 64 ///< Number of bits stored in one word of a bitset
+
+// Define struct for a bitset of arbitrary width
+typedef struct {
+    uint64_t* words; ///< Storage for the bits, owned by the caller
+    size_t bits; ///< Number of bits the bitset can hold
+} bitset;
+
+/**
+ * @brief Returns the number of words needed to hold the given number of bits
+ *
+ * @param[in] bits Number of bits
+ *
+ * @return Returns the number of 64 bit words
+ */
+static inline size_t bitset_words(size_t bits) {
+    return (bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+/**
+ * @brief Checks if a bit is set
+ *
+ * @param[in] b Pointer to the bitset
+ * @param[in] i Index of the bit
+ *
+ * @return Returns true if the bit is set, false otherwise
+ */
+static inline bool bitset_test(const bitset* b, size_t i) {
+    return (b->words[i / BITSET_WORD_BITS] >> (i % BITSET_WORD_BITS)) & 1U;
+}
+
+/**
+ * @brief Sets a bit
+ *
+ * @param[in,out] b Pointer to the bitset
+ * @param[in] i Index of the bit
+ */
+static inline void bitset_set(bitset* b, size_t i) {
+    b->words[i / BITSET_WORD_BITS] |= UINT64_C(1) << (i % BITSET_WORD_BITS);
+}
+
+/**
+ * @brief Clears a bit
+ *
+ * @param[in,out] b Pointer to the bitset
+ * @param[in] i Index of the bit
+ */
+static inline void bitset_clear(bitset* b, size_t i) {
+    b->words[i / BITSET_WORD_BITS] &= ~(UINT64_C(1) << (i % BITSET_WORD_BITS));
+}
+
+/**
+ * @brief Clears every bit of the bitset
+ *
+ * @param[in,out] b Pointer to the bitset
+ */
+static inline void bitset_reset(bitset* b) {
+    memset(b->words, 0, bitset_words(b->bits) * sizeof(uint64_t));
+}
+
+#endif /* HEADER_BITSET_H */
@@ -0,0 +1,125 @@
+/**
+ * @file Clock.c
+ * @brief This file contains the simulated clock that lets the agenda run faster than real time.
+ *
+ * The simulated time is computed on demand as a base time plus the CLOCK_MONOTONIC time elapsed since then,
+ * multiplied by the speed factor. Nothing has to tick in the background, and changing the speed rebases the
+ * clock so no simulated time is lost or gained. A virtual clock takes its real time from a counter instead, which
+ * the headless simulator advances by hand.
+ */
+
+#include "Clock.h"
+#include "Stats.h"
+
+
+/**
+ * @brief Reads the real time source of a clock
+ *
+ * @param[in] c Pointer to the clock
+ *
+ * @return Returns CLOCK_MONOTONIC in nanoseconds, or the virtual real time for a virtual clock
+ */
+static int64_t real_ns(const sim_clock* c) {
+    struct timespec ts;
+
+    if (c->virtual_mode) {
+        return c->virtual_real;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Computes the simulated time at a reading of the real time source
+ *
+ * @param[in] c Pointer to the clock
+ * @param[in] real Reading of the real time source in nanoseconds
+ *
+ * @return Returns the simulated time in nanoseconds since the epoch, at most CLOCK_MAX_NS
+ */
+static int64_t sim_at(const sim_clock* c, int64_t real) {
+    int64_t elapsed = real - c->base_real;
+
+    // Stop at the end of the range, the multiplication and the sum would overflow past it
+    if (elapsed > (CLOCK_MAX_NS - c->base_sim) / c->speed) {
+        return CLOCK_MAX_NS;
+    }
+    return c->base_sim + elapsed * c->speed;
+}
+
+
+void clock_start(sim_clock* c, time_t start, int speed) {
+    c->virtual_mode = 0;
+    c->base_real = real_ns(c);
+    c->base_sim = (int64_t)start * NSEC_PER_SEC;
+    c->speed = speed;
+}
+
+
+void clock_start_virtual(sim_clock* c, time_t start, int speed) {
+    c->virtual_mode = 1;
+    c->virtual_real = 0;
+    c->base_real = 0;
+    c->base_sim = (int64_t)start * NSEC_PER_SEC;
+    c->speed = speed;
+}
+
+
+void clock_advance(sim_clock* c, int64_t delta_ns) {
+    if (c->virtual_mode) {
+        c->virtual_real += delta_ns;
+    }
+}
+
+
+void clock_set_speed(sim_clock* c, int speed) {
+    int64_t real = real_ns(c);
+
+    c->base_sim = sim_at(c, real);
+    c->base_real = real;
+    c->speed = speed;
+}
+
+
+int64_t clock_now_ns(const sim_clock* c) {
+    return sim_at(c, real_ns(c));
+}
+
+
+time_t clock_now(const sim_clock* c) {
+    return (time_t)(clock_now_ns(c) / NSEC_PER_SEC);
+}
+
+
+double clock_real_until(const sim_clock* c, time_t target) {
+    if (target > CLOCK_MAX_NS / NSEC_PER_SEC) {
+        return -1.0;
+    }
+    return clock_real_until_ns(c, (int64_t)target * NSEC_PER_SEC);
+}
+
+
+double clock_real_until_ns(const sim_clock* c, int64_t target_ns) {
+    int64_t left = target_ns - clock_now_ns(c);
+
+    if (left <= 0) {
+        return 0.0;
+    }
+    // Round up so the simulated clock has reached the target when the delay is over
+    return (double)((left + c->speed - 1) / c->speed) / (double)NSEC_PER_SEC;
+}
+
+
+struct tm* time_cache_get(time_cache* cache, time_t t) {
+    if (!cache->valid || t < cache->minute_start || t >= cache->minute_start + 60) {
+        localtime_r(&t, &cache->tm);
+        stats_count(STATS_LOCALTIME);
+        cache->minute_start = t - cache->tm.tm_sec;
+        cache->valid = 1;
+    }
+    else {
+        cache->tm.tm_sec = (int)(t - cache->minute_start);
+    }
+    return &cache->tm;
+}
@@ -0,0 +1,139 @@
+#ifndef HEADER_CLOCK_H
+#define HEADER_CLOCK_H
+
+// Include any necessary headers here
+#include <stdint.h>
+#include <time.h>
+
+// Declare any constants here
+#define NSEC_PER_SEC 1000000000LL ///< Number of nanoseconds in a second
+#define NSEC_PER_MSEC 1000000LL ///< Number of nanoseconds in a millisecond
+#define CLOCK_MAX_NS INT64_MAX ///< Latest simulated time a clock can reach, in the year 2262, where it stops
+
+// Define struct for the simulated clock
+typedef struct {
+    int64_t base_real; ///< CLOCK_MONOTONIC reading in nanoseconds when the clock was last rebased
+    int64_t base_sim; ///< Simulated wall clock time in nanoseconds since the epoch at the same moment
+    int speed; ///< How many simulated seconds pass per real second
+    int virtual_mode; ///< Flag indicating if real time is taken from virtual_real instead of CLOCK_MONOTONIC
+    int64_t virtual_real; ///< Virtual real time in nanoseconds, only advanced by clock_advance()
+} sim_clock;
+
+/**
+ * @brief Starts the simulated clock
+ *
+ * @param[out] c Pointer to the clock to start
+ * @param[in] start Simulated wall clock time to start from
+ * @param[in] speed How many simulated seconds pass per real second
+ */
+void clock_start(sim_clock* c, time_t start, int speed); ///< Function for starting a simulated clock
+
+/**
+ * @brief Starts the simulated clock on a virtual time source
+ *
+ * The clock behaves like one started with clock_start(), except that real time only passes when
+ * clock_advance() is called. This makes runs deterministic and lets them go as fast as the CPU allows.
+ *
+ * @param[out] c Pointer to the clock to start
+ * @param[in] start Simulated wall clock time to start from
+ * @param[in] speed How many simulated seconds pass per real second
+ */
+void clock_start_virtual(sim_clock* c, time_t start, int speed); ///< Function for starting a virtual simulated clock
+
+/**
+ * @brief Lets virtual real time pass
+ *
+ * This function has no effect on a clock started with clock_start().
+ *
+ * @param[in,out] c Pointer to the clock
+ * @param[in] delta_ns Number of real nanoseconds to let pass
+ */
+void clock_advance(sim_clock* c, int64_t delta_ns); ///< Function for advancing a virtual simulated clock
+
+/**
+ * @brief Changes the speed of the simulated clock
+ *
+ * The clock is rebased at the current moment first, so the time already simulated is kept exactly and only time
+ * passing from now on runs at the new speed.
+ *
+ * @param[in,out] c Pointer to the clock
+ * @param[in] speed How many simulated seconds pass per real second
+ */
+void clock_set_speed(sim_clock* c, int speed); ///< Function for changing the speed of a simulated clock
+
+/**
+ * @brief Returns the simulated time with nanosecond resolution
+ *
+ * The time is derived from CLOCK_MONOTONIC on every call, so it neither drifts nor needs a background thread.
+ * Nanoseconds since the epoch run out in the year 2262, which a clock at MAX_SPEED_FACTOR reaches after about 24
+ * real days. The clock stops at CLOCK_MAX_NS there instead of wrapping around.
+ *
+ * @param[in] c Pointer to the clock
+ *
+ * @return Returns the simulated wall clock time in nanoseconds since the epoch
+ */
+int64_t clock_now_ns(const sim_clock* c); ///< Function for reading a simulated clock
+
+/**
+ * @brief Returns the simulated time in whole seconds
+ *
+ * @param[in] c Pointer to the clock
+ *
+ * @return Returns the simulated wall clock time
+ */
+time_t clock_now(const sim_clock* c); ///< Function for reading a simulated clock in seconds
+
+/**
+ * @brief Computes how much real time passes until the simulated clock reaches a given time
+ *
+ * @param[in] c Pointer to the clock
+ * @param[in] target Simulated wall clock time to wait for
+ *
+ * @return Returns the delay in real seconds, 0 if the time has already been reached, or a negative value if it lies
+ * beyond CLOCK_MAX_NS and is never reached
+ */
+double clock_real_until(const sim_clock* c, time_t target); ///< Function for converting a simulated deadline to a delay
+
+/**
+ * @brief Computes how much real time passes until the simulated clock reaches a given time in nanoseconds
+ *
+ * @param[in] c Pointer to the clock
+ * @param[in] target_ns Simulated time to wait for in nanoseconds
+ *
+ * @return Returns the delay in real seconds, or 0 if the target has already been reached
+ */
+double clock_real_until_ns(const sim_clock* c, int64_t target_ns); ///< Function for converting a precise simulated deadline to a delay
+
+// Define struct for the cached local time conversion
+typedef struct {
+    time_t minute_start; ///< First second of the minute the cached conversion belongs to
+    struct tm tm; ///< Local time at the current second of that minute
+    int valid; ///< Flag indicating if the cache holds a conversion
+} time_cache;
+
+/**
+ * @brief Converts a time into local time, reusing the previous conversion within the same minute
+ *
+ * This function calls localtime_r() only when the time leaves the minute of the previous conversion. Inside the
+ * minute only the seconds are updated. Time zone and daylight saving time changes happen on minute boundaries, so
+ * the cached fields stay correct.
+ *
+ * @param[in,out] cache Pointer to the cache
+ * @param[in] t Time to convert
+ *
+ * @return Returns a pointer to the local time held by the cache
+ */
+struct tm* time_cache_get(time_cache* cache, time_t t); ///< Function for converting a time into local time
+
+/**
+ * @brief Returns the number of minutes since midnight of a local time
+ *
+ * @param[in] t Pointer to the local time
+ *
+ * @return Returns the minute of the day
+ */
+static inline int tm_minutes(const struct tm* t) {
+    return t->tm_hour * 60 + t->tm_min;
+}
+
+#endif /* HEADER_CLOCK_H */
@@ -0,0 +1,424 @@
+/**
+ * @file Convert.c
+ * @brief This file contains the converter between the text and the binary agenda formats.
+ *
+ * Agendas are written by hand as text, one activity per line:
+ *
+ *     # Start End   Name
+ *     08:50  09:30  Breakfast
+ *
+ * Blank lines and lines starting with '#' are skipped. The converter turns such a file into the binary agenda
+ * file the programs map at startup, with -d turns a binary file back into text, and with -c writes a C header
+ * that builds the agenda into the program. With -H it reads a history written by -H of the programs and prints
+ * the adherence of every resident.
+ */
+
+#include "Helper.h"
+#include "AgendaFile.h"
+#include "Agenda.h"
+#include "History.h"
+
+#include <ctype.h>
+#include <errno.h>
+
+#define CONVERT_LINE_LENGTH 256 // Longest line of a text agenda, including the newline
+
+// Define struct for the adherence of one resident, summed over a whole history
+typedef struct {
+    uint64_t kinds[4]; ///< Number of events of every kind, indexed by HISTORY_START to HISTORY_NO
+    uint64_t latency; ///< Sum of the response latencies of the answers in milliseconds
+} adherence;
+
+// Define struct for the adherence of every resident seen in a history
+typedef struct {
+    adherence* owners; ///< Adherence indexed by resident
+    size_t count; ///< Number of residents, one more than the highest resident seen
+    int failed; ///< Flag set if memory could not be allocated
+} adherence_report;
+
+
+/**
+ * @brief Prints the usage of the converter
+ *
+ * @param[in] name Name the program was started with
+ */
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s text-file agenda-file\n", name);
+    fprintf(stderr, "       %s -d agenda-file [text-file]\n", name);
+    fprintf(stderr, "       %s -c text-file header-file\n", name);
+    fprintf(stderr, "       %s -H history-file\n", name);
+    fprintf(stderr, "  -d  write a binary agenda file back as text, to stdout if no text file is given\n");
+    fprintf(stderr, "  -c  write the agenda as constant tables for make AGENDA=text-file\n");
+    fprintf(stderr, "  -H  print the reminders, answers and mean response time of every resident of a history\n");
+}
+
+
+/**
+ * @brief Parses one line of a text agenda
+ *
+ * @param[in] line Line to parse, the newline may still be there
+ * @param[out] a Pointer to the activity to fill
+ *
+ * @return Returns 1 if an activity was read, 0 if the line is blank or a comment, -1 if it is invalid
+ */
+static int parse_line(const char* line, activity* a) {
+    int sh, sm, eh, em, name = 0;
+
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (!*line || *line == '#') {
+        return 0;
+    }
+    if (sscanf(line, "%d:%d %d:%d %n", &sh, &sm, &eh, &em, &name) != 4 || !name || !line[name]) {
+        return -1;
+    }
+    if (sh < 0 || sm < 0 || sm > 59 || eh < 0 || em < 0 || em > 59) {
+        return -1;
+    }
+
+    size_t len = strcspn(line + name, "\r\n");
+    while (len && isspace((unsigned char)line[name + len - 1])) {
+        len--;
+    }
+    memset(a, 0, sizeof(*a));
+    a->name = name_intern(line + name, len);
+    if (a->name == POOL_INVALID_ID) {
+        return -1;
+    }
+    a->start_time = (atime){ sh, sm };
+    a->end_time = (atime){ eh, em };
+
+    int start = atime_minutes(&a->start_time);
+    int end = atime_minutes(&a->end_time);
+    return len && start <= end && end <= MINUTES_PER_DAY ? 1 : -1;
+}
+
+
+/**
+ * @brief Reads every activity of a text agenda
+ *
+ * @param[in] text Path of the text agenda
+ * @param[out] count Pointer receiving the number of activities
+ *
+ * @return Returns the activities, to be freed by the caller, or NULL after reporting the error
+ */
+static activity* read_text(const char* text, size_t* count) {
+    char line[CONVERT_LINE_LENGTH];
+    activity* day = NULL;
+    size_t capacity = 0, number = 0;
+
+    *count = 0;
+    FILE* in = fopen(text, "r");
+    if (!in) {
+        perror(text);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        activity a;
+        number++;
+
+        int parsed = parse_line(line, &a);
+        if (parsed < 0) {
+            fprintf(stderr, "%s:%zu: expected \"HH:MM HH:MM name\" within the day\n", text, number);
+            fclose(in);
+            free(day);
+            return NULL;
+        }
+        if (!parsed) {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            activity* grown = realloc(day, capacity * sizeof(activity));
+            if (!grown) {
+                perror("agenda");
+                fclose(in);
+                free(day);
+                return NULL;
+            }
+            day = grown;
+        }
+        day[(*count)++] = a;
+    }
+    fclose(in);
+
+    // An empty agenda still needs a block to hand back
+    if (!day && !(day = malloc(sizeof(activity)))) {
+        perror("agenda");
+    }
+    return day;
+}
+
+
+/**
+ * @brief Converts a text agenda into a binary agenda file
+ *
+ * @param[in] text Path of the text agenda
+ * @param[in] path Path of the agenda file to write
+ *
+ * @return Returns 0 on success, 1 otherwise
+ */
+static int text_to_binary(const char* text, const char* path) {
+    size_t count;
+    activity* day = read_text(text, &count);
+
+    if (!day) {
+        return 1;
+    }
+    if (agenda_file_write(path, day, count)) {
+        perror(path);
+        free(day);
+        return 1;
+    }
+    free(day);
+    return 0;
+}
+
+
+/**
+ * @brief Orders compiled events like agenda_tick() announces them: by minute, starts first, then by activity
+ *
+ * @param[in] lhs Pointer to the first event
+ * @param[in] rhs Pointer to the second event
+ *
+ * @return Returns a negative, zero or positive value like strcmp()
+ */
+static int compare_events(const void* lhs, const void* rhs) {
+    const agenda_table_event* a = lhs;
+    const agenda_table_event* b = rhs;
+
+    return agenda_event_compare(a->minute, a->event, b->minute, b->event);
+}
+
+
+/**
+ * @brief Writes a name as a C string literal
+ *
+ * @param[in,out] out File to write to
+ * @param[in] name Null terminated name
+ */
+static void write_literal(FILE* out, const char* name) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        }
+        else if (*p < 0x20 || *p >= 0x7F) {
+            // Octal escapes take at most three digits, so a following digit cannot become part of them
+            fprintf(out, "\\%03o", *p);
+        }
+        else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+
+/**
+ * @brief Converts a text agenda into a C header holding the agenda as constant tables
+ *
+ * The times are written in minutes and the start and warning events in the order they are announced, so a
+ * program built with the header does no parsing, sorting or indexing at startup.
+ *
+ * @param[in] text Path of the text agenda
+ * @param[in] path Path of the header to write
+ *
+ * @return Returns 0 on success, 1 otherwise
+ */
+static int text_to_table(const char* text, const char* path) {
+    size_t count;
+    activity* day = read_text(text, &count);
+
+    if (!day) {
+        return 1;
+    }
+    // The events store activity indices in 16 bits and C has no empty arrays
+    if (!count || count > UINT16_MAX / 2) {
+        fprintf(stderr, "%s: a compiled agenda needs 1 to %d activities\n", text, UINT16_MAX / 2);
+        free(day);
+        return 1;
+    }
+
+    agenda_table_event* events = malloc(2 * count * sizeof(agenda_table_event));
+    if (!events) {
+        perror("agenda");
+        free(day);
+        return 1;
+    }
+    size_t event_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        int start = atime_minutes(&day[i].start_time);
+        int warning = atime_minutes(&day[i].end_time) - WARNING_MINUTES;
+        events[event_count++] = (agenda_table_event){ (uint16_t)start, (uint16_t)(2 * i) };
+        // Activities shorter than the warning time never get a warning, like in the timer wheel
+        if (warning >= start) {
+            events[event_count++] = (agenda_table_event){ (uint16_t)warning, (uint16_t)(2 * i + 1) };
+        }
+    }
+    qsort(events, event_count, sizeof(agenda_table_event), compare_events);
+
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        free(events);
+        free(day);
+        return 1;
+    }
+    fprintf(out, "/* Generated by grandmas-convert -c from %s, do not edit */\n", text);
+    fprintf(out, "#ifndef HEADER_AGENDA_TABLE_H\n#define HEADER_AGENDA_TABLE_H\n\n#include \"Agenda.h\"\n\n");
+    fprintf(out, "static const agenda_table_item compiled_items[] = {\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "    { %d, %d, ", atime_minutes(&day[i].start_time), atime_minutes(&day[i].end_time));
+        write_literal(out, activity_name(&day[i]));
+        fprintf(out, " },\n");
+    }
+    fprintf(out, "};\n\nstatic const agenda_table_event compiled_events[] = {\n");
+    for (size_t k = 0; k < event_count; k++) {
+        fprintf(out, "    { %u, %u },\n", events[k].minute, events[k].event);
+    }
+    fprintf(out, "};\n\nstatic const agenda_table compiled_agenda = { compiled_items, %zu, compiled_events, %zu };\n",
+        count, event_count);
+    fprintf(out, "\n#endif /* HEADER_AGENDA_TABLE_H */\n");
+
+    int failed = ferror(out);
+    if (fclose(out) || failed) {
+        perror(path);
+        failed = 1;
+    }
+    free(events);
+    free(day);
+    return failed ? 1 : 0;
+}
+
+
+/**
+ * @brief Converts a binary agenda file back into a text agenda
+ *
+ * @param[in] path Path of the agenda file
+ * @param[in] text Path of the text agenda to write, or NULL for stdout
+ *
+ * @return Returns 0 on success, 1 otherwise
+ */
+static int binary_to_text(const char* path, const char* text) {
+    agenda_file f;
+
+    if (agenda_file_open(&f, path)) {
+        perror(path);
+        return 1;
+    }
+    FILE* out = text ? fopen(text, "w") : stdout;
+    if (!out) {
+        perror(text);
+        agenda_file_close(&f);
+        return 1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < f.count; i++) {
+        activity a;
+        if (agenda_file_get(&f, i, &a)) {
+            fprintf(stderr, "%s: record %zu is invalid\n", path, i);
+            result = 1;
+            break;
+        }
+        fprintf(out, "%02d:%02d %02d:%02d %s\n", a.start_time.hour, a.start_time.minute, a.end_time.hour,
+                a.end_time.minute, activity_name(&a));
+    }
+    if (out != stdout && fclose(out)) {
+        perror(text);
+        result = 1;
+    }
+    agenda_file_close(&f);
+    return result;
+}
+
+
+/**
+ * @brief Adds the events of one block of a history to the report, called by history_scan()
+ *
+ * @param[in,out] ctx Pointer to the report
+ * @param[in] c Pointer to the owner, kind and latency columns of the block
+ */
+static void add_block(void* ctx, const history_columns* c) {
+    adherence_report* r = ctx;
+
+    for (size_t i = 0; i < c->count && !r->failed; i++) {
+        if (c->owner[i] >= r->count) {
+            size_t count = (size_t)c->owner[i] + 1;
+            adherence* owners = realloc(r->owners, count * sizeof(adherence));
+            if (!owners) {
+                r->failed = 1;
+                break;
+            }
+            memset(owners + r->count, 0, (count - r->count) * sizeof(adherence));
+            r->owners = owners;
+            r->count = count;
+        }
+        adherence* a = &r->owners[c->owner[i]];
+        a->kinds[c->kind[i]]++;
+        a->latency += c->latency[i];
+    }
+}
+
+
+/**
+ * @brief Prints the adherence of every resident of a history
+ *
+ * Only the owner, kind and latency columns are decoded, the times and the activities are skipped.
+ *
+ * @param[in] path Path of the history
+ *
+ * @return Returns 0 on success, 1 after reporting the error
+ */
+static int history_report(const char* path) {
+    adherence_report r = { NULL, 0, 0 };
+    unsigned columns = 1u << HISTORY_OWNER | 1u << HISTORY_KIND | 1u << HISTORY_LATENCY;
+
+    if (history_scan(path, columns, add_block, &r) || r.failed) {
+        if (!r.failed && errno == EILSEQ) {
+            fprintf(stderr, "%s: a block of the history is garbled\n", path);
+        }
+        else {
+            perror(path);
+        }
+        free(r.owners);
+        return 1;
+    }
+
+    printf("resident     starts   warnings        yes         no   answered  mean answer\n");
+    for (size_t id = 0; id < r.count; id++) {
+        const adherence* a = &r.owners[id];
+        uint64_t answers = a->kinds[HISTORY_YES] + a->kinds[HISTORY_NO];
+        uint64_t reminders = a->kinds[HISTORY_START] + a->kinds[HISTORY_WARNING];
+
+        if (!reminders && !answers) {
+            continue;
+        }
+        printf("%8zu %10llu %10llu %10llu %10llu %9.1f%% %10.1f s\n", id, (unsigned long long)a->kinds[HISTORY_START],
+            (unsigned long long)a->kinds[HISTORY_WARNING], (unsigned long long)a->kinds[HISTORY_YES],
+            (unsigned long long)a->kinds[HISTORY_NO], reminders ? 100.0 * (double)answers / (double)reminders : 0.0,
+            answers ? (double)a->latency / (double)answers / 1000.0 : 0.0);
+    }
+    free(r.owners);
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && argc <= 4 && strcmp(argv[1], "-d") == 0) {
+        return binary_to_text(argv[2], argc == 4 ? argv[3] : NULL);
+    }
+    if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+        return text_to_table(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "-H") == 0) {
+        return history_report(argv[2]);
+    }
+    if (argc == 3 && argv[1][0] != '-') {
+        return text_to_binary(argv[1], argv[2]);
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file DayGrid.c
+ * @brief This file contains the precomputed minute-by-minute occupancy grids of the agendas.
+ *
+ * A grid holds three bitmaps of one row per minute of the day: the activities in progress, the activities
+ * starting and the warnings due. Once it is built, what an agenda looks like at any minute is a row lookup. The
+ * grids of many agendas are built in parallel, each of them once.
+ */
+
+#include "DayGrid.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Define struct for the work shared by the threads of day_grid_build_all()
+typedef struct {
+    day_grid* grids; // Grids to build
+    const packed_agenda* agendas; // Agendas of the grids
+    size_t n; // Number of agendas
+    atomic_size_t next; // Next agenda a thread may take
+    atomic_long built; // Number of grids built so far
+    atomic_int failed; // Set when a build ran out of memory
+} build_job;
+
+
+int day_grid_build(day_grid* g, const packed_agenda* p) {
+    size_t words = bitset_words(p->count);
+    size_t size = (size_t)GRID_PLANES * MINUTES_PER_DAY * (words ? words : 1) * sizeof(uint64_t);
+
+    if (!g->bits || words != g->words) {
+        uint64_t* bits = realloc(g->bits, size);
+        if (!bits) {
+            return -1;
+        }
+        g->bits = bits;
+    }
+    memset(g->bits, 0, size);
+    g->words = words;
+    g->count = p->count;
+
+    uint64_t* occupancy = g->bits;
+    uint64_t* starts = g->bits + (size_t)GRID_STARTS * MINUTES_PER_DAY * words;
+    uint64_t* warnings = g->bits + (size_t)GRID_WARNINGS * MINUTES_PER_DAY * words;
+    for (size_t i = 0; i < p->count; i++) {
+        size_t word = i / BITSET_WORD_BITS;
+        uint64_t bit = UINT64_C(1) << (i % BITSET_WORD_BITS);
+        int end = p->end[i] < MINUTES_PER_DAY ? p->end[i] : MINUTES_PER_DAY;
+
+        for (int m = p->start[i]; m < end; m++) {
+            occupancy[(size_t)m * words + word] |= bit;
+        }
+        if (p->start[i] < MINUTES_PER_DAY) {
+            starts[(size_t)p->start[i] * words + word] |= bit;
+        }
+        if (p->warning[i] < MINUTES_PER_DAY) {
+            warnings[(size_t)p->warning[i] * words + word] |= bit;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Takes agendas from the shared cursor and builds the grids that need it
+ *
+ * @param[in,out] arg Pointer to the build job
+ *
+ * @return Returns NULL
+ */
+static void* build_worker(void* arg) {
+    build_job* job = arg;
+    size_t i;
+
+    while ((i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->n) {
+        day_grid* g = &job->grids[i];
+        if (g->bits) {
+            continue;
+        }
+        if (day_grid_build(g, &job->agendas[i])) {
+            atomic_store(&job->failed, 1);
+            continue;
+        }
+        atomic_fetch_add_explicit(&job->built, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+
+long day_grid_build_all(day_grid* grids, const packed_agenda* agendas, size_t n, int threads) {
+    pthread_t helpers[GRID_MAX_THREADS];
+    build_job job = { .grids = grids, .agendas = agendas, .n = n };
+    int started = 0;
+
+    // Every grid is built already, no thread is started
+    size_t stale = 0;
+    for (size_t i = 0; i < n; i++) {
+        stale += !grids[i].bits;
+    }
+    if (!stale) {
+        return 0;
+    }
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if ((size_t)threads > stale) {
+        threads = (int)stale;
+    }
+    if (threads > GRID_MAX_THREADS) {
+        threads = GRID_MAX_THREADS;
+    }
+
+    // The calling thread works too, a helper that cannot be started only makes the build slower
+    for (int k = 1; k < threads; k++) {
+        if (pthread_create(&helpers[started], NULL, build_worker, &job) == 0) {
+            started++;
+        }
+    }
+    build_worker(&job);
+    for (int k = 0; k < started; k++) {
+        pthread_join(helpers[k], NULL);
+    }
+    return atomic_load(&job.failed) ? -1 : atomic_load(&job.built);
+}
+
+
+void day_grid_free(day_grid* g) {
+    free(g->bits);
+    memset(g, 0, sizeof(*g));
+}
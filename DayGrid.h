@@ -0,0 +1,66 @@
+#ifndef HEADER_DAY_GRID_H
+#define HEADER_DAY_GRID_H
+
+// Include any necessary headers here
+#include "Packed.h"
+
+// Declare any constants here
+#define GRID_OCCUPANCY  0 ///< Plane of the activities in progress during a minute
+#define GRID_STARTS     1 ///< Plane of the activities starting at a minute
+#define GRID_WARNINGS   2 ///< Plane of the activities whose 10 minute warning is due at a minute
+#define GRID_PLANES     3 ///< Number of planes of a grid
+#define GRID_MAX_THREADS 64 ///< Most threads day_grid_build_all() uses
+
+// Define struct for the precomputed minute-by-minute bitmap of one agenda
+typedef struct {
+    uint64_t* bits; ///< GRID_PLANES planes of MINUTES_PER_DAY rows, one bit per activity, NULL before the first build
+    size_t words; ///< Number of 64 bit words in one row
+    size_t count; ///< Number of activities the grid was built for
+} day_grid;
+
+/**
+ * @brief Returns one row of a grid
+ *
+ * @param[in] g Pointer to a built grid
+ * @param[in] plane GRID_OCCUPANCY, GRID_STARTS or GRID_WARNINGS
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns the words of the row, bit i is set if activity i is in the plane at that minute
+ */
+static inline const uint64_t* day_grid_row(const day_grid* g, int plane, int minute) {
+    return g->bits + ((size_t)plane * MINUTES_PER_DAY + (size_t)minute) * g->words;
+}
+
+/**
+ * @brief Builds the grid of one agenda, reusing the memory of a previous build when the size did not change
+ *
+ * @param[in,out] g Pointer to the grid, zeroed before the first build
+ * @param[in] p Pointer to the packed agenda
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int day_grid_build(day_grid* g, const packed_agenda* p); ///< Function for building the grid of an agenda
+
+/**
+ * @brief Builds the grids that were not built yet, spread over several threads
+ *
+ * Grids that are already built are kept as they are, so calling this again is cheap. The threads take the
+ * agendas one at a time from a shared cursor, so a few large agendas do not leave the other threads idle.
+ *
+ * @param[in,out] grids Grids of the agendas, zeroed before the first build
+ * @param[in] agendas Packed agendas, one per grid
+ * @param[in] n Number of agendas
+ * @param[in] threads Number of threads to use, the calling thread included, 0 for one per CPU
+ *
+ * @return Returns the number of grids rebuilt, or -1 if memory could not be allocated for one of them
+ */
+long day_grid_build_all(day_grid* grids, const packed_agenda* agendas, size_t n, int threads); ///< Function for building many grids
+
+/**
+ * @brief Releases the bitmap of a grid
+ *
+ * @param[in,out] g Pointer to the grid
+ */
+void day_grid_free(day_grid* g); ///< Function for freeing a grid
+
+#endif /* HEADER_DAY_GRID_H */
@@ -0,0 +1,243 @@
+/**
+ * @file EventLoop.c
+ * @brief This file contains the event loop that puts the program to sleep between scheduled boundaries.
+ *
+ * The loop is built on epoll and a timerfd. Instead of waking up on a fixed interval, the program sleeps
+ * until either stdin becomes readable or the timer armed for the next activity boundary expires. An eventfd
+ * written from the signal handler lets a shutdown request interrupt any wait.
+ */
+
+#define _GNU_SOURCE // For ppoll()
+
+#include "EventLoop.h"
+#include "Stats.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+// Define struct for a descriptor watched by the loop
+typedef struct {
+    int fd; // Watched file descriptor
+    uint32_t event; // Event bit reported when the descriptor becomes readable
+} watched_fd;
+
+static int epoll_fd = -1;  // Epoll instance used for waiting
+static int timer_fd = -1;  // One-shot timer for the next boundary
+static int shutdown_fd = -1;  // Eventfd written when a shutdown is requested
+static volatile sig_atomic_t shutdown_requested = 0;  // Set once a shutdown has been requested
+static watched_fd watched[LOOP_MAX_FDS];  // Descriptors that also interrupt loop_sleep()
+static int watched_count = 0;  // Number of entries in watched
+static int64_t budget_ns = 0;  // How late a soft deadline may be taken, 0 to take it on time
+static int64_t soft_at = -1;  // Monotonic time of the armed soft deadline, -1 if none is armed
+static int armed_for = -1;  // Counter of the armed timer, STATS_WAKEUP_TIGHT or STATS_WAKEUP_COARSE, -1 for loop_arm()
+
+
+int loop_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        return -1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (timer_fd < 0 || shutdown_fd < 0) {
+        loop_close();
+        return -1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = LOOP_TIMER };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) || loop_watch(shutdown_fd, LOOP_SHUTDOWN)) {
+        loop_close();
+        return -1;
+    }
+    return 0;
+}
+
+
+void loop_close(void) {
+    int* fds[] = { &timer_fd, &shutdown_fd, &epoll_fd };
+
+    for (int i = 0; i < 3; i++) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+    watched_count = 0;
+}
+
+
+int loop_watch(int fd, uint32_t event) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = event };
+
+    if (watched_count == LOOP_MAX_FDS || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+        return -1;
+    }
+    watched[watched_count++] = (watched_fd){ fd, event };
+    return 0;
+}
+
+
+void loop_arm(double seconds) {
+    struct itimerspec spec = { 0 };
+
+    armed_for = -1;
+    soft_at = -1;
+
+    if (seconds >= 0) {
+        // A zero it_value disarms the timer, so round very short delays up to one nanosecond
+        spec.it_value.tv_sec = (time_t)seconds;
+        spec.it_value.tv_nsec = (long)((seconds - (double)spec.it_value.tv_sec) * 1e9);
+        if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+}
+
+
+void loop_set_budget(double seconds) {
+    budget_ns = seconds > 0 ? (int64_t)(seconds * 1e9) : 0;
+}
+
+
+void loop_arm_deadlines(double event, double soft) {
+    int64_t now = stats_now();
+    int64_t soft_deadline = soft < 0 ? -1 : now + (int64_t)(soft * 1e9);
+    int64_t wake = soft_deadline;
+
+    // Round up to the budget grid, every soft deadline within the same slot wakes the loop once
+    if (soft_deadline >= 0 && budget_ns) {
+        wake = (soft_deadline + budget_ns - 1) / budget_ns * budget_ns;
+    }
+    int tight = event >= 0 && (wake < 0 || now + (int64_t)(event * 1e9) <= wake);
+    loop_arm(tight ? event : (wake < 0 ? -1.0 : (double)(wake - now) / 1e9));
+    armed_for = tight ? STATS_WAKEUP_TIGHT : (wake < 0 ? -1 : STATS_WAKEUP_COARSE);
+    soft_at = soft_deadline;
+}
+
+
+uint32_t loop_wait(void) {
+    struct epoll_event events[LOOP_MAX_FDS + 1];
+    uint32_t mask = 0;
+    int n;
+
+    // A signal ends the wait too, so the caller can act on what its handler recorded
+    n = epoll_wait(epoll_fd, events, LOOP_MAX_FDS + 1, -1);
+    if (n < 0 && errno == EINTR) {
+        mask |= LOOP_SIGNAL;
+    }
+    else if (n < 0) {
+        // Stop the loop instead of letting the caller retry in a spin, errno is left for it to report
+        shutdown_requested = 1;
+        mask |= LOOP_ERROR;
+    }
+    stats_count(STATS_WAKEUP);
+
+    for (int i = 0; i < n; i++) {
+        mask |= events[i].data.u32;
+    }
+    if (shutdown_requested) {
+        mask |= LOOP_SHUTDOWN;
+    }
+
+    // Drain the expiration counter so the timer does not stay readable
+    if (mask & LOOP_TIMER) {
+        uint64_t expirations;
+        stats_count(STATS_READ);
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+            mask &= ~LOOP_TIMER;
+        }
+    }
+    if ((mask & LOOP_TIMER) && armed_for >= 0) {
+        int64_t now = stats_now();
+        stats_count((stats_counter)armed_for);
+        // An event armed before the soft deadline took nothing late
+        if (soft_at >= 0 && now >= soft_at) {
+            stats_add(STATS_LAG_SOFT, now - soft_at);
+        }
+        armed_for = -1;
+        soft_at = -1;
+    }
+    return mask;
+}
+
+
+uint32_t loop_sleep(double seconds) {
+    struct pollfd fds[LOOP_MAX_FDS];
+    struct timespec now, deadline;
+    uint32_t mask = 0;
+
+    for (int i = 0; i < watched_count; i++) {
+        fds[i] = (struct pollfd){ .fd = watched[i].fd, .events = POLLIN };
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t)seconds;
+    deadline.tv_nsec += (long)((seconds - (double)(time_t)seconds) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    // The timer descriptor is left out on purpose, an expired boundary is handled once the delay is over
+    while (!shutdown_requested) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec left = { deadline.tv_sec - now.tv_sec, deadline.tv_nsec - now.tv_nsec };
+        if (left.tv_nsec < 0) {
+            left.tv_sec--;
+            left.tv_nsec += 1000000000L;
+        }
+        if (left.tv_sec < 0) {
+            break;
+        }
+
+        int n = ppoll(fds, (nfds_t)watched_count, &left, NULL);
+        if (n > 0) {
+            for (int i = 0; i < watched_count; i++) {
+                if (fds[i].revents) {
+                    mask |= watched[i].event;
+                }
+            }
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (errno != EINTR) {
+            // The descriptors cannot be polled, sleep out the delay instead of retrying in a spin
+            while (!shutdown_requested
+                && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+            }
+            break;
+        }
+    }
+
+    if (shutdown_requested) {
+        mask |= LOOP_SHUTDOWN;
+    }
+    return mask;
+}
+
+
+void loop_request_shutdown(void) {
+    uint64_t one = 1;
+
+    shutdown_requested = 1;
+    if (shutdown_fd >= 0) {
+        // Only async-signal-safe calls are allowed here
+        ssize_t written = write(shutdown_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+
+bool loop_stopped(void) {
+    return shutdown_requested;
+}
@@ -0,0 +1,112 @@
+#ifndef HEADER_EVENT_LOOP_H
+#define HEADER_EVENT_LOOP_H
+
+// Include any necessary headers here
+#include <stdbool.h>
+#include <stdint.h>
+
+// Declare any constants here
+#define LOOP_TIMER      (1U << 0) ///< Event bit reported when the armed timer expires
+#define LOOP_INPUT      (1U << 1) ///< Event bit reported when stdin has data to read
+#define LOOP_SHUTDOWN   (1U << 2) ///< Event bit reported once a shutdown has been requested
+#define LOOP_RELOAD     (1U << 3) ///< Event bit reported when the watched agenda file has changed
+#define LOOP_SIGNAL     (1U << 4) ///< Event bit reported when a signal handler interrupted the wait
+#define LOOP_ERROR      (1U << 5) ///< Event bit reported when the wait itself failed, errno tells why
+#define LOOP_MAX_FDS    8         ///< Maximum number of file descriptors the loop can watch
+
+/**
+ * @brief Creates the event loop and its timer
+ *
+ * This function creates the epoll instance, the timerfd used to wake the program at the next
+ * scheduled boundary and the eventfd used to report shutdown requests. The timer starts disarmed.
+ *
+ * @return Returns 0 on success, -1 if the epoll instance or the timer could not be created
+ */
+int loop_init(void); ///< Function for creating the event loop
+
+/**
+ * @brief Releases the descriptors owned by the event loop
+ */
+void loop_close(void); ///< Function for destroying the event loop
+
+/**
+ * @brief Adds a file descriptor to the set of descriptors the loop waits on
+ *
+ * @param[in] fd The file descriptor to watch for readability
+ * @param[in] event The event bit reported by loop_wait() when the descriptor becomes readable
+ *
+ * @return Returns 0 on success, -1 otherwise
+ */
+int loop_watch(int fd, uint32_t event); ///< Function for watching a file descriptor
+
+/**
+ * @brief Arms the one-shot timer
+ *
+ * The timer fires once after the given number of seconds. A negative value disarms the timer so that
+ * loop_wait() only returns on descriptor activity.
+ *
+ * @param[in] seconds Delay before the timer fires, or a negative value to disarm it
+ */
+void loop_arm(double seconds); ///< Function for arming the wakeup timer
+
+/**
+ * @brief Sets how late the deadlines armed as soft with loop_arm_deadlines() may be taken
+ *
+ * @param[in] seconds Latency budget in seconds, 0 to take every deadline on time
+ */
+void loop_set_budget(double seconds); ///< Function for setting the latency budget
+
+/**
+ * @brief Arms the one-shot timer for the next due event and the next deadline that may be late
+ *
+ * The event is waited for exactly. The soft deadline is rounded up to the next multiple of the latency budget on
+ * the monotonic clock, so soft deadlines of different sources share one wakeup. If the event comes before the
+ * rounded deadline, the timer is armed for the event and the soft deadline is taken with it. The expirations and
+ * how late the soft deadlines were taken are counted in the statistics.
+ *
+ * @param[in] event Delay before the next start or warning, or a negative value for none
+ * @param[in] soft Delay before the next deadline that may be late by the budget, or a negative value for none
+ */
+void loop_arm_deadlines(double event, double soft); ///< Function for arming the wakeup timer within the budget
+
+/**
+ * @brief Sleeps until the timer expires, a watched descriptor becomes readable or a signal handler runs
+ *
+ * If the wait fails for another reason than a signal, waiting again would fail at once, so the loop is stopped:
+ * LOOP_ERROR and LOOP_SHUTDOWN are both set, errno tells the error and loop_stopped() returns true from then on.
+ *
+ * @return Returns a mask of LOOP_* event bits describing why the loop woke up
+ */
+uint32_t loop_wait(void); ///< Function for waiting on the event loop
+
+/**
+ * @brief Sleeps for a fixed delay without spinning
+ *
+ * This function blocks for the given number of seconds, but returns early as soon as one of the descriptors added
+ * with loop_watch() becomes readable or a shutdown is requested. The wakeup timer is not considered, so a boundary
+ * reached during the delay is handled by the next loop_wait(). It may be called before loop_init(), in which case
+ * only a shutdown request ends the delay early. If the descriptors cannot be polled the rest of the delay is slept
+ * out without watching them.
+ *
+ * @param[in] seconds Delay in seconds
+ *
+ * @return Returns 0 if the full delay elapsed, otherwise a mask of the LOOP_* event bits that ended it
+ */
+uint32_t loop_sleep(double seconds); ///< Function for an interruptible delay
+
+/**
+ * @brief Requests the event loop to stop
+ *
+ * This function is async-signal-safe and meant to be called from a signal handler. Every current and future
+ * loop_wait() and loop_sleep() returns with LOOP_SHUTDOWN set.
+ */
+void loop_request_shutdown(void); ///< Function for requesting a shutdown
+
+/**
+ * @brief Checks if a shutdown has been requested
+ *
+ * @return Returns true once loop_request_shutdown() has been called, false otherwise
+ */
+bool loop_stopped(void); ///< Function for checking for a shutdown request
+
+#endif /* HEADER_EVENT_LOOP_H */
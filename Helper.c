@@ -6,186 +6,182 @@
  */
 
 #include "Helper.h"
+#include "Store.h"
+#include "EventLoop.h"
+#include "Prompt.h"
+#include "Input.h"
+#include "Render.h"
+#include "Stats.h"
+#include "Agenda.h"
 
-#define CLEAR_TERMINAL_DELAY    2   // Delay for clearing terminal screen (in seconds)
-#define INPUT_DELAY             3   // Delay for user input (in seconds)
-
-#define NONBLOCK_MODE           1   // Flag for non-blocking input mode
-#define BLOCK_MODE              0   // Flag for blocking input mode
+#define CLEAR_TERMINAL_DELAY    PROMPT_CLEAR_DELAY   // Delay for clearing terminal screen (in seconds)
 
 
 struct termios old_terminal_settings, new_terminal_settings;  // Structs for old and new terminal settings
 int old_file_desc_flag, new_file_desc_flag;    // Flags for old and new file descriptor
 Time time_info; // Struct for storing time information
-double total_time = 0.0; // Total time spent on activities
+sim_clock agenda_clock; // Simulated clock driving the agenda
+answer_fn scripted_answer = NULL; // Answers the prompts instead of stdin when set
+done_hook on_done = { NULL, NULL }; // Told about every activity the user marks as done
+reminder_hook on_reminder = { NULL, NULL }; // Told about every start and warning announced
+answer_hook on_answer = { NULL, NULL }; // Told about every answer to a question
+string_pool activity_names = { 0 }; // Names of all activities, the names of the built-in agenda come first
+
+// Define struct for what the handling of an input line needs
+typedef struct {
+    activity_store* s; // Activity store the queries look into
+    Time* time_info; // Current time information
+} input_context;
+
+
+void activity_names_init(void) {
+    // The pool only ever grows, so an empty pool has not been prepared yet
+    if (activity_names.count) {
+        return;
+    }
+    for (size_t i = 0; i < default_day_count; i++) {
+        pool_intern(&activity_names, default_names[i], strlen(default_names[i]));
+    }
+}
+
+
+uint32_t name_intern(const char* name, size_t len) {
+    activity_names_init();
+    return pool_intern(&activity_names, name, len);
+}
 
 
 /**
  * @brief Delays program execution for the given number of seconds.
  *
- * This function delays program execution for the given number of seconds by using a busy loop.
+ * This function blocks in the event loop instead of spinning, so the CPU stays idle during the delay. The delay
+ * ends early when the user types something or a shutdown is requested. On a virtual clock the delay only
+ * advances the clock.
  *
  * @param[in] second The number of seconds to delay program execution.
  */
 static void delay_time(int second) {
-    // Converting time into microseconds
-    int mikro_seconds = 1000000 * second;
-
-    // Storing start time
-    clock_t start_time = clock();
-
-    // Looping until required time is not achieved
-    while (clock() < start_time + mikro_seconds)
-        ;
+    if (agenda_clock.virtual_mode) {
+        clock_advance(&agenda_clock, second * NSEC_PER_SEC);
+        return;
+    }
+    loop_sleep((double)second);
 }
 
 
 /**
  * @brief Clears the terminal screen.
  *
- * This function clears the terminal screen by printing an escape sequence to the console.
+ * This function removes the messages from the frame once the delay is over, the next frame is drawn without them.
  */
 static void clear_terminal(void) {
     delay_time(CLEAR_TERMINAL_DELAY);
-    printf("\033[2J");  // Escape sequence to clear terminal
-    printf("\033[%d;%dH\n", 0, 0);  // Set cursor position to top-left corner
+    render_clear();
 }
 
 
 /**
- * @brief Sets the input mode for the terminal.
+ * @brief Function to check if a time is within an activity's scheduled time
  *
- * This function sets the input mode for the terminal to either non-blocking or blocking mode.
+ * This function takes an activity and a time as minutes since midnight. It returns true if the time is within
+ * the activity's scheduled time, otherwise it returns false.
+ *
+ * @param[in] a Pointer to the activity to check
+ * @param[in] minute Minute of the day to check
  *
- * @param[in] mode The input mode to set for the terminal.
+ * @return Returns true if the time is within the activity's scheduled time, false otherwise
  */
-static void input_mode(int mode) {
-    if (mode) {
-        tcsetattr(STDIN_FILENO, TCSANOW, &new_terminal_settings);
-        fcntl(STDIN_FILENO, F_SETFL, new_file_desc_flag | O_NONBLOCK);
-    }
-    else {
-        tcsetattr(STDIN_FILENO, TCSANOW, &old_terminal_settings);
-        fcntl(STDIN_FILENO, F_SETFL, old_file_desc_flag);
-    }
+int is_activity_time(const activity* a, int minute) {
+    return atime_minutes(&a->start_time) <= minute && minute < atime_minutes(&a->end_time);
 }
 
 
 
 /**
- * @brief Function to check if the current time is within an activity's scheduled time
+ * @brief Decodes a query of a known length
  *
- * This function takes an activity and a pointer to a tm structure representing the current time.
- * It returns true if the current time is within the activity's scheduled time, otherwise it returns false.
+ * The query is checked and decoded in the same pass, without sscanf() and without looking at the locale.
  *
- * @param[in] a Pointer to the activity to check
- * @param[in] t Pointer to a tm structure representing the current time
+ * @param[in] p First character of the query
+ * @param[in] len Number of characters, without a newline or terminator
+ * @param[in] now Minute of the day "now" stands for
  *
- * @return Returns true if the current time is within the activity's scheduled time, false otherwise
+ * @return Returns the minute of the day the query asks about, or -1 if it is not "now" or "HH:MM"
  */
-static int is_activity_time(activity* a, struct tm* t) {
-    // Check if current hour is within the activity's start and end hour
-    if (a->start_time.hour < t->tm_hour && a->end_time.hour > t->tm_hour) {
-        return true;
+static int decode_query(const char* p, size_t len, int now) {
+    if (len == 3) {
+        return p[0] == 'n' && p[1] == 'o' && p[2] == 'w' ? now : -1;
     }
-    // Check if current hour is the same as the activity's start hour, and if current minute is within the activity's start and end minute
-    else if (a->start_time.hour == t->tm_hour) {
-        if (a->start_time.minute <= t->tm_min && a->end_time.minute > t->tm_min) {
-            return true;
-        }
-        // Check if the activity ends after the current time, but the start minute has already passed
-        if (a->end_time.hour > t->tm_hour && a->start_time.minute <= t->tm_min) {
-            return true;
-        }
+    if (len != 5 || p[2] != ':') {
+        return -1;
     }
-    // Check if current hour is the same as the activity's end hour, and if current minute is before the activity's end minute
-    else if (a->end_time.hour == t->tm_hour) {
-        if (a->end_time.minute > t->tm_min) {
-            return true;
-        }
+
+    unsigned h1 = (unsigned)(p[0] - '0'), h2 = (unsigned)(p[1] - '0');
+    unsigned m1 = (unsigned)(p[3] - '0'), m2 = (unsigned)(p[4] - '0');
+    if (h1 > 9 || h2 > 9 || m1 > 5 || m2 > 9) {
+        return -1;
     }
-    // Current time is not within activity time
-    return false;
+
+    int hour = (int)(h1 * 10 + h2);
+    return hour < 24 ? hour * 60 + (int)(m1 * 10 + m2) : -1;
 }
 
 
+int parse_query(const char* input, int now) {
+    // A query is never longer than five characters, so there is no need to measure the whole line
+    return decode_query(input, strnlen(input, 6), now);
+}
+
+
+size_t parse_queries(const char* text, size_t len, int now, int* minutes, size_t capacity) {
+    const char* end = text + len;
+    size_t count = 0;
+
+    while (text < end && count < capacity) {
+        const char* newline = memchr(text, '\n', (size_t)(end - text));
+        const char* line_end = newline ? newline : end;
+        size_t line_len = (size_t)(line_end - text);
+
+        if (line_len && text[line_len - 1] == '\r') {
+            line_len--;
+        }
+        minutes[count++] = decode_query(text, line_len, now);
+        text = newline ? newline + 1 : end;
+    }
+    return count;
+}
+
 
 /**
  * @brief Checks if the input string represents a valid time format (HH:MM)
  *
- * This function takes a string input and checks if it represents a valid time format in the
+ * This function takes a string input and checks if it is "now" or represents a valid time format in the
  * form of "HH:MM", where HH is the hour (00-23) and MM is the minute (00-59).
  *
  * @param[in] input Pointer to the string to check for valid time format
  *
  * @return Returns 1 if the input represents a valid time format, otherwise returns 0
  */
-static int check_input(char* input) {
-    int hour, minute;
-
-    // Check if input is "now"
-    if (strcmp(input, "now") == 0) {
-        return 1;
-    }
-
-    // Check if input is not in the format of "HH:MM"
-    if (strlen(input) != 5 || input[2] != ':') {
-        return 0;
-    }
-
-    // Try to parse the input into hour and minute integers
-    if (sscanf(input, "%d:%d", &hour, &minute) != 2) {
-        return 0;
-    }
-
-    // Check if hour and minute integers are within valid range
-    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
-        return 0;
-    }
-
-    // Input represents a valid time format
-    return 1;
+int check_input(const char* input) {
+    return parse_query(input, 0) >= 0;
 }
 
 
 
 /**
- * @brief Function to prompt the user if they are doing the given activity now
- *
- * This function takes a pointer to an activity and prompts the user if they are currently
- * doing the activity. If the activity is already marked as done, it will not prompt the user
- * and will display a message saying that the activity is already done.
+ * @brief Function to ask the user if they are doing the given activity now
  *
- * @param[in,out] a Pointer to the activity to check if it is being done now
+ * This function takes a pointer to an activity and queues the question whether the user is currently doing it.
+ * The question is asked by the prompt queue once the questions before it are answered, so this function returns
+ * right away. An activity already marked as done is not asked about again.
  *
- * @return Returns 0 if the activity is marked as done or the user confirms they are doing it now,
- * otherwise returns 1
+ * @param[in,out] a Pointer to the activity to ask about
+ * @param[in] kind PROMPT_REMINDER for a start or warning, PROMPT_QUERY for a query of the user
  */
-static int activity_time(activity* a) {
-    if (!a->done) {
-        input_mode(BLOCK_MODE);
-        // Wait for user input
-        char user_input[MAX_LENGTH];
-        delay_time(INPUT_DELAY);
-        do {
-            printf("Are you doing %s now? (yes/no)\t", a->name);
-            scanf("%s", user_input);
-        } while ((!!strcmp(user_input, "yes") + !!strcmp(user_input, "no")) != 1);
-        input_mode(NONBLOCK_MODE);
-        // Set activity as done if user confirms
-        if (strcmp(user_input, "yes") == 0) {
-            a->done = 1;
-            printf("%s marked as done.\n", a->name);
-            clear_terminal();
-            return 0;
-        }
-        clear_terminal();
+static void activity_time(activity* a, prompt_kind kind) {
+    if (prompt_push(&prompts, a, kind)) {
+        perror("prompt");
     }
-    else {
-        printf("Chill, you've already done: %s\n", a->name);
-        clear_terminal();
-    }
-    return 1;
 }
 
 
@@ -194,40 +190,59 @@ static int activity_time(activity* a) {
  * @brief Parse user input and check if there is an activity scheduled for the given time
  *
  * This function takes an activity array and a Time struct as input, along with a user input string
- * representing a specific time. It checks if any activities are scheduled for the given time and
- * prompts the user to mark the activity as done if there is one. If there are no activities
- * scheduled, it prints a message indicating so.
+ * representing a specific time. The input is decoded with parse_query() and handed to answer_query().
  *
- * @param[in,out] a Activity array
+ * @param[in,out] s Activity store
  * @param[in,out] time_info Time struct containing current time information
  * @param[in] input User input representing a specific time
  */
-static void parse_time(activity* a, Time* time_info, char* input) {
-    static struct tm* t_local;
-    int activity_status = 1;
-
-    // Get local time
-    t_local = localtime(&time_info->current_time);
+void parse_time(activity_store* s, Time* time_info, const char* input) {
+    int minute = parse_query(input, tm_minutes(time_info->local_time));
 
-    // If input is not "now", parse hour and minute from input string
-    if (strcmp(input, "now")) {
-        sscanf(input, "%d:%d", &t_local->tm_hour, &t_local->tm_min);
+    if (minute >= 0) {
+        answer_query(s, minute);
     }
+}
+
+
+/**
+ * @brief Check if there is an activity scheduled for the given minute
+ *
+ * This function checks if any activities are scheduled for the given minute and prompts the user to mark the
+ * activity as done if there is one. If there are no activities scheduled, it prints a message indicating so.
+ *
+ * @param[in,out] s Activity store
+ * @param[in] minute Minute of the day decoded by parse_query()
+ */
+void answer_query(activity_store* s, int minute) {
+    int activity_status = 1;
 
-    // Loop through activity array and check if there is an activity scheduled for the given time
-    for (int8_t i = MAX_ACTIVITIES - 1; i >= 0; i--) {
-        if (is_activity_time(&a[i], t_local)) {
-            printf("Time for %s\n", a[i].name);
-            activity_time(&a[i]);
+    // Look up the activities in progress at the given time, or loop through the store if it is not indexed
+    if (s->occupancy) {
+        const minute_slot* slot = minute_table_at(s->occupancy, minute);
+        for (uint32_t k = slot->count; k-- > 0;) {
+            render_message("Time for %s", activity_name(&s->items[slot->items[k]]));
+            activity_time(&s->items[slot->items[k]], PROMPT_QUERY);
             activity_status = 0;
         }
     }
+    else {
+        for (size_t i = s->count; i-- > 0;) {
+            if (is_activity_time(&s->items[i], minute)) {
+                render_message("Time for %s", activity_name(&s->items[i]));
+                activity_time(&s->items[i], PROMPT_QUERY);
+                activity_status = 0;
+            }
+        }
+    }
 
     // If no activity is scheduled for the given time, print a message indicating so
     if (activity_status) {
-        printf("There is no activity to do.\n");
+        render_message("There is no activity to do.");
+    }
+    if (prompt_push(&prompts, NULL, PROMPT_CLEAR)) {
+        perror("prompt");
     }
-    clear_terminal();
 }
 
 
@@ -236,56 +251,51 @@ static void parse_time(activity* a, Time* time_info, char* input) {
 /**
  * @brief Gets user input for speed factor
  *
- * This function prompts the user to input a speed factor between 1 and 30,
+ * This function prompts the user to input a speed factor between 1 and MAX_SPEED_FACTOR,
  * which determines how many times faster the program should run. It repeatedly
  * asks for input until a valid speed factor is entered.
  *
  * @param[in,out] speed_factor Pointer to integer variable to store speed factor
  */
 void get_speed_factor(int* speed_factor) {
-    char input[20] = { '\0' };
+    input_line line;
 
     // Repeat prompt until valid input is entered
     do {
-        printf("How many times would you like to speed it up? (1...30)\t");
-        scanf("%s", input);
-        *speed_factor = atoi(input);
-    } while (!(*speed_factor > 0 && *speed_factor <= 30));
+        render_prompt("How many times would you like to speed it up? (1...%d)", MAX_SPEED_FACTOR);
+        render_flush();
+        // Fall back to real time when stdin is closed or the program is asked to stop
+        if (!input_wait(&stdin_reader, &line)) {
+            *speed_factor = 1;
+            return;
+        }
+        *speed_factor = atoi(line.text);
+        render_input_seen();
+    } while (!(*speed_factor > 0 && *speed_factor <= MAX_SPEED_FACTOR));
 
+    render_prompt("%s", "");
     clear_terminal();
 }
 
 
 
 /**
- * @brief Gets the current local time and adjusts it by the total time elapsed
+ * @brief Gets the current simulated local time
  *
- * This function retrieves the current local time and adjusts it by the total time elapsed
- * since the timer started. It also stores the current time and the local time in the
- * Time struct.
+ * This function reads the simulated clock and converts it into local time. The conversion is only redone when the
+ * minute changes. It also stores the current time and the local time in the Time struct. The clock has to be
+ * started with clock_start() before the first call.
  *
  * @param[in,out] time_info Pointer to the Time struct containing time information
  *
- * @return Returns a pointer to the struct tm containing the adjusted local time
+ * @return Returns a pointer to the struct tm containing the simulated local time
  */
 struct tm* get_time(Time* time_info) {
-    // Flag to get the current time only once
-    static int get_current_time_flag = 0;
-
-    // Get the current time only once
-    if (!get_current_time_flag) {
-        time(&time_info->current_time);
-        get_current_time_flag = 1;
-    }
-
-    // Adjust the current time by the total time elapsed
-    if (total_time >= 1) {
-        time_info->current_time += total_time;
-        total_time = 0.0;
-    }
+    // Read the simulated time
+    time_info->current_time = clock_now(&agenda_clock);
 
-    // Get the local time
-    time_info->local_time = localtime(&time_info->current_time);
+    // Get the local time, reusing the conversion of the current minute
+    time_info->local_time = time_cache_get(&time_info->cache, time_info->current_time);
 
     // Return a pointer to the struct tm containing the local time
     return time_info->local_time;
@@ -321,6 +331,42 @@ void do_terminal_setting(void) {
 
 
 
+/**
+ * @brief Announces that an activity starts now
+ *
+ * This function prints a message indicating that it is time for the activity and calls the activity_time() function
+ * to ask the user whether they are doing it.
+ *
+ * @param[in,out] a Pointer to the activity that starts
+ */
+void announce_start(activity* a) {
+    render_message("Time for %s", activity_name(a));
+    if (on_reminder.fn) {
+        on_reminder.fn(on_reminder.ctx, a, true);
+    }
+    activity_time(a, PROMPT_REMINDER);
+}
+
+
+/**
+ * @brief Reminds the user that an activity ends soon
+ *
+ * This function prints a reminder for an activity that is still in progress and calls the activity_time() function
+ * to ask the user whether they are doing it. The reminder is normally given 10 minutes before the end, but a
+ * reminder caught up after a stall tells the time that is actually left.
+ *
+ * @param[in,out] a Pointer to the activity that ends soon
+ * @param[in] minutes_left Minutes until the activity ends
+ */
+void announce_warning(activity* a, int minutes_left) {
+    render_message("Don't forget to do %s in %d minute%s!", activity_name(a), minutes_left, minutes_left == 1 ? "" : "s");
+    if (on_reminder.fn) {
+        on_reminder.fn(on_reminder.ctx, a, false);
+    }
+    activity_time(a, PROMPT_REMINDER);
+}
+
+
 /**
  * @brief Check if an activity is scheduled for a given datetime
  *
@@ -329,37 +375,34 @@ void do_terminal_setting(void) {
  * If the activity is scheduled for the given time, the function prints a message indicating that it is time for the
  * activity and calls the activity_time() function to display its details.
  *
- * The function uses a static flag to keep track of which activities have been checked at least once during the current
- * minute. This is done to avoid printing the "Time for activity" message multiple times for the same activity during
- * the same minute.
+ * The function uses a bitset of the store to keep track of which activities have been checked at least once during
+ * the current minute. This is done to avoid printing the "Time for activity" message multiple times for the same
+ * activity during the same minute.
  *
- * @param[in] a Pointer to the activity to check
- * @param[in] i Index of the activity in the schedule
+ * @param[in,out] s Pointer to the activity store
+ * @param[in] i Index of the activity in the store
  * @param[in] t Pointer to the time struct to check against
  *
  * @return 1 if the activity is scheduled for the given time, 0 otherwise
  */
-int is_scheduled(activity* a, int i, struct tm* t) {
-    static int previous_min;
-    static int check_flags = 0;
+int is_scheduled(activity_store* s, size_t i, struct tm* t) {
+    activity* a = &s->items[i];
     int return_val = 0;
 
-    if (!previous_min)
-        previous_min = t->tm_min;
+    // Forget the activities checked during the previous minute before checking this one
+    if (t->tm_min != s->started_minute) {
+        bitset_reset(&s->started);
+        s->started_minute = t->tm_min;
+    }
 
-    if (!((check_flags >> i) & 1U) && a->start_time.hour == t->tm_hour && a->start_time.minute == t->tm_min) {
-        printf("Time for %s\n", a->name);
-        activity_time(a);
+    if (!bitset_test(&s->started, i) && atime_minutes(&a->start_time) == tm_minutes(t)) {
+        announce_start(a);
         return_val = 1;
     }
     else {
         return_val = 0;
     }
-    check_flags |= 1UL << i;
-    if (t->tm_min != previous_min) {
-        check_flags = 0;
-        previous_min = t->tm_min;
-    }
+    bitset_set(&s->started, i);
     return return_val;
 }
 
@@ -369,72 +412,118 @@ int is_scheduled(activity* a, int i, struct tm* t) {
  *
  * This function checks if the given activity is due to be completed within the next 10 minutes.
  *
- * @param[in] a Pointer to the activity to check
- * @param[in] i Index of the activity in the activities array
+ * @param[in,out] s Pointer to the activity store
+ * @param[in] i Index of the activity in the store
  * @param[in] t Pointer to the struct tm representing the current time
  *
  * @return Returns 1 if the activity is due soon, 0 otherwise
  */
-int is_due_soon(activity* a, int i, struct tm* t) {
-    static int previous_min;
-    static int check_flags = 0;
+int is_due_soon(activity_store* s, size_t i, struct tm* t) {
+    activity* a = &s->items[i];
     int return_val;
 
-    if (!previous_min)
-        previous_min = t->tm_min;
+    // Forget the activities checked during the previous minute before checking this one
+    if (t->tm_min != s->warned_minute) {
+        bitset_reset(&s->warned);
+        s->warned_minute = t->tm_min;
+    }
 
-    if (!((check_flags >> i) & 1U) && is_activity_time(a, t) && ((a->end_time.hour == t->tm_hour && a->end_time.minute - \
-        t->tm_min == 10) || (a->end_time.hour == (t->tm_hour + 1) && (a->end_time.minute + 60) - t->tm_min == 10))) {
-        printf("Don't forget to do %s in 10 minutes!\n", a->name);
-        activity_time(a);
+    if (!bitset_test(&s->warned, i) && store_in_progress(s, i, tm_minutes(t)) && \
+        atime_minutes(&a->end_time) - tm_minutes(t) == WARNING_MINUTES) {
+        announce_warning(a, WARNING_MINUTES);
         return_val = 1;
     }
     else {
         return_val = 0;
     }
 
-    check_flags |= 1UL << i;
-    if (t->tm_min != previous_min) {
-        check_flags = 0;
-        previous_min = t->tm_min;
-    }
+    bitset_set(&s->warned, i);
     return return_val;
 }
 
 
 /**
- * @brief Reads non-blocking input from stdin and parses it for initial time input
+ * @brief Decodes a "speed N" command
  *
- * @param a Pointer to the activity being scheduled
- * @param time_info Pointer to a Time struct containing the current time
+ * @param[in] line Line typed by the user
  *
- * This function reads non-blocking input from stdin and stores it in a temporary buffer. When a newline character is
- * received, it checks the input using the check_input function. If the input is valid, the parse_time function is used to
- * extract time information from the input and store it in the provided Time struct. If the input is not valid, an error
- * message is printed to stdout. The temporary buffer is then reset for the next input.
+ * @return Returns the speed factor, or -1 if the line is not "speed" followed by a factor from 1 to MAX_SPEED_FACTOR
  */
-void get_non_blocking_inputs(activity* a, Time* time_info) {
-    static int idx = 0;
-    static char temp_buf[MAX_LENGTH] = { '\0' };
-    char buf[MAX_LENGTH] = { '\0' };
-    int n;
-
-    n = read(STDIN_FILENO, buf, sizeof(buf));
-    if (n > 0) {
-        buf[n] = '\0'; // add null terminator to the end of the input
-        strcpy(&temp_buf[idx], buf);
-        idx += n;
-        if (buf[n - 1] == '\n') {
-            temp_buf[idx - 1] = '\0';
-            if (check_input(temp_buf)) {
-                //Parse initial time input
-                parse_time(a, time_info, temp_buf);
-            }
-            else {
-                printf("Please enter a time (\"now\" or \"HH:MM\")\n");
-            }
-            memset(temp_buf, '\0', idx);
-            idx = 0;
+static int parse_speed(const char* line) {
+    int speed = 0;
+
+    if (strncmp(line, "speed ", 6) != 0) {
+        return -1;
+    }
+    line += 6;
+    while (*line == ' ') {
+        line++;
+    }
+    if (*line < '0' || *line > '9') {
+        return -1;
+    }
+    for (; *line >= '0' && *line <= '9'; line++) {
+        speed = speed * 10 + (*line - '0');
+        if (speed > MAX_SPEED_FACTOR) {
+            return -1;
         }
     }
+    return *line == '\0' && speed > 0 ? speed : -1;
+}
+
+
+/**
+ * @brief Handles one line typed by the user
+ *
+ * The line answers the open question if there is one. Otherwise it is decoded with the parse_query function and
+ * handed to the answer_query function, or it changes the speed factor, or "stats" prints the instrumentation to
+ * stderr. Anything else prints an error message. Queries are tried first, and no branch goes through sscanf().
+ *
+ * @param[in,out] ctx Pointer to the input context
+ * @param[in] line Line taken from the stdin reader
+ */
+static void handle_line(void* ctx, const input_line* line) {
+    input_context* c = ctx;
+    int speed, minute;
+
+    render_input_seen();
+    if (line->truncated) {
+        render_message("Please enter a time (\"now\" or \"HH:MM\") or \"speed N\"");
+    }
+    else if (prompt_wants_input(&prompts) && prompt_answer(&prompts, line->text)) {
+        // The line answered the open question
+    }
+    else if ((minute = parse_query(line->text, tm_minutes(c->time_info->local_time))) >= 0) {
+        // The query is decoded once and the minute goes straight to the lookup
+        int64_t started = stats_now();
+        answer_query(c->s, minute);
+        stats_add(STATS_PARSE, stats_now() - started);
+    }
+    else if ((speed = parse_speed(line->text)) > 0) {
+        // Change the speed factor without losing the time simulated so far
+        clock_set_speed(&agenda_clock, speed);
+        render_message("Running %d times faster.", speed);
+    }
+    else if (strcmp(line->text, "stats") == 0) {
+        stats_report(stderr);
+    }
+    else {
+        render_message("Please enter a time (\"now\" or \"HH:MM\") or \"speed N\"");
+    }
+}
+
+
+/**
+ * @brief Handles the lines typed since the last call
+ *
+ * @param s Pointer to the activity store
+ * @param time_info Pointer to a Time struct containing the current time
+ *
+ * This function takes every complete line the stdin reader has framed so far, in one batch, and handles them
+ * one after the other. It never blocks and costs no system call beyond clearing the reader's notification.
+ */
+void get_non_blocking_inputs(activity_store* s, Time* time_info) {
+    input_context c = { s, time_info };
+
+    input_drain(&stdin_reader, handle_line, &c);
 }
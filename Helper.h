@@ -13,9 +13,14 @@
 #include <pthread.h>
 #include <stdint.h>
 
+#include "Clock.h"
+#include "Pool.h"
+
 // Declare any constants here
-#define MAX_ACTIVITIES 10 ///< Maximum number of activities that can be scheduled
-#define MAX_LENGTH 20 ///< Maximum length of an activity name or time string
+#define MAX_LENGTH 20 ///< Length of the name kept in a journal record, names themselves have no limit
+#define MINUTES_PER_DAY 1440 ///< Number of minutes in a day
+#define WARNING_MINUTES 10 ///< How many minutes before the end of an activity the reminder is given
+#define MAX_SPEED_FACTOR 3600 ///< Highest speed factor accepted, one simulated hour per real second
 
 // Define struct for activity time
 typedef struct {
@@ -25,27 +30,103 @@ typedef struct {
 
 // Define struct for activity
 typedef struct {
-    char name[MAX_LENGTH]; ///< Name of the activity
+    uint32_t name; ///< Id of the name in activity_names, see activity_name()
     atime start_time; ///< Start time of the activity
     atime end_time; ///< End time of the activity
     int done; ///< Flag indicating if the activity has been completed
 } activity;
 
+typedef struct activity_store activity_store; ///< Growable activity store, defined in Store.h
+
 typedef struct {
     struct tm* local_time; ///< Pointer to the current local time
     time_t current_time; ///< The current system time
+    time_cache cache; ///< Cached local time conversion local_time points into
 }Time;
 
+/**
+ * @brief Callback answering "Are you doing X now?" in place of the user
+ *
+ * @param[in] a Pointer to the activity the question is about
+ *
+ * @return Returns "yes" or "no"
+ */
+typedef const char* (*answer_fn)(const activity* a);
+
+// Define struct for the callback told when the user marks an activity as done
+typedef struct {
+    void (*fn)(void* ctx, activity* a); ///< Function called with ctx and the activity, or NULL
+    void* ctx; ///< Value handed to fn
+} done_hook;
+
+// Define struct for the callback told about every reminder, next to the message on the screen
+typedef struct {
+    void (*fn)(void* ctx, const activity* a, bool start); ///< Function called with ctx, the activity and true for its start or false for its warning, or NULL
+    void* ctx; ///< Value handed to fn
+} reminder_hook;
+
+// Define struct for the callback told about every answer to a question
+typedef struct {
+    void (*fn)(void* ctx, const activity* a, bool yes, int64_t latency); ///< Function called with ctx, the activity, true for "yes" or false for "no" and the simulated nanoseconds since the question was asked, or NULL
+    void* ctx; ///< Value handed to fn
+} answer_hook;
+
+/**
+ * @brief Converts an activity time into minutes since midnight
+ *
+ * @param[in] t Pointer to the activity time to convert
+ *
+ * @return Returns the number of minutes since midnight
+ */
+static inline int atime_minutes(const atime* t) {
+    return t->hour * 60 + t->minute;
+}
+
 // Declare any global variables here
 extern struct termios old_terminal_settings, new_terminal_settings; ///< Terminal settings structs for resetting terminal settings
 extern int old_file_desc_flag, new_file_desc_flag; ///< File descriptor flags for resetting terminal settings
 extern Time time_info; ///< Struct for holding the current time information
-extern double total_time; ///< Total time elapsed since program start
+extern sim_clock agenda_clock; ///< Simulated clock driving the agenda
+extern answer_fn scripted_answer; ///< Answers the prompts instead of stdin when set, used by the simulator
+extern done_hook on_done; ///< Told about every activity the user marks as done, used to cancel its reminders
+extern reminder_hook on_reminder; ///< Told about every start and warning announced, used to send them on
+extern answer_hook on_answer; ///< Told about every "yes" or "no" to a question, used to record the history
+extern string_pool activity_names; ///< Names of all activities, every distinct name is stored once for all agendas
+
+/**
+ * @brief Interns the names of the built-in agenda, whose ids default_day uses, unless that was done already
+ *
+ * Called by store_init() and name_intern(), so the names are in place before any activity refers to them.
+ */
+void activity_names_init(void); ///< Function for preparing the shared name pool
+
+/**
+ * @brief Returns the id of an activity name, adding the name to the shared pool if it is new
+ *
+ * @param[in] name Characters of the name, not necessarily null terminated
+ * @param[in] len Number of characters
+ *
+ * @return Returns the id of the name, or POOL_INVALID_ID if memory could not be allocated
+ */
+uint32_t name_intern(const char* name, size_t len); ///< Function for interning an activity name
+
+/**
+ * @brief Returns the name of an activity without copying it
+ *
+ * The pointer stays valid until the next name is added to the pool.
+ *
+ * @param[in] a Pointer to the activity
+ *
+ * @return Returns the null terminated name
+ */
+static inline const char* activity_name(const activity* a) {
+    return pool_get(&activity_names, a->name, NULL);
+}
 
 /**
  * @brief Gets user input for speed factor
  *
- * This function prompts the user to input a speed factor between 1 and 30,
+ * This function prompts the user to input a speed factor between 1 and MAX_SPEED_FACTOR,
  * which determines how many times faster the program should run. It repeatedly
  * asks for input until a valid speed factor is entered.
  *
@@ -54,15 +135,15 @@ extern double total_time; ///< Total time elapsed since program start
 void get_speed_factor(int* speed_factor); ///< Function for getting the speed factor from user input
 
 /**
- * @brief Gets the current local time and adjusts it by the total time elapsed
+ * @brief Gets the current simulated local time
  *
- * This function retrieves the current local time and adjusts it by the total time elapsed
- * since the timer started. It also stores the current time and the local time in the
- * Time struct.
+ * This function reads the simulated clock and converts it into local time. The conversion is only redone when the
+ * minute changes. It also stores the current time and the local time in the Time struct. The clock has to be
+ * started with clock_start() before the first call.
  *
  * @param[in,out] time_info Pointer to the Time struct containing time information
  *
- * @return Returns a pointer to the struct tm containing the adjusted local time
+ * @return Returns a pointer to the struct tm containing the simulated local time
  */
 struct tm* get_time(Time* time_info); ///< Function for getting the current local time
 
@@ -77,6 +158,28 @@ struct tm* get_time(Time* time_info); ///< Function for getting the current loca
  */
 void do_terminal_setting(void); ///< Function for setting the terminal to non-canonical mode
 
+/**
+ * @brief Announces that an activity starts now
+ *
+ * This function prints a message indicating that it is time for the activity and calls the activity_time() function
+ * to ask the user whether they are doing it.
+ *
+ * @param[in,out] a Pointer to the activity that starts
+ */
+void announce_start(activity* a); ///< Function for announcing the start of an activity
+
+/**
+ * @brief Reminds the user that an activity ends soon
+ *
+ * This function prints a reminder for an activity that is still in progress and calls the activity_time() function
+ * to ask the user whether they are doing it. The reminder is normally given 10 minutes before the end, but a
+ * reminder caught up after a stall tells the time that is actually left.
+ *
+ * @param[in,out] a Pointer to the activity that ends soon
+ * @param[in] minutes_left Minutes until the activity ends
+ */
+void announce_warning(activity* a, int minutes_left); ///< Function for reminding the user of an activity that ends soon
+
 /**
  * @brief Check if an activity is scheduled for a given datetime
  *
@@ -85,42 +188,103 @@ void do_terminal_setting(void); ///< Function for setting the terminal to non-ca
  * If the activity is scheduled for the given time, the function prints a message indicating that it is time for the
  * activity and calls the activity_time() function to display its details.
  *
- * The function uses a static flag to keep track of which activities have been checked at least once during the current
- * minute. This is done to avoid printing the "Time for activity" message multiple times for the same activity during
- * the same minute.
+ * The function uses a bitset of the store to keep track of which activities have been checked at least once during
+ * the current minute. This is done to avoid printing the "Time for activity" message multiple times for the same
+ * activity during the same minute.
  *
- * @param[in] a Pointer to the activity to check
- * @param[in] i Index of the activity in the schedule
+ * @param[in,out] s Pointer to the activity store
+ * @param[in] i Index of the activity in the store
  * @param[in] t Pointer to the time struct to check against
  *
  * @return 1 if the activity is scheduled for the given time, 0 otherwise
  */
-int is_scheduled(activity* a, int i, struct tm* t); ///< Function for checking if an activity is scheduled at the current time
+int is_scheduled(activity_store* s, size_t i, struct tm* t); ///< Function for checking if an activity is scheduled at the current time
 
 /**
  * @brief Checks if an activity is due soon
  *
  * This function checks if the given activity is due to be completed within the next 10 minutes.
  *
- * @param[in] a Pointer to the activity to check
- * @param[in] i Index of the activity in the activities array
+ * @param[in,out] s Pointer to the activity store
+ * @param[in] i Index of the activity in the store
  * @param[in] t Pointer to the struct tm representing the current time
  *
  * @return Returns 1 if the activity is due soon, 0 otherwise
  */
-int is_due_soon(activity* a, int i, struct tm* t); ///< Function for checking if an activity is due to start in 10 minutes
+int is_due_soon(activity_store* s, size_t i, struct tm* t); ///< Function for checking if an activity is due to start in 10 minutes
+
+/**
+ * @brief Checks if a minute of the day is within an activity's scheduled time
+ *
+ * @param[in] a Pointer to the activity to check
+ * @param[in] minute Minute of the day to check
+ *
+ * @return Returns true if the minute is within the activity's scheduled time, false otherwise
+ */
+int is_activity_time(const activity* a, int minute); ///< Function for checking if an activity is in progress at a minute
+
+/**
+ * @brief Checks if the input string is "now" or a valid time (HH:MM)
+ *
+ * @param[in] input Pointer to the string to check
+ *
+ * @return Returns 1 if the input is valid, otherwise returns 0
+ */
+int check_input(const char* input); ///< Function for validating a query
+
+/**
+ * @brief Checks and decodes a query in a single pass
+ *
+ * @param[in] input Query typed by the user, "now" or "HH:MM" with HH from 00 to 23 and MM from 00 to 59
+ * @param[in] now Current minute of the day, returned for "now"
+ *
+ * @return Returns the minute of the day the query asks about, or -1 if the query is invalid
+ */
+int parse_query(const char* input, int now); ///< Function for decoding a query
+
+/**
+ * @brief Decodes a stream of queries, one per line, like a scripted command log
+ *
+ * The lines end with '\n' or "\r\n" and the text does not have to be null terminated.
+ *
+ * @param[in] text Lines to decode
+ * @param[in] len Number of characters in text
+ * @param[in] now Current minute of the day, stored for "now"
+ * @param[out] minutes Minute of each line, -1 for an invalid line
+ * @param[in] capacity Number of entries minutes has room for
+ *
+ * @return Returns the number of lines decoded
+ */
+size_t parse_queries(const char* text, size_t len, int now, int* minutes, size_t capacity); ///< Function for decoding many queries
+
+/**
+ * @brief Announces the activities in progress at a minute of the day and asks about each of them
+ *
+ * @param[in,out] s Activity store
+ * @param[in] minute Minute returned by parse_query()
+ */
+void answer_query(activity_store* s, int minute); ///< Function for answering a decoded query
+
+/**
+ * @brief Decodes a query with parse_query() and answers it with answer_query(), ignoring invalid ones
+ *
+ * @param[in,out] s Activity store
+ * @param[in,out] time_info Time struct containing current time information
+ * @param[in] input Query typed by the user
+ */
+void parse_time(activity_store* s, Time* time_info, const char* input); ///< Function for answering a query
 
 /**
- * @brief Reads non-blocking input from stdin and parses it for initial time input
+ * @brief Handles the lines typed since the last call
  *
- * @param a Pointer to the activity being scheduled
+ * @param s Pointer to the activity store
  * @param time_info Pointer to a Time struct containing the current time
  *
- * This function reads non-blocking input from stdin and stores it in a temporary buffer. When a newline character is
- * received, it checks the input using the check_input function. If the input is valid, the parse_time function is used to
- * extract time information from the input and store it in the provided Time struct. If the input is not valid, an error
- * message is printed to stdout. The temporary buffer is then reset for the next input.
+ * This function takes every complete line the stdin reader has framed so far, in one batch. A line answers the
+ * open question if there is one, otherwise it is decoded using the parse_query function and handed to the
+ * answer_query function, or changes the speed factor. If the input is not valid, an error message is printed to
+ * stdout. The reader has to be started with input_start() first.
  */
-void get_non_blocking_inputs(activity* a, Time* time_info); ///< Function for getting user input in a non-blocking way
+void get_non_blocking_inputs(activity_store* s, Time* time_info); ///< Function for getting user input in a non-blocking way
 
 #endif /* HEADER_HELPER_H */
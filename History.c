@@ -0,0 +1,546 @@
+/**
+ * @file History.c
+ * @brief This file contains the compressed history of every reminder and answer, kept for adherence reports.
+ *
+ * Events are buffered column by column and written as blocks. Inside a block every column is encoded on its own:
+ * times and residents as the varint of the difference to the previous event, activities and latencies as plain
+ * varints and the kinds with two bits each. Most events take a few bytes, appending a block is a single write(),
+ * and a report that only needs some columns skips the bytes of the others without decoding them.
+ */
+
+#include "History.h"
+#include "Stats.h"
+#include "Util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HISTORY_EVENT_BYTES 31 // Longest encoding of one event over all columns, 10 + 10 + 5 + 1 + 5 bytes
+
+
+/**
+ * @brief Computes the check value of a block
+ *
+ * @param[in] b Pointer to the header
+ * @param[in] payload Encoded columns following the header
+ * @param[in] len Number of bytes of the encoded columns
+ *
+ * @return Returns the FNV-1a hash of the header fields before the check and of the columns
+ */
+static uint32_t block_check(const history_block* b, const unsigned char* payload, size_t len) {
+    return util_fnv(util_fnv(UTIL_FNV_START, b, offsetof(history_block, check)), payload, len);
+}
+
+
+/**
+ * @brief Returns the number of bytes of the encoded columns of a block
+ *
+ * @param[in] b Pointer to the header
+ *
+ * @return Returns the sum of the column sizes
+ */
+static uint64_t block_payload(const history_block* b) {
+    uint64_t len = 0;
+
+    for (int k = 0; k < HISTORY_COLUMNS; k++) {
+        len += b->sizes[k];
+    }
+    return len;
+}
+
+
+/**
+ * @brief Makes room for more events in the asked columns
+ *
+ * @param[in,out] c Pointer to the columns
+ * @param[in] count Number of events the columns need room for
+ * @param[in] columns Mask of the columns to grow
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int reserve(history_columns* c, size_t count, unsigned columns) {
+    if (count <= c->capacity) {
+        return 0;
+    }
+
+    size_t capacity = c->capacity ? c->capacity : 256;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    // Grow the columns one by one, a failure leaves the grown ones valid and the capacity unchanged
+    void** fields[HISTORY_COLUMNS] = { (void**)&c->time, (void**)&c->owner, (void**)&c->item, (void**)&c->kind,
+        (void**)&c->latency };
+    static const size_t sizes[HISTORY_COLUMNS] = { sizeof(int64_t), sizeof(uint32_t), sizeof(uint32_t),
+        sizeof(uint8_t), sizeof(uint32_t) };
+    for (int k = 0; k < HISTORY_COLUMNS; k++) {
+        if (!(columns >> k & 1)) {
+            continue;
+        }
+        void* p = realloc(*fields[k], capacity * sizes[k]);
+        if (!p) {
+            return -1;
+        }
+        *fields[k] = p;
+    }
+    c->capacity = capacity;
+    return 0;
+}
+
+
+/**
+ * @brief Releases the memory held by columns
+ *
+ * @param[in,out] c Pointer to the columns
+ */
+static void free_columns(history_columns* c) {
+    free(c->time);
+    free(c->owner);
+    free(c->item);
+    free(c->kind);
+    free(c->latency);
+    memset(c, 0, sizeof(*c));
+}
+
+
+/**
+ * @brief Appends an unsigned varint, seven bits per byte with the high bit set on every byte but the last
+ *
+ * @param[out] p Where to write
+ * @param[in] v Value
+ *
+ * @return Returns the position after the varint
+ */
+static unsigned char* put_varint(unsigned char* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+
+/**
+ * @brief Reads an unsigned varint
+ *
+ * @param[in,out] p Pointer to the position to read at, moved past the varint
+ * @param[in] end End of the column
+ * @param[out] v Pointer receiving the value
+ *
+ * @return Returns 0 on success, -1 if the varint runs past the column or is too long
+ */
+static int get_varint(const unsigned char** p, const unsigned char* end, uint64_t* v) {
+    uint64_t value = 0;
+
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*p)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *v = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Maps a signed difference to an unsigned one, small differences of either sign stay small
+ *
+ * @param[in] d Difference
+ *
+ * @return Returns the zigzag encoding of d
+ */
+static uint64_t zigzag(int64_t d) {
+    return (uint64_t)d << 1 ^ (uint64_t)(d >> 63);
+}
+
+
+/**
+ * @brief Reverts zigzag()
+ *
+ * @param[in] v Zigzag encoded difference
+ *
+ * @return Returns the difference
+ */
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+
+/**
+ * @brief Encodes the buffered events as a block into the output buffer
+ *
+ * @param[in,out] h Pointer to the history
+ *
+ * @return Returns the number of bytes of the block, 0 if memory could not be allocated
+ */
+static size_t encode(history* h) {
+    const history_columns* c = &h->buf;
+    size_t need = sizeof(history_block) + c->count * HISTORY_EVENT_BYTES;
+
+    if (need > h->out_cap) {
+        unsigned char* out = realloc(h->out, need);
+        if (!out) {
+            return 0;
+        }
+        h->out = out;
+        h->out_cap = need;
+    }
+
+    history_block b;
+    memset(&b, 0, sizeof(b));
+    b.magic = HISTORY_MAGIC;
+    b.count = (uint32_t)c->count;
+    b.base = c->time[0];
+
+    unsigned char* payload = h->out + sizeof(b);
+    unsigned char* p = payload;
+    unsigned char* start = p;
+    int64_t prev_time = b.base;
+    for (size_t i = 0; i < c->count; i++) {
+        p = put_varint(p, zigzag(c->time[i] - prev_time));
+        prev_time = c->time[i];
+    }
+    b.sizes[HISTORY_TIME] = (uint32_t)(p - start);
+
+    start = p;
+    int64_t prev_owner = 0;
+    for (size_t i = 0; i < c->count; i++) {
+        p = put_varint(p, zigzag((int64_t)c->owner[i] - prev_owner));
+        prev_owner = c->owner[i];
+    }
+    b.sizes[HISTORY_OWNER] = (uint32_t)(p - start);
+
+    start = p;
+    for (size_t i = 0; i < c->count; i++) {
+        p = put_varint(p, c->item[i]);
+    }
+    b.sizes[HISTORY_ITEM] = (uint32_t)(p - start);
+
+    start = p;
+    memset(p, 0, (c->count + 3) / 4);
+    for (size_t i = 0; i < c->count; i++) {
+        p[i / 4] |= (unsigned char)((c->kind[i] & 3) << (i % 4 * 2));
+    }
+    p += (c->count + 3) / 4;
+    b.sizes[HISTORY_KIND] = (uint32_t)(p - start);
+
+    start = p;
+    for (size_t i = 0; i < c->count; i++) {
+        p = put_varint(p, c->latency[i]);
+    }
+    b.sizes[HISTORY_LATENCY] = (uint32_t)(p - start);
+
+    b.check = block_check(&b, payload, (size_t)(p - payload));
+    memcpy(h->out, &b, sizeof(b));
+    return (size_t)(p - h->out);
+}
+
+
+/**
+ * @brief Decodes the asked columns of a block
+ *
+ * @param[in] b Pointer to the header
+ * @param[in] payload Encoded columns
+ * @param[in] columns Mask of the columns to decode
+ * @param[in,out] c Pointer to the columns receiving the events
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+static int decode(const history_block* b, const unsigned char* payload, unsigned columns, history_columns* c) {
+    if (reserve(c, b->count, columns)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    c->count = b->count;
+
+    const unsigned char* p = payload;
+    uint64_t v;
+    for (int k = 0; k < HISTORY_COLUMNS; k++) {
+        const unsigned char* end = p + b->sizes[k];
+
+        if (!(columns >> k & 1)) {
+            p = end;
+            continue;
+        }
+        if (k == HISTORY_KIND) {
+            if (b->sizes[k] != (b->count + 3) / 4) {
+                errno = EILSEQ;
+                return -1;
+            }
+            for (size_t i = 0; i < b->count; i++) {
+                c->kind[i] = (uint8_t)(p[i / 4] >> (i % 4 * 2) & 3);
+            }
+            p = end;
+            continue;
+        }
+
+        int64_t prev = k == HISTORY_TIME ? b->base : 0;
+        for (size_t i = 0; i < b->count; i++) {
+            if (get_varint(&p, end, &v)) {
+                errno = EILSEQ;
+                return -1;
+            }
+            if (k == HISTORY_TIME) {
+                prev += unzigzag(v);
+                c->time[i] = prev;
+            }
+            else if (k == HISTORY_OWNER) {
+                prev += unzigzag(v);
+                c->owner[i] = (uint32_t)prev;
+            }
+            else if (k == HISTORY_ITEM) {
+                c->item[i] = (uint32_t)v;
+            }
+            else {
+                c->latency[i] = (uint32_t)v;
+            }
+        }
+        if (p != end) {
+            errno = EILSEQ;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Reads as many bytes as asked unless the file ends first
+ *
+ * @param[in] fd Descriptor to read from
+ * @param[out] buf Where to read to
+ * @param[in] len Number of bytes
+ *
+ * @return Returns the number of bytes read, -1 with errno set on an error
+ */
+static ssize_t read_full(int fd, void* buf, size_t len) {
+    size_t got = 0;
+
+    while (got < len) {
+        ssize_t n = read(fd, (char*)buf + got, len - got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    return (ssize_t)got;
+}
+
+
+void history_init(history* h) {
+    memset(h, 0, sizeof(*h));
+    h->fd = -1;
+}
+
+
+int history_open(history* h, const char* path) {
+    struct stat st;
+    history_block b;
+
+    history_init(h);
+    h->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (h->fd < 0) {
+        return -1;
+    }
+    if (fstat(h->fd, &st)) {
+        history_close(h);
+        return -1;
+    }
+
+    // Every block is checked, the first one that is torn or garbled ends what a scan can read
+    uint64_t size = (uint64_t)st.st_size;
+    uint64_t off = 0;
+    int torn = 0;
+    while (off < size) {
+        if (pread(h->fd, &b, sizeof(b), (off_t)off) != (ssize_t)sizeof(b) || b.magic != HISTORY_MAGIC
+            || block_payload(&b) > (uint64_t)b.count * HISTORY_EVENT_BYTES
+            || off + sizeof(b) + block_payload(&b) > size) {
+            torn = 1;
+            break;
+        }
+        size_t len = (size_t)block_payload(&b);
+        if (len > h->out_cap) {
+            unsigned char* out = realloc(h->out, len);
+            if (!out) {
+                history_close(h);
+                errno = ENOMEM;
+                return -1;
+            }
+            h->out = out;
+            h->out_cap = len;
+        }
+        if (pread(h->fd, h->out, len, (off_t)(off + sizeof(b))) != (ssize_t)len
+            || b.check != block_check(&b, h->out, len)) {
+            torn = 1;
+            break;
+        }
+        off += sizeof(b) + len;
+        h->blocks++;
+    }
+
+    // Cut it off with everything after it, so the blocks appended from now on stay readable
+    if (torn && ftruncate(h->fd, (off_t)off)) {
+        history_close(h);
+        return -1;
+    }
+    h->file_bytes = off;
+    return 0;
+}
+
+
+void history_close(history* h) {
+    if (h->fd >= 0) {
+        history_flush(h);
+        close(h->fd);
+    }
+    free_columns(&h->buf);
+    free(h->out);
+    history_init(h);
+}
+
+
+int history_add(history* h, int64_t time, uint32_t owner, uint32_t item, int kind, uint32_t latency) {
+    history_columns* c = &h->buf;
+
+    if (reserve(c, c->count + 1, HISTORY_ALL)) {
+        return -1;
+    }
+    c->time[c->count] = time;
+    c->owner[c->count] = owner;
+    c->item[c->count] = item;
+    c->kind[c->count] = (uint8_t)kind;
+    c->latency[c->count] = latency;
+    c->count++;
+    return 0;
+}
+
+
+int history_merge(history* into, history* from) {
+    history_columns* a = &into->buf;
+    const history_columns* b = &from->buf;
+
+    if (!b->count) {
+        return 0;
+    }
+    if (reserve(a, a->count + b->count, HISTORY_ALL)) {
+        return -1;
+    }
+    memcpy(a->time + a->count, b->time, b->count * sizeof(int64_t));
+    memcpy(a->owner + a->count, b->owner, b->count * sizeof(uint32_t));
+    memcpy(a->item + a->count, b->item, b->count * sizeof(uint32_t));
+    memcpy(a->kind + a->count, b->kind, b->count * sizeof(uint8_t));
+    memcpy(a->latency + a->count, b->latency, b->count * sizeof(uint32_t));
+    a->count += b->count;
+    from->buf.count = 0;
+    return 0;
+}
+
+
+int history_flush(history* h) {
+    if (!h->buf.count || h->fd < 0) {
+        return 0;
+    }
+
+    size_t len = encode(h);
+    if (!len) {
+        errno = ENOMEM;
+        return -1;
+    }
+    // On failure the events stay buffered and are written again with the next block
+    if (util_append(h->fd, h->out, len, (off_t)h->file_bytes, false)) {
+        return -1;
+    }
+    h->file_bytes += len;
+    h->blocks++;
+    h->events += h->buf.count;
+    h->buf.count = 0;
+    return 0;
+}
+
+
+int history_commit(history* h, int64_t now) {
+    if (h->buf.count >= HISTORY_BLOCK_EVENTS || (h->buf.count && now - h->buf.time[0] >= HISTORY_FLUSH_MS)) {
+        return history_flush(h);
+    }
+    return 0;
+}
+
+
+int history_scan(const char* path, unsigned columns, history_fn fn, void* ctx) {
+    history_columns c = { 0 };
+    history_columns view;
+    history_block b;
+    unsigned char* payload = NULL;
+    size_t payload_cap = 0;
+    int result = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    while (1) {
+        ssize_t n = read_full(fd, &b, sizeof(b));
+        if (n < (ssize_t)sizeof(b)) {
+            // A torn header at the end is left over from a crash and simply ends the history
+            result = n < 0 ? -1 : 0;
+            break;
+        }
+        uint64_t len = block_payload(&b);
+        if (b.magic != HISTORY_MAGIC || len > (uint64_t)b.count * HISTORY_EVENT_BYTES) {
+            errno = EILSEQ;
+            result = -1;
+            break;
+        }
+        if (len > payload_cap) {
+            unsigned char* p = realloc(payload, (size_t)len);
+            if (!p) {
+                errno = ENOMEM;
+                result = -1;
+                break;
+            }
+            payload = p;
+            payload_cap = (size_t)len;
+        }
+        n = read_full(fd, payload, (size_t)len);
+        if (n < (ssize_t)len) {
+            result = n < 0 ? -1 : 0;
+            break;
+        }
+        if (b.check != block_check(&b, payload, (size_t)len)) {
+            errno = EILSEQ;
+            result = -1;
+            break;
+        }
+        if (decode(&b, payload, columns, &c)) {
+            result = -1;
+            break;
+        }
+
+        // Hand out only the asked columns, the others may hold the events of an earlier block
+        view = c;
+        view.time = columns >> HISTORY_TIME & 1 ? c.time : NULL;
+        view.owner = columns >> HISTORY_OWNER & 1 ? c.owner : NULL;
+        view.item = columns >> HISTORY_ITEM & 1 ? c.item : NULL;
+        view.kind = columns >> HISTORY_KIND & 1 ? c.kind : NULL;
+        view.latency = columns >> HISTORY_LATENCY & 1 ? c.latency : NULL;
+        fn(ctx, &view);
+    }
+    int saved = errno;
+    close(fd);
+    free(payload);
+    free_columns(&c);
+    errno = saved;
+    return result;
+}
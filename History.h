@@ -0,0 +1,151 @@
+#ifndef HEADER_HISTORY_H
+#define HEADER_HISTORY_H
+
+// Include any necessary headers here
+#include <stddef.h>
+#include <stdint.h>
+
+// Declare any constants here
+#define HISTORY_START           0           ///< Kind of the event recorded when an activity starts
+#define HISTORY_WARNING         1           ///< Kind of the event recorded when an activity ends soon
+#define HISTORY_YES             2           ///< Kind of the event recorded when the user answers "yes"
+#define HISTORY_NO              3           ///< Kind of the event recorded when the user answers "no"
+#define HISTORY_MAGIC           0x31484147u ///< "GAH1", first field of every block
+#define HISTORY_BLOCK_EVENTS    4096        ///< Events buffered before a block is written
+#define HISTORY_FLUSH_MS        (15 * 60 * 1000) ///< Longest time an event stays buffered, on the clock of the events
+
+// Define the columns of the history, a scan only decodes the ones it asks for
+typedef enum {
+    HISTORY_TIME, ///< Time of the event, stored as the difference to the previous event
+    HISTORY_OWNER, ///< Resident, stored as the difference to the previous event
+    HISTORY_ITEM, ///< Index of the activity
+    HISTORY_KIND, ///< HISTORY_START to HISTORY_NO, stored with two bits per event
+    HISTORY_LATENCY, ///< Milliseconds between the question and the answer, 0 for a start or a warning
+    HISTORY_COLUMNS ///< Number of columns
+} history_column;
+
+#define HISTORY_ALL ((1u << HISTORY_COLUMNS) - 1) ///< Column mask asking for every column
+
+// Define struct for the header of a block of the file, the encoded columns follow it one after the other
+typedef struct {
+    uint32_t magic; ///< HISTORY_MAGIC
+    uint32_t count; ///< Number of events in the block
+    int64_t base; ///< Time of the first event in milliseconds since the epoch
+    uint32_t sizes[HISTORY_COLUMNS]; ///< Bytes of every encoded column
+    uint32_t check; ///< FNV-1a hash of the bytes before it and of the encoded columns, a torn block fails it
+} history_block;
+
+// Define struct for events kept column by column, in memory or as decoded from one block
+typedef struct {
+    int64_t* time; ///< Time of every event in milliseconds since the epoch
+    uint32_t* owner; ///< Resident of every event, 0 for the single agenda
+    uint32_t* item; ///< Index of the activity of every event
+    uint8_t* kind; ///< Kind of every event
+    uint32_t* latency; ///< Response latency of every event in milliseconds
+    size_t count; ///< Number of events
+    size_t capacity; ///< Number of events the columns have room for
+} history_columns;
+
+// Define the callback called for every block of a scan, columns that were not asked for are NULL
+typedef void (*history_fn)(void* ctx, const history_columns* c);
+
+// Define struct for an append-only history file and the events not written yet
+typedef struct {
+    int fd; ///< Descriptor of the file opened for appending, -1 for a buffer that is only merged into another one
+    history_columns buf; ///< Events waiting for the next block
+    unsigned char* out; ///< Encoded block being written
+    size_t out_cap; ///< Number of bytes allocated for out
+    uint64_t file_bytes; ///< Size of the file up to the last complete block
+    uint64_t blocks; ///< Number of blocks written so far
+    uint64_t events; ///< Number of events written so far
+} history;
+
+/**
+ * @brief Initializes an empty buffer without a file, used by threads that hand their events to a shared history
+ *
+ * @param[out] h Pointer to the history to initialize
+ */
+void history_init(history* h); ///< Function for creating a history buffer
+
+/**
+ * @brief Opens a history file for appending
+ *
+ * The file is created if it does not exist. Every block is checked, and a torn one at the end, left by a crash
+ * during a write, is cut off. A garbled block is cut off together with everything after it, a scan could not read
+ * past it anyway, so the blocks appended afterwards stay readable.
+ *
+ * @param[out] h Pointer to the history to open
+ * @param[in] path Path of the file
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int history_open(history* h, const char* path); ///< Function for opening a history file
+
+/**
+ * @brief Writes the buffered events and closes the file
+ *
+ * @param[in,out] h Pointer to the history
+ */
+void history_close(history* h); ///< Function for closing a history
+
+/**
+ * @brief Buffers an event, nothing is written here
+ *
+ * @param[in,out] h Pointer to the history
+ * @param[in] time Time of the event in milliseconds since the epoch
+ * @param[in] owner Resident, 0 for the single agenda
+ * @param[in] item Index of the activity
+ * @param[in] kind HISTORY_START, HISTORY_WARNING, HISTORY_YES or HISTORY_NO
+ * @param[in] latency Milliseconds between the question and the answer, 0 for a start or a warning
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int history_add(history* h, int64_t time, uint32_t owner, uint32_t item, int kind, uint32_t latency); ///< Function for recording an event
+
+/**
+ * @brief Moves the buffered events of one history to the end of another
+ *
+ * @param[in,out] into Pointer to the history receiving the events
+ * @param[in,out] from Pointer to the history giving them, left empty
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated, from is left as it was then
+ */
+int history_merge(history* into, history* from); ///< Function for combining histories
+
+/**
+ * @brief Writes the buffered events as one block with a single write()
+ *
+ * The file is not synced, a crash loses at most the last blocks and never garbles the ones before.
+ *
+ * @param[in,out] h Pointer to the history
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise, the events stay buffered then
+ */
+int history_flush(history* h); ///< Function for writing a block
+
+/**
+ * @brief Writes a block once HISTORY_BLOCK_EVENTS events are buffered or the oldest is HISTORY_FLUSH_MS old
+ *
+ * @param[in,out] h Pointer to the history
+ * @param[in] now Current time in milliseconds since the epoch
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int history_commit(history* h, int64_t now); ///< Function for writing a block when one is due
+
+/**
+ * @brief Decodes a history file block by block
+ *
+ * Only the asked columns are decoded, the others are skipped over. The scan stops at the first block that is
+ * torn or garbled.
+ *
+ * @param[in] path Path of the file
+ * @param[in] columns Mask of the columns to decode, bit 1 << HISTORY_TIME and so on, or HISTORY_ALL
+ * @param[in] fn Function called with the events of every block
+ * @param[in] ctx Value handed to fn
+ *
+ * @return Returns 0 if the whole file was read, -1 with errno set otherwise, EILSEQ for a garbled block
+ */
+int history_scan(const char* path, unsigned columns, history_fn fn, void* ctx); ///< Function for reading a history file
+
+#endif /* HEADER_HISTORY_H */
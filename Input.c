@@ -0,0 +1,231 @@
+/**
+ * @file Input.c
+ * @brief This file contains the reader thread that frames stdin into lines for the scheduler.
+ *
+ * The reader blocks on the input in its own thread, cuts it into lines and publishes them in a lock-free
+ * single-producer/single-consumer ring. It writes an eventfd once per read() that completed lines, so the event
+ * loop only wakes up for whole lines and the scheduler takes all of them in one go.
+ */
+
+#include "Input.h"
+#include "EventLoop.h"
+#include "Stats.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define INPUT_READ_SIZE     512 // Bytes read from the input at once
+#define INPUT_FULL_WAIT_MS  1   // How long the reader waits before checking a full ring again
+
+input_reader stdin_reader; // Reader of the lines typed on stdin
+
+
+/**
+ * @brief Signals the consumer that lines are waiting or the input is closed
+ *
+ * @param[in] r Pointer to the reader
+ */
+static void notify(input_reader* r) {
+    uint64_t one = 1;
+    ssize_t written = write(r->notify_fd, &one, sizeof(one));
+
+    (void)written;
+}
+
+
+/**
+ * @brief Publishes the line being framed, waiting for room if the ring is full
+ *
+ * @param[in,out] r Pointer to the reader
+ *
+ * @return Returns true on success, false if the reader was stopped while waiting
+ */
+static bool publish(input_reader* r) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    // The consumer drains the ring on every wakeup, so it is only full while the scheduler is busy
+    while (tail - atomic_load_explicit(&r->head, memory_order_acquire) == INPUT_RING_SIZE) {
+        struct pollfd stop = { .fd = r->stop_fd, .events = POLLIN };
+        if (poll(&stop, 1, INPUT_FULL_WAIT_MS) > 0) {
+            return false;
+        }
+    }
+
+    r->pending.text[r->pending.len] = '\0';
+    r->lines[tail & (INPUT_RING_SIZE - 1)] = r->pending;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    r->pending.len = 0;
+    r->pending.truncated = false;
+    return true;
+}
+
+
+/**
+ * @brief Thread function of the reader
+ *
+ * @param[in] arg Pointer to the reader
+ *
+ * @return Returns NULL
+ */
+static void* reader_main(void* arg) {
+    input_reader* r = arg;
+    struct pollfd fds[2] = {
+        { .fd = r->source_fd, .events = POLLIN },
+        { .fd = r->stop_fd, .events = POLLIN },
+    };
+    char buf[INPUT_READ_SIZE];
+
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            return NULL;
+        }
+
+        ssize_t n = read(r->source_fd, buf, sizeof(buf));
+        stats_count(STATS_READ);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        size_t published = 0;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                if (!publish(r)) {
+                    return NULL;
+                }
+                published++;
+            }
+            else if (r->pending.len < INPUT_LINE_MAX - 1) {
+                r->pending.text[r->pending.len++] = buf[i];
+            }
+            else {
+                r->pending.truncated = true;
+            }
+        }
+        if (published) {
+            notify(r);
+        }
+    }
+
+    // A last line without a newline still counts
+    if (r->pending.len && !publish(r)) {
+        return NULL;
+    }
+    atomic_store_explicit(&r->eof, true, memory_order_release);
+    notify(r);
+    return NULL;
+}
+
+
+int input_start(input_reader* r, int fd) {
+    sigset_t all, old;
+
+    memset(r, 0, sizeof(*r));
+    r->source_fd = fd;
+    r->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    r->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->notify_fd < 0 || r->stop_fd < 0) {
+        input_stop(r);
+        return -1;
+    }
+
+    // Signals have to reach the main thread, so the reader starts with all of them blocked
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int failed = pthread_create(&r->thread, NULL, reader_main, r);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (failed) {
+        input_stop(r);
+        return -1;
+    }
+    r->running = true;
+    return 0;
+}
+
+
+void input_stop(input_reader* r) {
+    if (r->running) {
+        uint64_t one = 1;
+        ssize_t written = write(r->stop_fd, &one, sizeof(one));
+        (void)written;
+        pthread_join(r->thread, NULL);
+        r->running = false;
+    }
+    if (r->notify_fd >= 0) {
+        close(r->notify_fd);
+    }
+    if (r->stop_fd >= 0) {
+        close(r->stop_fd);
+    }
+    r->notify_fd = -1;
+    r->stop_fd = -1;
+}
+
+
+int input_fd(const input_reader* r) {
+    return r->notify_fd;
+}
+
+
+size_t input_drain(input_reader* r, input_fn fn, void* ctx) {
+    uint64_t count;
+    size_t taken = 0;
+
+    // Clear the notification first, a line published from now on writes it again
+    ssize_t got = read(r->notify_fd, &count, sizeof(count));
+    (void)got;
+    stats_count(STATS_READ);
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    for (; head != tail; head++, taken++) {
+        fn(ctx, &r->lines[head & (INPUT_RING_SIZE - 1)]);
+        atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    }
+    return taken;
+}
+
+
+bool input_wait(input_reader* r, input_line* line) {
+    while (!loop_stopped()) {
+        uint64_t count;
+        ssize_t got = read(r->notify_fd, &count, sizeof(count));
+        (void)got;
+        stats_count(STATS_READ);
+
+        size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        if (head != atomic_load_explicit(&r->tail, memory_order_acquire)) {
+            *line = r->lines[head & (INPUT_RING_SIZE - 1)];
+            atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+            // The notification was cleared for every line, raise it again for the ones still in the ring
+            if (head + 1 != atomic_load_explicit(&r->tail, memory_order_acquire)) {
+                uint64_t one = 1;
+                ssize_t written = write(r->notify_fd, &one, sizeof(one));
+                (void)written;
+            }
+            return true;
+        }
+        if (atomic_load_explicit(&r->eof, memory_order_acquire)) {
+            return false;
+        }
+
+        // Interrupted by a signal, the loop condition tells if it was a shutdown request
+        struct pollfd fds = { .fd = r->notify_fd, .events = POLLIN };
+        poll(&fds, 1, -1);
+    }
+    return false;
+}
+
@@ -0,0 +1,95 @@
+#ifndef HEADER_INPUT_H
+#define HEADER_INPUT_H
+
+// Include any necessary headers here
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Declare any constants here
+#define INPUT_RING_SIZE 64  ///< Number of lines the ring holds, a power of two
+#define INPUT_LINE_MAX  256 ///< Longest line kept including the null terminator, longer lines are cut
+
+// Define struct for a line framed by the reader
+typedef struct {
+    uint32_t len; ///< Length of the line without the newline
+    bool truncated; ///< Flag indicating if the line was longer than INPUT_LINE_MAX - 1 and got cut
+    char text[INPUT_LINE_MAX]; ///< Null terminated line without the newline
+} input_line;
+
+// Define struct for the stdin reader and its single-producer/single-consumer ring
+typedef struct {
+    input_line lines[INPUT_RING_SIZE]; ///< Ring of framed lines
+    _Alignas(64) _Atomic size_t head; ///< Number of lines taken so far, only written by the consumer
+    _Alignas(64) _Atomic size_t tail; ///< Number of lines published so far, only written by the reader
+    _Atomic bool eof; ///< Set by the reader once the input is closed and every line has been published
+    int source_fd; ///< Descriptor the lines are read from
+    int notify_fd; ///< Eventfd the reader writes after publishing lines, watched by the consumer
+    int stop_fd; ///< Eventfd the consumer writes to stop the reader
+    pthread_t thread; ///< Thread running the reader
+    bool running; ///< Flag indicating if the reader thread has been started
+    input_line pending; ///< Line being framed by the reader
+} input_reader;
+
+// Define the callback called for every line taken from the ring
+typedef void (*input_fn)(void* ctx, const input_line* line);
+
+// Declare any global variables here
+extern input_reader stdin_reader; ///< Reader of the lines typed on stdin
+
+/**
+ * @brief Starts a reader thread framing the lines of a descriptor into the ring
+ *
+ * @param[out] r Pointer to the reader to start
+ * @param[in] fd Descriptor to read, it may be in blocking or non-blocking mode
+ *
+ * @return Returns 0 on success, -1 if the eventfds or the thread could not be created
+ */
+int input_start(input_reader* r, int fd); ///< Function for starting a line reader
+
+/**
+ * @brief Stops the reader thread and closes its eventfds
+ *
+ * @param[in,out] r Pointer to the reader
+ */
+void input_stop(input_reader* r); ///< Function for stopping a line reader
+
+/**
+ * @brief Returns the descriptor that becomes readable when lines are waiting or the input is closed
+ *
+ * @param[in] r Pointer to the reader
+ *
+ * @return Returns the eventfd to watch
+ */
+int input_fd(const input_reader* r); ///< Function for getting the descriptor to watch
+
+/**
+ * @brief Takes every line waiting in the ring
+ *
+ * The notification is cleared before the ring is drained, so a line published meanwhile always makes the
+ * descriptor readable again.
+ *
+ * @param[in,out] r Pointer to the reader
+ * @param[in] fn Function called for every line, in the order they were typed
+ * @param[in] ctx Value handed to fn
+ *
+ * @return Returns the number of lines taken
+ */
+size_t input_drain(input_reader* r, input_fn fn, void* ctx); ///< Function for taking the pending lines
+
+/**
+ * @brief Waits for the next line
+ *
+ * Used before the event loop runs. The wait ends early when a shutdown is requested. Lines left in the ring keep
+ * the descriptor of input_fd() readable, so the event loop picks them up without waiting for more input.
+ *
+ * @param[in,out] r Pointer to the reader
+ * @param[out] line Pointer to the line to fill
+ *
+ * @return Returns true if a line was taken, false on end of input or shutdown
+ */
+bool input_wait(input_reader* r, input_line* line); ///< Function for waiting for a line
+
+#endif /* HEADER_INPUT_H */
@@ -0,0 +1,228 @@
+/**
+ * @file Journal.c
+ * @brief This file contains the append-only log that keeps the done flags across crashes and restarts.
+ *
+ * Marking an activity as done only queues a fixed-size record in memory. The main loop commits the queue once
+ * per tick with a single write() and fdatasync(), so many completions share one flush and the prompts never
+ * wait for the disk. At startup the records of the current day are replayed, and the log is compacted into a
+ * snapshot of the current day once it holds too many records that are not needed anymore.
+ */
+
+#include "Journal.h"
+#include "Stats.h"
+#include "Util.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#define JOURNAL_READ_RECORDS 256 // Records read at once while replaying
+
+
+/**
+ * @brief Computes the check value of a record
+ *
+ * @param[in] r Pointer to the record
+ *
+ * @return Returns the FNV-1a hash of every byte before the check field
+ */
+static uint32_t record_check(const journal_record* r) {
+    return util_fnv(UTIL_FNV_START, r, offsetof(journal_record, check));
+}
+
+
+/**
+ * @brief Appends a record to the records of the current day
+ *
+ * @param[in,out] j Pointer to the journal
+ * @param[in] r Pointer to the record
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int push_today(journal* j, const journal_record* r) {
+    if (j->today_count == j->today_capacity) {
+        size_t capacity = j->today_capacity ? j->today_capacity * 2 : 64;
+        journal_record* today = realloc(j->today, capacity * sizeof(journal_record));
+        if (!today) {
+            return -1;
+        }
+        j->today = today;
+        j->today_capacity = capacity;
+    }
+    j->today[j->today_count++] = *r;
+    return 0;
+}
+
+
+int journal_open(journal* j, const char* path, uint32_t day, journal_fn fn, void* ctx) {
+    journal_record buf[JOURNAL_READ_RECORDS];
+    ssize_t n;
+
+    memset(j, 0, sizeof(*j));
+    j->day = day;
+    j->path = strdup(path);
+    if (!j->path) {
+        return -1;
+    }
+    j->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (j->fd < 0) {
+        free(j->path);
+        j->path = NULL;
+        return -1;
+    }
+
+    // Reads start at the beginning, O_APPEND only moves the writes to the end
+    int torn = 0, garbled = 0;
+    while (!torn && (n = read(j->fd, buf, sizeof(buf))) > 0) {
+        size_t count = (size_t)n / sizeof(journal_record);
+
+        for (size_t k = 0; k < count; k++) {
+            // Records have a fixed size, so the ones after a garbled record are still found and replayed
+            j->file_records++;
+            if (buf[k].check != record_check(&buf[k])) {
+                garbled = 1;
+                continue;
+            }
+            if (buf[k].day != day) {
+                continue;
+            }
+            if (push_today(j, &buf[k])) {
+                journal_close(j);
+                return -1;
+            }
+            if (fn) {
+                fn(ctx, &buf[k]);
+            }
+        }
+        torn = torn || (size_t)n % sizeof(journal_record) != 0;
+    }
+
+    // Only the last write of a crash can be incomplete, cut it off so new records stay aligned
+    if (torn && ftruncate(j->fd, (off_t)(j->file_records * sizeof(journal_record)))) {
+        journal_close(j);
+        return -1;
+    }
+    if (j->file_records > j->today_count + JOURNAL_COMPACT_SLACK || torn || garbled) {
+        journal_compact(j);
+    }
+    util_sync_dir(path);
+    return 0;
+}
+
+
+void journal_close(journal* j) {
+    if (j->fd >= 0 && j->path) {
+        journal_commit(j);
+        close(j->fd);
+    }
+    free(j->today);
+    free(j->path);
+    memset(j, 0, sizeof(*j));
+    j->fd = -1;
+}
+
+
+int journal_append(journal* j, uint32_t owner, uint32_t item, const activity* a) {
+    journal_record r;
+
+    memset(&r, 0, sizeof(r));
+    r.day = j->day;
+    r.owner = owner;
+    r.item = item;
+    r.start = (uint16_t)atime_minutes(&a->start_time);
+    r.end = (uint16_t)atime_minutes(&a->end_time);
+    // Only a prefix of the name goes to the file, enough to tell the activities apart when replaying
+    size_t len;
+    const char* name = pool_get(&activity_names, a->name, &len);
+    memcpy(r.name, name, len < MAX_LENGTH - 1 ? len : MAX_LENGTH - 1);
+    r.check = record_check(&r);
+
+    if (push_today(j, &r)) {
+        return -1;
+    }
+    j->pending++;
+    return 0;
+}
+
+
+int journal_commit(journal* j) {
+    if (!j->pending) {
+        return 0;
+    }
+
+    const journal_record* first = &j->today[j->today_count - j->pending];
+    stats_count(STATS_FSYNC);
+    // On failure the records stay queued and are written again by the next commit
+    off_t size = (off_t)(j->file_records * sizeof(journal_record));
+    if (util_append(j->fd, first, j->pending * sizeof(journal_record), size, true)) {
+        return -1;
+    }
+    j->file_records += j->pending;
+    j->pending = 0;
+    j->commits++;
+
+    if (j->file_records > j->today_count + JOURNAL_COMPACT_SLACK) {
+        journal_compact(j);
+    }
+    return 0;
+}
+
+
+int journal_new_day(journal* j, uint32_t day) {
+    // The completions of the day that ends still go to the file before they are dropped
+    int result = journal_commit(j);
+
+    j->day = day;
+    j->today_count = 0;
+    j->pending = 0;
+    return journal_compact(j) || result ? -1 : 0;
+}
+
+
+int journal_compact(journal* j) {
+    size_t committed = j->today_count - j->pending;
+    size_t len = strlen(j->path) + sizeof(".tmp");
+    char* tmp = malloc(len);
+
+    if (!tmp) {
+        return -1;
+    }
+    snprintf(tmp, len, "%s.tmp", j->path);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+    stats_count(STATS_FSYNC);
+    int failed = util_write_all(fd, j->today, committed * sizeof(journal_record)) || fdatasync(fd);
+    int saved = errno;
+    if (close(fd) && !failed) {
+        failed = 1;
+        saved = errno;
+    }
+    if (failed) {
+        unlink(tmp);
+        free(tmp);
+        errno = saved;
+        return -1;
+    }
+
+    int appender = open(tmp, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (appender < 0 || rename(tmp, j->path)) {
+        saved = errno;
+        if (appender >= 0) {
+            close(appender);
+        }
+        unlink(tmp);
+        free(tmp);
+        errno = saved;
+        return -1;
+    }
+    free(tmp);
+    util_sync_dir(j->path);
+
+    close(j->fd);
+    j->fd = appender;
+    j->file_records = committed;
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef HEADER_JOURNAL_H
+#define HEADER_JOURNAL_H
+
+// Include any necessary headers here
+#include "Helper.h"
+
+// Declare any constants here
+#define JOURNAL_COMPACT_SLACK 1024 ///< Records of past days or duplicates tolerated in the file before it is compacted
+
+// Define struct for one completion, the file is a plain sequence of these
+typedef struct {
+    uint32_t day; ///< Local day of the completion, see journal_day()
+    uint32_t owner; ///< Resident the activity belongs to, 0 for the single agenda
+    uint32_t item; ///< Index of the activity when it was completed
+    uint16_t start; ///< Start of the activity in minutes since midnight
+    uint16_t end; ///< End of the activity in minutes since midnight
+    char name[MAX_LENGTH]; ///< First MAX_LENGTH - 1 characters of the name of the activity, null padded
+    uint32_t check; ///< FNV-1a hash of the bytes before it, a torn or garbled record fails it
+} journal_record;
+
+// Define the callback called for every completion of the current day replayed from the file
+typedef void (*journal_fn)(void* ctx, const journal_record* r);
+
+// Define struct for an append-only completion log
+typedef struct {
+    int fd; ///< Descriptor of the log, opened for appending
+    char* path; ///< Path of the log, kept for compaction
+    uint32_t day; ///< Day the new records belong to
+    journal_record* today; ///< Committed records of the current day, the state a compaction writes back
+    size_t today_count; ///< Number of records in today
+    size_t today_capacity; ///< Number of records today has room for
+    size_t pending; ///< Records at the end of today that are not written yet
+    size_t file_records; ///< Number of records in the file
+    uint64_t commits; ///< Number of group commits that wrote records
+} journal;
+
+/**
+ * @brief Computes the day stored in the records for a local time
+ *
+ * @param[in] t Pointer to the local time
+ *
+ * @return Returns the year and the day of the year packed into one number
+ */
+static inline uint32_t journal_day(const struct tm* t) {
+    return (uint32_t)t->tm_year << 9 | (uint32_t)t->tm_yday;
+}
+
+/**
+ * @brief Opens a completion log and replays the completions of the given day
+ *
+ * The file is created if it does not exist. A torn record at the end, left by a crash during a write, is cut off.
+ * A garbled record is skipped and the records after it are still replayed, then the file is compacted to drop it.
+ * Records of other days are skipped and dropped by compacting the file if there are many of them.
+ *
+ * @param[out] j Pointer to the journal to open
+ * @param[in] path Path of the log
+ * @param[in] day Current day, see journal_day()
+ * @param[in] fn Function called for every completion of the day, in the order they were logged
+ * @param[in] ctx Value handed to fn
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int journal_open(journal* j, const char* path, uint32_t day, journal_fn fn, void* ctx); ///< Function for opening a completion log
+
+/**
+ * @brief Commits the pending records and closes the log
+ *
+ * @param[in,out] j Pointer to the journal
+ */
+void journal_close(journal* j); ///< Function for closing a completion log
+
+/**
+ * @brief Queues a completion for the next group commit
+ *
+ * Nothing is written here, so answering a prompt never waits for the disk.
+ *
+ * @param[in,out] j Pointer to the journal
+ * @param[in] owner Resident the activity belongs to, 0 for the single agenda
+ * @param[in] item Index of the activity
+ * @param[in] a Pointer to the activity
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int journal_append(journal* j, uint32_t owner, uint32_t item, const activity* a); ///< Function for logging a completion
+
+/**
+ * @brief Writes every queued completion with one write() and makes it durable with one fdatasync()
+ *
+ * Called once per tick of the main loop, so the completions of all agendas answered during the tick share the
+ * cost of a single flush. The log is compacted afterwards if it holds too many records that are not needed.
+ *
+ * @param[in,out] j Pointer to the journal
+ *
+ * @return Returns 0 on success or if nothing was queued, -1 with errno set otherwise, the records stay queued
+ */
+int journal_commit(journal* j); ///< Function for flushing a completion log
+
+/**
+ * @brief Starts a new day, the completions of the previous one are dropped from the log
+ *
+ * @param[in,out] j Pointer to the journal
+ * @param[in] day New day, see journal_day()
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int journal_new_day(journal* j, uint32_t day); ///< Function for moving a completion log to a new day
+
+/**
+ * @brief Rewrites the log with only the completions of the current day
+ *
+ * The snapshot is written and flushed under a temporary name, then renamed over the log, so a crash leaves
+ * either the old or the new file.
+ *
+ * @param[in,out] j Pointer to the journal
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise, the old log stays in use
+ */
+int journal_compact(journal* j); ///< Function for compacting a completion log
+
+#endif /* HEADER_JOURNAL_H */
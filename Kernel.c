@@ -0,0 +1,185 @@
+/**
+ * @file Kernel.c
+ * @brief This file contains the vectorized batch due check over packed minute arrays.
+ *
+ * Each block of 64 activities is compared against the current minute with 16 bit lane compares and the results
+ * are collapsed into one 64 bit mask. The SSE2 and AVX2 paths are chosen at runtime when the CPU supports them, so
+ * the program does not need to be built with -msse2 or -mavx2, which a 32 bit x86 build does not assume.
+ */
+
+#include "Kernel.h"
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define KERNEL_NEON
+#endif
+
+#define KERNEL_BLOCK 64 // Number of activities compared per mask word
+
+typedef uint64_t (*block_fn)(const uint16_t* v, uint16_t minute); // Compares one full block of 64 minutes
+
+static block_fn match_block;            // Block compare selected for this CPU
+static const char* match_name;          // Name of the selected block compare
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief Compares up to 64 minutes one by one
+ *
+ * @param[in] v Minute values to compare
+ * @param[in] n Number of values, at most 64
+ * @param[in] minute Minute to compare against
+ *
+ * @return Returns a mask with bit i set if v[i] equals the minute
+ */
+static uint64_t match_scalar_n(const uint16_t* v, size_t n, uint16_t minute) {
+    uint64_t mask = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        mask |= (uint64_t)(v[i] == minute) << i;
+    }
+    return mask;
+}
+
+
+/**
+ * @brief Compares a full block of 64 minutes one by one
+ *
+ * @param[in] v Minute values to compare
+ * @param[in] minute Minute to compare against
+ *
+ * @return Returns a mask with bit i set if v[i] equals the minute
+ */
+static uint64_t match_scalar(const uint16_t* v, uint16_t minute) {
+    return match_scalar_n(v, KERNEL_BLOCK, minute);
+}
+
+
+#ifdef KERNEL_X86
+/**
+ * @brief Compares a full block of 64 minutes with SSE2
+ *
+ * Two compares of eight 16 bit lanes are narrowed to sixteen bytes with a saturating pack, so one movemask yields
+ * sixteen result bits in order.
+ *
+ * @param[in] v Minute values to compare
+ * @param[in] minute Minute to compare against
+ *
+ * @return Returns a mask with bit i set if v[i] equals the minute
+ */
+__attribute__((target("sse2")))
+static uint64_t match_sse2(const uint16_t* v, uint16_t minute) {
+    __m128i key = _mm_set1_epi16((short)minute);
+    uint64_t mask = 0;
+
+    for (int j = 0; j < KERNEL_BLOCK / 16; j++) {
+        __m128i lo = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(v + 16 * j)), key);
+        __m128i hi = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(v + 16 * j + 8)), key);
+        mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(lo, hi)) << (16 * j);
+    }
+    return mask;
+}
+
+
+/**
+ * @brief Compares a full block of 64 minutes with AVX2
+ *
+ * The 256 bit pack works per 128 bit lane, so the quadwords are put back in order before the movemask.
+ *
+ * @param[in] v Minute values to compare
+ * @param[in] minute Minute to compare against
+ *
+ * @return Returns a mask with bit i set if v[i] equals the minute
+ */
+__attribute__((target("avx2")))
+static uint64_t match_avx2(const uint16_t* v, uint16_t minute) {
+    __m256i key = _mm256_set1_epi16((short)minute);
+    uint64_t mask = 0;
+
+    for (int j = 0; j < KERNEL_BLOCK / 32; j++) {
+        __m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(v + 32 * j)), key);
+        __m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(v + 32 * j + 16)), key);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(packed) << (32 * j);
+    }
+    return mask;
+}
+#endif
+
+
+#ifdef KERNEL_NEON
+/**
+ * @brief Compares a full block of 64 minutes with NEON
+ *
+ * NEON has no movemask, so every compare result byte is weighted by its bit value and summed across the vector.
+ *
+ * @param[in] v Minute values to compare
+ * @param[in] minute Minute to compare against
+ *
+ * @return Returns a mask with bit i set if v[i] equals the minute
+ */
+static uint64_t match_neon(const uint16_t* v, uint16_t minute) {
+    static const uint8_t weights[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint16x8_t key = vdupq_n_u16(minute);
+    uint8x8_t bits = vld1_u8(weights);
+    uint64_t mask = 0;
+
+    for (int j = 0; j < KERNEL_BLOCK / 8; j++) {
+        uint8x8_t eq = vmovn_u16(vceqq_u16(vld1q_u16(v + 8 * j), key));
+        mask |= (uint64_t)vaddv_u8(vand_u8(eq, bits)) << (8 * j);
+    }
+    return mask;
+}
+#endif
+
+
+/**
+ * @brief Picks the fastest block compare the CPU supports
+ */
+static void select_kernel(void) {
+    match_block = match_scalar;
+    match_name = "scalar";
+#if defined(KERNEL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        match_block = match_sse2;
+        match_name = "sse2";
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        match_block = match_avx2;
+        match_name = "avx2";
+    }
+#elif defined(KERNEL_NEON)
+    match_block = match_neon;
+    match_name = "neon";
+#endif
+}
+
+
+void kernel_due(const uint16_t* start, const uint16_t* warning, size_t n, uint16_t minute,
+    uint64_t* start_mask, uint64_t* warning_mask) {
+    size_t full = n / KERNEL_BLOCK;
+    size_t rest = n % KERNEL_BLOCK;
+
+    pthread_once(&select_once, select_kernel);
+
+    for (size_t b = 0; b < full; b++) {
+        start_mask[b] = match_block(start + b * KERNEL_BLOCK, minute);
+        warning_mask[b] = match_block(warning + b * KERNEL_BLOCK, minute);
+    }
+    if (rest) {
+        start_mask[full] = match_scalar_n(start + full * KERNEL_BLOCK, rest, minute);
+        warning_mask[full] = match_scalar_n(warning + full * KERNEL_BLOCK, rest, minute);
+    }
+}
+
+
+const char* kernel_name(void) {
+    pthread_once(&select_once, select_kernel);
+    return match_name;
+}
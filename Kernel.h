@@ -0,0 +1,35 @@
+#ifndef HEADER_KERNEL_H
+#define HEADER_KERNEL_H
+
+// Include any necessary headers here
+#include <stddef.h>
+#include <stdint.h>
+
+// Declare any constants here
+#define KERNEL_NEVER 0xFFFFU ///< Minute value that never matches, used for activities without a warning
+
+/**
+ * @brief Compares the current minute against every start and warning minute at once
+ *
+ * This function sets bit i of the start mask when start[i] equals the minute and bit i of the warning mask when
+ * warning[i] equals the minute. Both masks must hold at least (n + 63) / 64 words; bits past n are cleared.
+ * The comparison runs with AVX2 or SSE2 on x86, with NEON on AArch64 and with plain C everywhere else.
+ *
+ * @param[in] start Start minute of every activity
+ * @param[in] warning Warning minute of every activity, or KERNEL_NEVER
+ * @param[in] n Number of activities
+ * @param[in] minute Minute of the day to compare against
+ * @param[out] start_mask Bitmask receiving the activities that start at the minute
+ * @param[out] warning_mask Bitmask receiving the activities whose warning is due at the minute
+ */
+void kernel_due(const uint16_t* start, const uint16_t* warning, size_t n, uint16_t minute,
+    uint64_t* start_mask, uint64_t* warning_mask); ///< Function for the batch due check
+
+/**
+ * @brief Returns the name of the instruction set used by kernel_due()
+ *
+ * @return Returns "avx2", "sse2", "neon" or "scalar"
+ */
+const char* kernel_name(void); ///< Function for reporting the selected kernel
+
+#endif /* HEADER_KERNEL_H */
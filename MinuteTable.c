@@ -0,0 +1,119 @@
+/**
+ * @file MinuteTable.c
+ * @brief This file contains the minute-of-day bucket table used to answer "what am I doing at HH:MM" queries.
+ *
+ * Every minute of the day has a slot listing the activities in progress during that minute, so a query costs
+ * one slot lookup plus the number of activities it returns. Activities are added and removed one at a time, so
+ * the table never has to be rebuilt from scratch when the schedule changes.
+ */
+
+#include "MinuteTable.h"
+
+
+/**
+ * @brief Finds the position of an activity index in a slot
+ *
+ * @param[in] slot Pointer to the slot to search
+ * @param[in] index Index of the activity
+ *
+ * @return Returns the position of the first item that is not smaller than the index
+ */
+static uint32_t slot_lower_bound(const minute_slot* slot, uint32_t index) {
+    uint32_t low = 0, high = slot->count;
+
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (slot->items[mid] < index) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+
+/**
+ * @brief Clamps an activity interval to the minutes of a day
+ *
+ * @param[in,out] start Start of the interval in minutes since midnight
+ * @param[in,out] end End of the interval in minutes since midnight
+ */
+static void clamp_interval(int* start, int* end) {
+    if (*start < 0) {
+        *start = 0;
+    }
+    if (*end > MINUTES_PER_DAY) {
+        *end = MINUTES_PER_DAY;
+    }
+}
+
+
+void minute_table_init(minute_table* table) {
+    memset(table, 0, sizeof(*table));
+}
+
+
+void minute_table_free(minute_table* table) {
+    for (int m = 0; m < MINUTES_PER_DAY; m++) {
+        free(table->slots[m].items);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+
+int minute_table_add(minute_table* table, uint32_t index, int start, int end) {
+    clamp_interval(&start, &end);
+
+    for (int m = start; m < end; m++) {
+        minute_slot* slot = &table->slots[m];
+
+        if (slot->count == slot->capacity) {
+            uint32_t capacity = slot->capacity ? slot->capacity * 2 : 4;
+            uint32_t* items = realloc(slot->items, capacity * sizeof(uint32_t));
+            if (!items) {
+                // Undo the minutes already added so the table stays consistent
+                minute_table_remove(table, index, start, m);
+                return -1;
+            }
+            slot->items = items;
+            slot->capacity = capacity;
+        }
+
+        // Activities are usually added in ascending order, which makes this an append
+        uint32_t pos = slot_lower_bound(slot, index);
+        memmove(&slot->items[pos + 1], &slot->items[pos], (slot->count - pos) * sizeof(uint32_t));
+        slot->items[pos] = index;
+        slot->count++;
+    }
+    return 0;
+}
+
+
+void minute_table_remove(minute_table* table, uint32_t index, int start, int end) {
+    clamp_interval(&start, &end);
+
+    for (int m = start; m < end; m++) {
+        minute_slot* slot = &table->slots[m];
+        uint32_t pos = slot_lower_bound(slot, index);
+
+        if (pos < slot->count && slot->items[pos] == index) {
+            memmove(&slot->items[pos], &slot->items[pos + 1], (slot->count - pos - 1) * sizeof(uint32_t));
+            slot->count--;
+        }
+    }
+}
+
+
+bool minute_table_contains(const minute_table* table, uint32_t index, int minute) {
+    const minute_slot* slot;
+    uint32_t pos;
+
+    if (minute < 0 || minute >= MINUTES_PER_DAY) {
+        return false;
+    }
+    slot = &table->slots[minute];
+    pos = slot_lower_bound(slot, index);
+    return pos < slot->count && slot->items[pos] == index;
+}
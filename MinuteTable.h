@@ -0,0 +1,81 @@
+#ifndef HEADER_MINUTE_TABLE_H
+#define HEADER_MINUTE_TABLE_H
+
+// Include any necessary headers here
+#include "Helper.h"
+
+// Define struct for the activities in progress during one minute
+typedef struct {
+    uint32_t* items; ///< Indices of the activities in progress, in ascending order
+    uint32_t count; ///< Number of activities in progress
+    uint32_t capacity; ///< Number of indices the slot has room for
+} minute_slot;
+
+// Define struct for the minute-of-day bucket table
+typedef struct {
+    minute_slot slots[MINUTES_PER_DAY]; ///< One slot per minute of the day
+} minute_table;
+
+/**
+ * @brief Initializes an empty minute table
+ *
+ * @param[out] table Pointer to the table to initialize
+ */
+void minute_table_init(minute_table* table); ///< Function for creating a minute table
+
+/**
+ * @brief Releases the memory held by a minute table
+ *
+ * @param[in,out] table Pointer to the table to free
+ */
+void minute_table_free(minute_table* table); ///< Function for freeing a minute table
+
+/**
+ * @brief Marks an activity as in progress during every minute of its interval
+ *
+ * The activity occupies the half-open interval [start, end), which matches is_activity_time(). Activities ending
+ * before they start occupy no minute.
+ *
+ * @param[in,out] table Pointer to the table
+ * @param[in] index Index of the activity
+ * @param[in] start Start of the activity in minutes since midnight
+ * @param[in] end End of the activity in minutes since midnight
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int minute_table_add(minute_table* table, uint32_t index, int start, int end); ///< Function for inserting an activity interval
+
+/**
+ * @brief Removes an activity from every minute of its interval
+ *
+ * @param[in,out] table Pointer to the table
+ * @param[in] index Index of the activity
+ * @param[in] start Start of the activity in minutes since midnight, as given to minute_table_add()
+ * @param[in] end End of the activity in minutes since midnight, as given to minute_table_add()
+ */
+void minute_table_remove(minute_table* table, uint32_t index, int start, int end); ///< Function for removing an activity interval
+
+/**
+ * @brief Checks if an activity is in progress during a minute
+ *
+ * @param[in] table Pointer to the table
+ * @param[in] index Index of the activity
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns true if the activity is in progress, false otherwise
+ */
+bool minute_table_contains(const minute_table* table, uint32_t index, int minute); ///< Function for checking one activity
+
+/**
+ * @brief Returns the activities in progress during a minute
+ *
+ * @param[in] table Pointer to the table
+ * @param[in] minute Minute of the day (0...1439)
+ *
+ * @return Returns a pointer to the slot of that minute
+ */
+static inline const minute_slot* minute_table_at(const minute_table* table, int minute) {
+    return &table->slots[minute];
+}
+
+#endif /* HEADER_MINUTE_TABLE_H */
@@ -0,0 +1,529 @@
+/**
+ * @file Notify.c
+ * @brief This file contains the delivery of the reminders to other programs, like a pager or a push gateway.
+ *
+ * The scheduler never talks to the network. Each producer, the main loop or a server worker, collects the
+ * reminders of a tick in its own batch, where repeated lines are coalesced, and hands the batch over once per
+ * tick with a single copy under a lock. A sender thread then writes to every destination through non-blocking
+ * sockets. A slow or unreachable destination only grows its own queue up to NOTIFY_MAX_PENDING bytes, after
+ * which its reminders are dropped and counted, so the scheduler and the other destinations carry on.
+ */
+
+#include "Notify.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define NOTIFY_MIN_KEYS 64 // Initial number of slots of the coalescing set of a batch
+
+
+/**
+ * @brief Reads the monotonic clock
+ *
+ * @return Returns the time in milliseconds
+ */
+static int64_t now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/**
+ * @brief Hashes a line with 64 bit FNV-1a
+ *
+ * @param[in] line Pointer to the line
+ * @param[in] len Length of the line
+ *
+ * @return Returns the hash, never 0 so it can mark a used slot
+ */
+static uint64_t hash_line(const char* line, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)line[i]) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+
+/**
+ * @brief Adds a hash to the coalescing set of a batch
+ *
+ * @param[in,out] b Pointer to the batch
+ * @param[in] key Hash of the line
+ *
+ * @return Returns 1 if the hash was added, 0 if it was already there, -1 if memory could not be allocated
+ */
+static int add_key(notify_batch* b, uint64_t key) {
+    // Keep the set at most half full
+    if (2 * (b->key_count + 1) > b->key_slots) {
+        size_t slots = b->key_slots ? 2 * b->key_slots : NOTIFY_MIN_KEYS;
+        uint64_t* keys = calloc(slots, sizeof(uint64_t));
+        if (!keys) {
+            return -1;
+        }
+        for (size_t i = 0; i < b->key_slots; i++) {
+            if (b->keys[i]) {
+                size_t k = (size_t)b->keys[i] & (slots - 1);
+                while (keys[k]) {
+                    k = (k + 1) & (slots - 1);
+                }
+                keys[k] = b->keys[i];
+            }
+        }
+        free(b->keys);
+        b->keys = keys;
+        b->key_slots = slots;
+    }
+
+    size_t k = (size_t)key & (b->key_slots - 1);
+    while (b->keys[k]) {
+        if (b->keys[k] == key) {
+            return 0;
+        }
+        k = (k + 1) & (b->key_slots - 1);
+    }
+    b->keys[k] = key;
+    b->key_count++;
+    return 1;
+}
+
+
+/**
+ * @brief Appends bytes to a growable buffer
+ *
+ * @param[in,out] buf Pointer to the buffer
+ * @param[in,out] len Pointer to the number of bytes used
+ * @param[in,out] cap Pointer to the number of bytes allocated
+ * @param[in] data Bytes to append
+ * @param[in] n Number of bytes
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int append(char** buf, size_t* len, size_t* cap, const char* data, size_t n) {
+    if (*len + n > *cap) {
+        size_t grown = *cap ? *cap : 4096;
+        while (grown < *len + n) {
+            grown *= 2;
+        }
+        char* p = realloc(*buf, grown);
+        if (!p) {
+            return -1;
+        }
+        *buf = p;
+        *cap = grown;
+    }
+    memcpy(*buf + *len, data, n);
+    *len += n;
+    return 0;
+}
+
+
+/**
+ * @brief Counts the lines in a block of reminders
+ *
+ * @param[in] data Reminder lines
+ * @param[in] len Number of bytes
+ *
+ * @return Returns the number of newlines
+ */
+static uint64_t count_lines(const char* data, size_t len) {
+    uint64_t lines = 0;
+
+    for (const char* p = data; (p = memchr(p, '\n', (size_t)(data + len - p))); p++) {
+        lines++;
+    }
+    return lines;
+}
+
+
+/**
+ * @brief Closes the socket of a destination and schedules the next connection attempt
+ *
+ * A line that was only sent in part is dropped, the receiver would not be able to tell where the next one starts.
+ *
+ * @param[in,out] s Pointer to the destination
+ * @param[in] now Current monotonic millisecond
+ */
+static void sink_fail(notify_sink* s, int64_t now) {
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    s->fd = -1;
+    s->connecting = 0;
+    s->retry_at = now + NOTIFY_RETRY_MS;
+
+    if (s->partial) {
+        const char* end = memchr(s->queue + s->head, '\n', s->len);
+        size_t skip = end ? (size_t)(end - (s->queue + s->head)) + 1 : s->len;
+        s->head += skip;
+        s->len -= skip;
+        s->partial = 0;
+    }
+}
+
+
+/**
+ * @brief Starts a non-blocking connection to a destination
+ *
+ * @param[in,out] s Pointer to the destination
+ * @param[in] now Current monotonic millisecond
+ */
+static void sink_connect(notify_sink* s, int64_t now) {
+    if (strncmp(s->spec, "unix:", 5) == 0) {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        strcpy(addr.sun_path, s->spec + 5);
+        s->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (s->fd >= 0 && connect(s->fd, (struct sockaddr*)&addr, sizeof(addr)) && errno != EINPROGRESS) {
+            sink_fail(s, now);
+            return;
+        }
+    }
+    else {
+        // Only the sender thread resolves names, so a slow lookup delays nobody but this destination
+        char host[256];
+        const char* port = strrchr(s->spec + 4, ':');
+        size_t len = (size_t)(port - (s->spec + 4));
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+        struct addrinfo* res = NULL;
+
+        memcpy(host, s->spec + 4, len);
+        host[len] = '\0';
+        if (getaddrinfo(host, port + 1, &hints, &res)) {
+            sink_fail(s, now);
+            return;
+        }
+        s->fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+        int failed = s->fd < 0 || (connect(s->fd, res->ai_addr, res->ai_addrlen) && errno != EINPROGRESS);
+        freeaddrinfo(res);
+        if (failed) {
+            sink_fail(s, now);
+            return;
+        }
+    }
+    if (s->fd < 0) {
+        sink_fail(s, now);
+        return;
+    }
+    s->connecting = 1;
+}
+
+
+/**
+ * @brief Sends as much of the queue of a destination as its socket takes without blocking
+ *
+ * @param[in,out] s Pointer to the destination
+ * @param[in] now Current monotonic millisecond
+ */
+static void sink_write(notify_sink* s, int64_t now) {
+    if (s->fd < 0) {
+        return;
+    }
+    if (s->connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) || err) {
+            sink_fail(s, now);
+            return;
+        }
+        s->connecting = 0;
+    }
+
+    while (s->len) {
+        ssize_t n = send(s->fd, s->queue + s->head, s->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                sink_fail(s, now);
+            }
+            return;
+        }
+        s->head += (size_t)n;
+        s->len -= (size_t)n;
+        s->partial = s->queue[s->head - 1] != '\n';
+        atomic_fetch_add_explicit(&s->sent, (uint64_t)n, memory_order_relaxed);
+    }
+    s->head = 0;
+}
+
+
+/**
+ * @brief Queues reminders for a destination, or drops them if its queue is full
+ *
+ * @param[in,out] s Pointer to the destination
+ * @param[in] data Reminder lines
+ * @param[in] len Number of bytes
+ */
+static void sink_queue(notify_sink* s, const char* data, size_t len) {
+    if (s->len + len > NOTIFY_MAX_PENDING) {
+        atomic_fetch_add_explicit(&s->dropped, count_lines(data, len), memory_order_relaxed);
+        return;
+    }
+
+    // Move the unsent bytes to the front before growing
+    if (s->head) {
+        memmove(s->queue, s->queue + s->head, s->len);
+        s->head = 0;
+    }
+    if (append(&s->queue, &s->len, &s->cap, data, len)) {
+        atomic_fetch_add_explicit(&s->dropped, count_lines(data, len), memory_order_relaxed);
+    }
+}
+
+
+/**
+ * @brief Thread function of the sender
+ *
+ * @param[in] arg Pointer to the notifier
+ *
+ * @return Returns NULL
+ */
+static void* sender_main(void* arg) {
+    notifier* n = arg;
+    char* taken = NULL;
+    size_t taken_cap = 0;
+    int stopping = 0;
+
+    while (!stopping) {
+        struct pollfd fds[NOTIFY_MAX_SINKS + 1] = { { .fd = n->wake_fd, .events = POLLIN } };
+        notify_sink* polled[NOTIFY_MAX_SINKS + 1] = { NULL };
+        int count = 1;
+        int timeout = -1;
+        int64_t now = now_ms();
+
+        for (int i = 0; i < n->sink_count; i++) {
+            notify_sink* s = &n->sinks[i];
+            if (s->fd < 0 && now >= s->retry_at) {
+                sink_connect(s, now);
+            }
+            if (s->fd < 0) {
+                int wait = (int)(s->retry_at - now);
+                timeout = timeout < 0 || wait < timeout ? wait : timeout;
+            }
+            else if (s->connecting || s->len) {
+                fds[count] = (struct pollfd){ .fd = s->fd, .events = POLLOUT };
+                polled[count++] = s;
+            }
+        }
+        if (poll(fds, (nfds_t)count, timeout) < 0 && errno != EINTR) {
+            break;
+        }
+        now = now_ms();
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t wakeups;
+            ssize_t got = read(n->wake_fd, &wakeups, sizeof(wakeups));
+            (void)got;
+
+            // Swap the buffers, so the lock is only held for a pointer exchange
+            pthread_mutex_lock(&n->lock);
+            char* inbox = n->inbox;
+            size_t len = n->inbox_len;
+            size_t cap = n->inbox_cap;
+            n->inbox = taken;
+            n->inbox_cap = taken_cap;
+            n->inbox_len = 0;
+            stopping = !n->running;
+            pthread_mutex_unlock(&n->lock);
+            taken = inbox;
+            taken_cap = cap;
+
+            for (int i = 0; i < n->sink_count; i++) {
+                sink_queue(&n->sinks[i], taken, len);
+            }
+        }
+
+        // A stop makes one last pass over every destination, without waiting for any of them
+        for (int k = 1; k < count; k++) {
+            if (fds[k].revents && !stopping) {
+                sink_write(polled[k], now);
+            }
+        }
+        if (stopping) {
+            for (int i = 0; i < n->sink_count; i++) {
+                sink_write(&n->sinks[i], now);
+            }
+        }
+    }
+    free(taken);
+    return NULL;
+}
+
+
+int notify_init(notifier* n) {
+    memset(n, 0, sizeof(*n));
+    n->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (n->wake_fd < 0) {
+        return -1;
+    }
+    if (pthread_mutex_init(&n->lock, NULL)) {
+        close(n->wake_fd);
+        n->wake_fd = -1;
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+
+int notify_add_sink(notifier* n, const char* spec) {
+    int valid = 0;
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+        valid = spec[5] && strlen(spec + 5) < sizeof(((struct sockaddr_un*)NULL)->sun_path);
+    }
+    else if (strncmp(spec, "tcp:", 4) == 0) {
+        const char* port = strrchr(spec + 4, ':');
+        valid = port && port > spec + 4 && (size_t)(port - (spec + 4)) < 256 && port[1];
+    }
+    if (!valid || n->sink_count == NOTIFY_MAX_SINKS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    notify_sink* s = &n->sinks[n->sink_count];
+    memset(s, 0, sizeof(*s));
+    s->spec = strdup(spec);
+    if (!s->spec) {
+        return -1;
+    }
+    s->fd = -1;
+    n->sink_count++;
+    return 0;
+}
+
+
+int notify_start(notifier* n) {
+    n->running = 1;
+    if (pthread_create(&n->thread, NULL, sender_main, n)) {
+        n->running = 0;
+        return -1;
+    }
+    n->started = 1;
+    return 0;
+}
+
+
+void notify_stop(notifier* n) {
+    if (n->started) {
+        uint64_t one = 1;
+        pthread_mutex_lock(&n->lock);
+        n->running = 0;
+        pthread_mutex_unlock(&n->lock);
+        ssize_t written = write(n->wake_fd, &one, sizeof(one));
+        (void)written;
+        pthread_join(n->thread, NULL);
+        n->started = 0;
+    }
+}
+
+
+void notify_free(notifier* n) {
+    notify_stop(n);
+    for (int i = 0; i < n->sink_count; i++) {
+        if (n->sinks[i].fd >= 0) {
+            close(n->sinks[i].fd);
+        }
+        free(n->sinks[i].queue);
+        free(n->sinks[i].spec);
+    }
+    if (n->wake_fd >= 0) {
+        close(n->wake_fd);
+        pthread_mutex_destroy(&n->lock);
+    }
+    free(n->inbox);
+    memset(n, 0, sizeof(*n));
+    n->wake_fd = -1;
+}
+
+
+void notify_batch_init(notify_batch* b) {
+    memset(b, 0, sizeof(*b));
+}
+
+
+void notify_batch_free(notify_batch* b) {
+    free(b->data);
+    free(b->keys);
+    memset(b, 0, sizeof(*b));
+}
+
+
+int notify_post(notify_batch* b, uint32_t owner, int kind, int minute, const char* name) {
+    char head[64];
+    int len = snprintf(head, sizeof(head), "%u %s %02d:%02d ", owner, kind == NOTIFY_START ? "start" : "warning",
+        minute / 60, minute % 60);
+    size_t name_len = strlen(name);
+    size_t start = b->len;
+
+    b->posted++;
+    if (append(&b->data, &b->len, &b->cap, head, (size_t)len) || append(&b->data, &b->len, &b->cap, name, name_len)
+        || append(&b->data, &b->len, &b->cap, "\n", 1)) {
+        b->len = start;
+        return -1;
+    }
+
+    // The same reminder twice in one tick, like after a stall, goes out once
+    int added = add_key(b, hash_line(b->data + start, b->len - start));
+    if (added <= 0) {
+        b->len = start;
+        b->coalesced += added == 0;
+        return added < 0 ? -1 : 0;
+    }
+    return 0;
+}
+
+
+void notify_submit(notifier* n, notify_batch* b) {
+    if (!b->len) {
+        return;
+    }
+
+    int queued = 0;
+    pthread_mutex_lock(&n->lock);
+    if (n->running && n->inbox_len + b->len <= NOTIFY_MAX_PENDING) {
+        queued = append(&n->inbox, &n->inbox_len, &n->inbox_cap, b->data, b->len) == 0;
+    }
+    pthread_mutex_unlock(&n->lock);
+
+    if (queued) {
+        uint64_t one = 1;
+        ssize_t written = write(n->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+    else {
+        atomic_fetch_add_explicit(&n->dropped, count_lines(b->data, b->len), memory_order_relaxed);
+    }
+
+    b->len = 0;
+    if (b->key_count) {
+        memset(b->keys, 0, b->key_slots * sizeof(uint64_t));
+        b->key_count = 0;
+    }
+}
+
+
+void notify_report(notifier* n, FILE* out) {
+    for (int i = 0; i < n->sink_count; i++) {
+        notify_sink* s = &n->sinks[i];
+        fprintf(out, "notify %s: %llu bytes sent, %llu reminders dropped\n", s->spec,
+            (unsigned long long)atomic_load_explicit(&s->sent, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&s->dropped, memory_order_relaxed));
+    }
+    uint64_t dropped = atomic_load_explicit(&n->dropped, memory_order_relaxed);
+    if (dropped) {
+        fprintf(out, "notify: %llu reminders dropped before reaching the sender\n", (unsigned long long)dropped);
+    }
+}
@@ -0,0 +1,155 @@
+#ifndef HEADER_NOTIFY_H
+#define HEADER_NOTIFY_H
+
+// Include any necessary headers here
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Declare any constants here
+#define NOTIFY_START        0           ///< Kind of a reminder announcing the start of an activity
+#define NOTIFY_WARNING      1           ///< Kind of a reminder about an activity that ends soon
+#define NOTIFY_MAX_SINKS    8           ///< Most destinations one notifier sends to
+#define NOTIFY_MAX_PENDING  (1 << 20)   ///< Bytes queued for a destination before new reminders are dropped for it
+#define NOTIFY_RETRY_MS     1000        ///< Delay before connecting again to a destination that failed
+
+// Define struct for the reminders one producer collects during a tick
+typedef struct {
+    char* data; ///< Reminder lines, each ending with a newline
+    size_t len; ///< Number of bytes in data
+    size_t cap; ///< Number of bytes allocated for data
+    uint64_t* keys; ///< Open addressing set of the hashes of the lines in data, 0 for an empty slot
+    size_t key_slots; ///< Number of slots in keys, a power of two
+    size_t key_count; ///< Number of hashes in keys
+    uint64_t posted; ///< Reminders posted so far
+    uint64_t coalesced; ///< Reminders dropped because the batch already held the same line
+} notify_batch;
+
+// Define struct for one destination, a UNIX or TCP stream socket
+typedef struct {
+    char* spec; ///< Destination as given, "unix:PATH" or "tcp:HOST:PORT"
+    int fd; ///< Connected or connecting socket, -1 while disconnected
+    int connecting; ///< Flag set while a non-blocking connect is in progress
+    int partial; ///< Flag set when only the start of the first queued line was sent
+    char* queue; ///< Bytes waiting to be sent, starting at head
+    size_t head; ///< Offset of the first unsent byte in queue
+    size_t len; ///< Number of unsent bytes
+    size_t cap; ///< Number of bytes allocated for queue
+    int64_t retry_at; ///< Monotonic millisecond to connect again at
+    _Atomic uint64_t sent; ///< Bytes sent so far
+    _Atomic uint64_t dropped; ///< Reminders dropped because the queue was full
+} notify_sink;
+
+// Define struct for the fan-out of the reminders to every destination from a sender thread
+typedef struct {
+    notify_sink sinks[NOTIFY_MAX_SINKS]; ///< Destinations
+    int sink_count; ///< Number of destinations
+    pthread_mutex_t lock; ///< Protects inbox, inbox_len and running
+    char* inbox; ///< Batches handed over since the sender last took them
+    size_t inbox_len; ///< Number of bytes in inbox
+    size_t inbox_cap; ///< Number of bytes allocated for inbox
+    int wake_fd; ///< Eventfd that wakes the sender when a batch was handed over
+    int running; ///< Flag cleared to stop the sender
+    int started; ///< Flag set while the sender thread exists
+    pthread_t thread; ///< Sender thread
+    _Atomic uint64_t dropped; ///< Reminders dropped because the sender fell behind
+} notifier;
+
+/**
+ * @brief Initializes an empty notifier without any destination
+ *
+ * @param[out] n Pointer to the notifier to initialize
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int notify_init(notifier* n); ///< Function for creating a notifier
+
+/**
+ * @brief Adds a destination, before notify_start()
+ *
+ * The destination is connected by the sender thread, and connected again after a failure, so it does not have
+ * to be listening yet.
+ *
+ * @param[in,out] n Pointer to the notifier
+ * @param[in] spec "unix:PATH" for a UNIX stream socket or "tcp:HOST:PORT" for a TCP connection
+ *
+ * @return Returns 0 on success, -1 with errno set to EINVAL for a malformed destination or too many of them
+ */
+int notify_add_sink(notifier* n, const char* spec); ///< Function for adding a destination
+
+/**
+ * @brief Starts the sender thread
+ *
+ * @param[in,out] n Pointer to the notifier
+ *
+ * @return Returns 0 on success, -1 if the thread could not be started
+ */
+int notify_start(notifier* n); ///< Function for starting a notifier
+
+/**
+ * @brief Stops the sender thread after a last attempt to send what is queued
+ *
+ * The counters stay readable with notify_report() until notify_free().
+ *
+ * @param[in,out] n Pointer to the notifier
+ */
+void notify_stop(notifier* n); ///< Function for stopping a notifier
+
+/**
+ * @brief Stops the sender thread if it still runs and releases the notifier
+ *
+ * @param[in,out] n Pointer to the notifier
+ */
+void notify_free(notifier* n); ///< Function for freeing a notifier
+
+/**
+ * @brief Initializes an empty batch
+ *
+ * @param[out] b Pointer to the batch to initialize
+ */
+void notify_batch_init(notify_batch* b); ///< Function for creating a batch
+
+/**
+ * @brief Releases the memory held by a batch
+ *
+ * @param[in,out] b Pointer to the batch to free
+ */
+void notify_batch_free(notify_batch* b); ///< Function for freeing a batch
+
+/**
+ * @brief Adds a reminder to a batch, unless the batch already holds the same one
+ *
+ * The reminder becomes the line "OWNER start|warning HH:MM NAME", with the minute the event was due at.
+ *
+ * @param[in,out] b Pointer to the batch
+ * @param[in] owner Resident the reminder is for, 0 for the single agenda
+ * @param[in] kind NOTIFY_START or NOTIFY_WARNING
+ * @param[in] minute Minute of the day the event was due at
+ * @param[in] name Name of the activity
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int notify_post(notify_batch* b, uint32_t owner, int kind, int minute, const char* name); ///< Function for queueing a reminder
+
+/**
+ * @brief Hands a batch to the sender thread and empties it
+ *
+ * This only copies the batch under a lock and never waits for a destination. When the sender has fallen more
+ * than NOTIFY_MAX_PENDING bytes behind, the batch is dropped and counted instead.
+ *
+ * @param[in,out] n Pointer to the notifier
+ * @param[in,out] b Pointer to the batch
+ */
+void notify_submit(notifier* n, notify_batch* b); ///< Function for sending a batch
+
+/**
+ * @brief Prints one line per destination with the bytes sent and the reminders dropped for it
+ *
+ * @param[in] n Pointer to the notifier
+ * @param[in] out File to print to
+ */
+void notify_report(notifier* n, FILE* out); ///< Function for printing the delivery counters
+
+#endif /* HEADER_NOTIFY_H */
@@ -0,0 +1,73 @@
+/**
+ * @file Packed.c
+ * @brief This file contains the struct-of-arrays storage mode of an agenda.
+ *
+ * The array-of-structs layout of the activity store keeps the name id and the done flag next to the times, so a
+ * scan over the times also reads bytes it does not need. The packed layout keeps each field in its own array instead: two 16 bit
+ * minute values per activity for the times, one bit for the done flag and the names in a shared string pool.
+ */
+
+#include "Packed.h"
+
+
+int packed_build(packed_agenda* p, const activity_store* s) {
+    size_t n = s->count;
+    size_t words = bitset_words(n);
+    char* arena;
+
+    memset(p, 0, sizeof(*p));
+    // 64 bit words first so every array stays aligned
+    arena = malloc(words * sizeof(uint64_t) + n * sizeof(uint32_t) + 3 * n * sizeof(uint16_t) + 1);
+    if (!arena) {
+        return -1;
+    }
+
+    p->arena = arena;
+    p->done = (bitset){ (uint64_t*)arena, n };
+    p->name = (uint32_t*)(arena + words * sizeof(uint64_t));
+    p->start = (uint16_t*)(p->name + n);
+    p->end = p->start + n;
+    p->warning = p->end + n;
+    p->count = n;
+    p->names = &activity_names;
+    bitset_reset(&p->done);
+
+    for (size_t i = 0; i < n; i++) {
+        const activity* a = &s->items[i];
+
+        p->start[i] = (uint16_t)atime_minutes(&a->start_time);
+        p->end[i] = (uint16_t)atime_minutes(&a->end_time);
+        // The reminder is only given while the activity is in progress
+        p->warning[i] = p->end[i] - WARNING_MINUTES >= p->start[i] ? (uint16_t)(p->end[i] - WARNING_MINUTES) : KERNEL_NEVER;
+        p->name[i] = a->name;
+        if (a->done) {
+            bitset_set(&p->done, i);
+        }
+    }
+    return 0;
+}
+
+
+void packed_free(packed_agenda* p) {
+    free(p->arena);
+    memset(p, 0, sizeof(*p));
+}
+
+
+size_t packed_due(const packed_agenda* p, int minute, bitset* starts, bitset* warnings) {
+    size_t words = bitset_words(p->count);
+    size_t fired = 0;
+
+    kernel_due(p->start, p->warning, p->count, (uint16_t)minute, starts->words, warnings->words);
+
+    // Done activities are masked out word by word instead of testing every bit
+    for (size_t w = 0; w < words; w++) {
+        uint64_t done = p->done.words[w];
+        starts->words[w] &= ~done;
+        warnings->words[w] &= ~done;
+        fired += (size_t)__builtin_popcountll(starts->words[w]) + (size_t)__builtin_popcountll(warnings->words[w]);
+    }
+    memset(starts->words + words, 0, (bitset_words(starts->bits) - words) * sizeof(uint64_t));
+    memset(warnings->words + words, 0, (bitset_words(warnings->bits) - words) * sizeof(uint64_t));
+    return fired;
+}
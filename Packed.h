@@ -0,0 +1,56 @@
+#ifndef HEADER_PACKED_H
+#define HEADER_PACKED_H
+
+// Include any necessary headers here
+#include "Store.h"
+#include "Pool.h"
+#include "Kernel.h"
+
+// Define struct for the struct-of-arrays activity layout
+typedef struct {
+    uint16_t* start; ///< Start of every activity in minutes since midnight
+    uint16_t* end; ///< End of every activity in minutes since midnight
+    uint16_t* warning; ///< Minute of the 10 minute warning of every activity, or KERNEL_NEVER if it has none
+    uint32_t* name; ///< Id of the name of every activity in the string pool
+    bitset done; ///< Activities that have been completed
+    size_t count; ///< Number of activities
+    string_pool* names; ///< String pool holding the activity names, always activity_names
+    void* arena; ///< Single allocation holding all arrays
+} packed_agenda;
+
+/**
+ * @brief Builds the packed layout of an activity store
+ *
+ * This function copies the times of every activity into 16 bit minute arrays, the done flags into a bitset and
+ * the name ids next to them, so scanning the agenda only touches the arrays it needs.
+ *
+ * @param[out] p Pointer to the packed agenda to build
+ * @param[in] s Pointer to the activity store to pack
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int packed_build(packed_agenda* p, const activity_store* s); ///< Function for packing an activity store
+
+/**
+ * @brief Releases the arena of a packed agenda
+ *
+ * @param[in,out] p Pointer to the packed agenda to free
+ */
+void packed_free(packed_agenda* p); ///< Function for freeing a packed agenda
+
+/**
+ * @brief Finds the activities that start or enter their 10 minute warning at a minute
+ *
+ * The minute arrays are compared with kernel_due() and activities that are already done are masked out afterwards.
+ * Both output bitsets must hold at least p->count bits and are cleared before the scan.
+ *
+ * @param[in] p Pointer to the packed agenda
+ * @param[in] minute Minute of the day
+ * @param[out] starts Bitset receiving the activities that start at the minute
+ * @param[out] warnings Bitset receiving the activities that end 10 minutes after the minute
+ *
+ * @return Returns the number of bits set in both bitsets together
+ */
+size_t packed_due(const packed_agenda* p, int minute, bitset* starts, bitset* warnings); ///< Function for scanning a packed agenda
+
+#endif /* HEADER_PACKED_H */
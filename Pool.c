@@ -0,0 +1,136 @@
+/**
+ * @file Pool.c
+ * @brief This file contains the interned string pool used for activity names.
+ *
+ * Every distinct string is stored once in a growing byte buffer and referred to by a 32 bit id. A small open
+ * addressing hash table maps strings back to their ids.
+ */
+
+#include "Pool.h"
+#include "Util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_MIN_SLOTS 64 // Initial number of hash table slots
+
+
+/**
+ * @brief Finds the hash table slot of a string
+ *
+ * @param[in] pool Pointer to the pool
+ * @param[in] str Pointer to the string
+ * @param[in] len Length of the string
+ *
+ * @return Returns the slot holding the string, or the empty slot where it would be inserted
+ */
+static uint32_t find_slot(const string_pool* pool, const char* str, size_t len) {
+    uint32_t mask = pool->slot_count - 1;
+    uint32_t slot = util_fnv(UTIL_FNV_START, str, len) & mask;
+
+    while (pool->slots[slot]) {
+        uint32_t id = pool->slots[slot] - 1;
+        if (pool->lengths[id] == len && !memcmp(pool->data + pool->offsets[id], str, len)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+/**
+ * @brief Doubles the number of hash table slots and reinserts every string
+ *
+ * @param[in,out] pool Pointer to the pool
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int grow_slots(string_pool* pool) {
+    uint32_t slot_count = pool->slot_count ? pool->slot_count * 2 : POOL_MIN_SLOTS;
+    uint32_t* slots = calloc(slot_count, sizeof(uint32_t));
+
+    if (!slots) {
+        return -1;
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_count = slot_count;
+
+    for (uint32_t id = 0; id < pool->count; id++) {
+        pool->slots[find_slot(pool, pool->data + pool->offsets[id], pool->lengths[id])] = id + 1;
+    }
+    return 0;
+}
+
+
+void pool_init(string_pool* pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+
+void pool_free(string_pool* pool) {
+    free(pool->data);
+    free(pool->offsets);
+    free(pool->lengths);
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
+}
+
+
+uint32_t pool_intern(string_pool* pool, const char* str, size_t len) {
+    uint32_t slot;
+
+    // Keep the hash table at most half full
+    if (2 * (pool->count + 1) > pool->slot_count && grow_slots(pool)) {
+        return POOL_INVALID_ID;
+    }
+    slot = find_slot(pool, str, len);
+    if (pool->slots[slot]) {
+        return pool->slots[slot] - 1;
+    }
+
+    if (pool->count == pool->id_capacity) {
+        uint32_t id_capacity = pool->id_capacity ? pool->id_capacity * 2 : POOL_MIN_SLOTS;
+        uint32_t* offsets = realloc(pool->offsets, id_capacity * sizeof(uint32_t));
+        if (!offsets) {
+            return POOL_INVALID_ID;
+        }
+        pool->offsets = offsets;
+        uint32_t* lengths = realloc(pool->lengths, id_capacity * sizeof(uint32_t));
+        if (!lengths) {
+            return POOL_INVALID_ID;
+        }
+        pool->lengths = lengths;
+        pool->id_capacity = id_capacity;
+    }
+
+    if (pool->size + len + 1 > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity : 256;
+        while (capacity < pool->size + len + 1) {
+            capacity *= 2;
+        }
+        char* data = realloc(pool->data, capacity);
+        if (!data) {
+            return POOL_INVALID_ID;
+        }
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+
+    memcpy(pool->data + pool->size, str, len);
+    pool->data[pool->size + len] = '\0';
+    pool->offsets[pool->count] = (uint32_t)pool->size;
+    pool->lengths[pool->count] = (uint32_t)len;
+    pool->size += len + 1;
+    pool->slots[slot] = pool->count + 1;
+    return pool->count++;
+}
+
+
+const char* pool_get(const string_pool* pool, uint32_t id, size_t* len) {
+    if (len) {
+        *len = pool->lengths[id];
+    }
+    return pool->data + pool->offsets[id];
+}
@@ -0,0 +1,62 @@
+#ifndef HEADER_POOL_H
+#define HEADER_POOL_H
+
+// Include any necessary headers here
+#include <stddef.h>
+#include <stdint.h>
+
+// Declare any constants here
+#define POOL_INVALID_ID UINT32_MAX ///< Id returned when a string could not be interned
+
+// Define struct for an interned string pool
+typedef struct {
+    char* data; ///< Concatenated strings, each followed by a null terminator
+    size_t size; ///< Number of bytes used in data
+    size_t capacity; ///< Number of bytes allocated for data
+    uint32_t* offsets; ///< Offset of every string in data, indexed by id
+    uint32_t* lengths; ///< Length of every string, indexed by id
+    uint32_t count; ///< Number of strings in the pool
+    uint32_t id_capacity; ///< Number of ids the offsets and lengths arrays have room for
+    uint32_t* slots; ///< Open addressing hash table holding id + 1, or 0 for an empty slot
+    uint32_t slot_count; ///< Number of slots in the hash table, always a power of two
+} string_pool;
+
+/**
+ * @brief Initializes an empty string pool
+ *
+ * @param[out] pool Pointer to the pool to initialize
+ */
+void pool_init(string_pool* pool); ///< Function for creating a string pool
+
+/**
+ * @brief Releases the memory held by a string pool
+ *
+ * @param[in,out] pool Pointer to the pool to free
+ */
+void pool_free(string_pool* pool); ///< Function for freeing a string pool
+
+/**
+ * @brief Interns a string
+ *
+ * Equal strings are stored only once and always get the same id.
+ *
+ * @param[in,out] pool Pointer to the pool
+ * @param[in] str Pointer to the first character of the string, which does not need to be null terminated
+ * @param[in] len Length of the string
+ *
+ * @return Returns the id of the string, or POOL_INVALID_ID if memory could not be allocated
+ */
+uint32_t pool_intern(string_pool* pool, const char* str, size_t len); ///< Function for interning a string
+
+/**
+ * @brief Returns an interned string
+ *
+ * @param[in] pool Pointer to the pool
+ * @param[in] id Id returned by pool_intern()
+ * @param[out] len Pointer receiving the length of the string, may be NULL
+ *
+ * @return Returns a pointer to the null terminated string inside the pool
+ */
+const char* pool_get(const string_pool* pool, uint32_t id, size_t* len); ///< Function for looking up an interned string
+
+#endif /* HEADER_POOL_H */
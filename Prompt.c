@@ -0,0 +1,242 @@
+/**
+ * @file Prompt.c
+ * @brief This file contains the queue of questions asked by the agenda.
+ *
+ * Asking "Are you doing X now?" used to block in scanf, and the delays around it slept in place, so nothing else
+ * was scheduled while a question was open. The questions are now queued and handled one after the other by a
+ * small state machine the main loop drives, so the loop keeps announcing other activities on time.
+ */
+
+#include "Prompt.h"
+#include "Render.h"
+
+prompt_queue prompts = { NULL, 0, 0, 0, PROMPT_IDLE, 0, 0 }; // Questions of the agenda waiting to be asked
+
+
+/**
+ * @brief Returns the simulated time at which a delay starting now ends
+ *
+ * @param[in] seconds Length of the delay in real seconds at the current speed
+ *
+ * @return Returns the end of the delay in simulated nanoseconds
+ */
+static int64_t delay_deadline(int seconds) {
+    return clock_now_ns(&agenda_clock) + (int64_t)seconds * agenda_clock.speed * NSEC_PER_SEC;
+}
+
+
+/**
+ * @brief Checks if a reminder does not need its question anymore
+ *
+ * @param[in] a Pointer to the activity of the reminder
+ *
+ * @return Returns true if the activity is done or over
+ */
+static bool is_stale(const activity* a) {
+    return a->done || (time_info.local_time && tm_minutes(time_info.local_time) >= atime_minutes(&a->end_time));
+}
+
+
+/**
+ * @brief Shows the answer of the head entry for a while before the screen is cleared
+ *
+ * @param[in,out] q Pointer to the queue
+ */
+static void start_clearing(prompt_queue* q) {
+    q->state = PROMPT_CLEARING;
+    q->deadline = delay_deadline(PROMPT_CLEAR_DELAY);
+}
+
+
+/**
+ * @brief Drops the head entry
+ *
+ * @param[in,out] q Pointer to the queue
+ */
+static void pop(prompt_queue* q) {
+    q->state = PROMPT_IDLE;
+    if (++q->head == q->count) {
+        q->head = 0;
+        q->count = 0;
+    }
+}
+
+
+/**
+ * @brief Handles an answer to the question at the head of the queue
+ *
+ * @param[in,out] q Pointer to the queue
+ * @param[in] answer Answer given by the user or the script
+ */
+static void handle_answer(prompt_queue* q, const char* answer) {
+    activity* a = q->entries[q->head].a;
+    bool yes = strcmp(answer, "yes") == 0;
+
+    if ((yes || strcmp(answer, "no") == 0) && on_answer.fn) {
+        on_answer.fn(on_answer.ctx, a, yes, clock_now_ns(&agenda_clock) - q->asked_at);
+    }
+    if (yes) {
+        // Set activity as done if user confirms
+        a->done = 1;
+        if (on_done.fn) {
+            on_done.fn(on_done.ctx, a);
+        }
+        render_prompt("%s", "");
+        render_message("%s marked as done.", activity_name(a));
+        start_clearing(q);
+    }
+    else if (strcmp(answer, "no") == 0) {
+        render_prompt("%s", "");
+        start_clearing(q);
+    }
+    else {
+        render_prompt("Are you doing %s now? (yes/no)", activity_name(a));
+    }
+}
+
+
+/**
+ * @brief Asks the question of the head entry
+ *
+ * @param[in,out] q Pointer to the queue
+ */
+static void ask(prompt_queue* q) {
+    activity* a = q->entries[q->head].a;
+
+    // The activity may have been marked as done or be over by now
+    if (q->entries[q->head].kind == PROMPT_REMINDER && is_stale(a)) {
+        pop(q);
+        return;
+    }
+
+    q->state = PROMPT_ASKING;
+    q->asked_at = clock_now_ns(&agenda_clock);
+    if (scripted_answer) {
+        // Take the answer from the script instead of asking
+        handle_answer(q, scripted_answer(a));
+        return;
+    }
+    render_prompt("Are you doing %s now? (yes/no)", activity_name(a));
+}
+
+
+void prompt_free(prompt_queue* q) {
+    free(q->entries);
+    memset(q, 0, sizeof(*q));
+}
+
+
+int prompt_push(prompt_queue* q, activity* a, prompt_kind kind) {
+    if (q->count == q->capacity) {
+        if (q->head) {
+            // Reuse the room of the finished entries before growing
+            memmove(q->entries, q->entries + q->head, (q->count - q->head) * sizeof(prompt_entry));
+            q->count -= q->head;
+            q->head = 0;
+        }
+        else {
+            size_t capacity = q->capacity ? q->capacity * 2 : 8;
+            prompt_entry* entries = realloc(q->entries, capacity * sizeof(prompt_entry));
+            if (!entries) {
+                return -1;
+            }
+            q->entries = entries;
+            q->capacity = capacity;
+        }
+    }
+    q->entries[q->count++] = (prompt_entry){ a, kind };
+    return 0;
+}
+
+
+void prompt_poll(prompt_queue* q) {
+    int64_t now = clock_now_ns(&agenda_clock);
+
+    while (q->head < q->count) {
+        prompt_entry* e = &q->entries[q->head];
+
+        if (q->state == PROMPT_IDLE) {
+            if (e->kind == PROMPT_CLEAR) {
+                start_clearing(q);
+            }
+            else if (e->kind == PROMPT_REMINDER && is_stale(e->a)) {
+                pop(q);
+            }
+            else if (e->a->done) {
+                render_message("Chill, you've already done: %s", activity_name(e->a));
+                start_clearing(q);
+            }
+            else {
+                q->state = PROMPT_WAITING;
+                q->deadline = delay_deadline(PROMPT_INPUT_DELAY);
+            }
+        }
+        else if (q->state == PROMPT_WAITING && now >= q->deadline) {
+            ask(q);
+        }
+        else if (q->state == PROMPT_CLEARING && now >= q->deadline) {
+            render_clear();
+            pop(q);
+        }
+        else {
+            // Waiting for a deadline or for an answer
+            break;
+        }
+    }
+}
+
+
+bool prompt_wants_input(const prompt_queue* q) {
+    return q->state == PROMPT_WAITING || q->state == PROMPT_ASKING;
+}
+
+
+bool prompt_answer(prompt_queue* q, const char* line) {
+    bool taken = false;
+
+    if (q->state == PROMPT_WAITING) {
+        ask(q);
+    }
+    if (q->state == PROMPT_ASKING) {
+        handle_answer(q, line);
+        taken = true;
+    }
+    prompt_poll(q);
+    return taken;
+}
+
+
+size_t prompt_pending(const prompt_queue* q) {
+    size_t pending = 0;
+
+    for (size_t k = q->head; k < q->count; k++) {
+        // The head entry is answered once it shows its answer
+        if (q->entries[k].kind != PROMPT_CLEAR && !(k == q->head && q->state == PROMPT_CLEARING)) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+
+void prompt_relocate(prompt_queue* q, const activity* old, size_t n, activity* items) {
+    for (size_t k = q->head; k < q->count; k++) {
+        const activity* a = q->entries[k].a;
+        // Comparing the addresses as integers, the old block may already be freed
+        if ((uintptr_t)a >= (uintptr_t)old && (uintptr_t)a < (uintptr_t)(old + n)) {
+            q->entries[k].a = items + ((uintptr_t)a - (uintptr_t)old) / sizeof(activity);
+        }
+    }
+}
+
+
+int64_t prompt_deadline(const prompt_queue* q) {
+    if (q->state == PROMPT_WAITING || q->state == PROMPT_CLEARING) {
+        return q->deadline;
+    }
+    // A new entry waits to be started
+    if (q->state == PROMPT_IDLE && q->head < q->count) {
+        return clock_now_ns(&agenda_clock);
+    }
+    return -1;
+}
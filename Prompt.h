@@ -0,0 +1,129 @@
+#ifndef HEADER_PROMPT_H
+#define HEADER_PROMPT_H
+
+// Include any necessary headers here
+#include "Helper.h"
+
+// Declare any constants here
+#define PROMPT_INPUT_DELAY  3   ///< Seconds between an announcement and its question
+#define PROMPT_CLEAR_DELAY  2   ///< Seconds the answer stays on the screen before it is cleared
+
+// Define the kinds of entries of the prompt queue
+typedef enum {
+    PROMPT_REMINDER, ///< Question following a start or warning, dropped if the activity is done or over meanwhile
+    PROMPT_QUERY, ///< Question following a query of the user, says so if the activity is already done
+    PROMPT_CLEAR ///< Clears the screen once the entries before it are finished
+} prompt_kind;
+
+// Define the states of the entry at the head of the queue
+typedef enum {
+    PROMPT_IDLE, ///< The head entry has not been started yet, or the queue is empty
+    PROMPT_WAITING, ///< Waiting for the input delay to pass before asking
+    PROMPT_ASKING, ///< The question is on the screen and waits for an answer
+    PROMPT_CLEARING ///< Waiting for the clear delay to pass before clearing the screen
+} prompt_state;
+
+// Define struct for an entry of the prompt queue
+typedef struct {
+    activity* a; ///< Activity the question is about, NULL for PROMPT_CLEAR
+    prompt_kind kind; ///< Kind of the entry
+} prompt_entry;
+
+// Define struct for the queue of pending questions
+typedef struct {
+    prompt_entry* entries; ///< Entries, the pending ones are entries[head...count - 1]
+    size_t head; ///< Index of the entry being handled
+    size_t count; ///< Number of entries used, including the finished ones before head
+    size_t capacity; ///< Number of entries allocated
+    prompt_state state; ///< State of the head entry
+    int64_t deadline; ///< Simulated time in nanoseconds at which the current delay ends
+    int64_t asked_at; ///< Simulated time in nanoseconds at which the question of the head entry was first asked
+} prompt_queue;
+
+// Declare any global variables here
+extern prompt_queue prompts; ///< Questions of the agenda waiting to be asked
+
+/**
+ * @brief Releases the memory held by a prompt queue and drops the pending questions
+ *
+ * @param[in,out] q Pointer to the queue
+ */
+void prompt_free(prompt_queue* q); ///< Function for freeing a prompt queue
+
+/**
+ * @brief Queues a question about an activity, or a screen clear
+ *
+ * Nothing is printed here, the entry is started by prompt_poll() once the entries before it are finished.
+ *
+ * @param[in,out] q Pointer to the queue
+ * @param[in,out] a Activity to ask about, NULL for PROMPT_CLEAR
+ * @param[in] kind Kind of the entry
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int prompt_push(prompt_queue* q, activity* a, prompt_kind kind); ///< Function for queueing a question
+
+/**
+ * @brief Moves the queue forward as far as the simulated clock allows
+ *
+ * This function starts the next entry, asks the question once its delay is over and clears the screen once the
+ * answer has been shown long enough. It never blocks, the main loop has to call it again by prompt_deadline().
+ * With scripted_answer set the questions are answered as soon as they are asked.
+ *
+ * @param[in,out] q Pointer to the queue
+ */
+void prompt_poll(prompt_queue* q); ///< Function for running the prompt state machine
+
+/**
+ * @brief Checks if the next input line is the answer to a question
+ *
+ * @param[in] q Pointer to the queue
+ *
+ * @return Returns true if a question is asked or about to be asked
+ */
+bool prompt_wants_input(const prompt_queue* q); ///< Function for routing input to the prompts
+
+/**
+ * @brief Hands an input line to the question at the head of the queue
+ *
+ * A question still waiting for its delay is asked right away, like typing used to cut the delay short. Answers
+ * other than "yes" and "no" repeat the question.
+ *
+ * @param[in,out] q Pointer to the queue
+ * @param[in] line Input line without the newline
+ *
+ * @return Returns true if the line was taken as an answer, false if the question was dropped meanwhile
+ */
+bool prompt_answer(prompt_queue* q, const char* line); ///< Function for answering a question
+
+/**
+ * @brief Counts the questions that still wait for an answer, including the one being asked
+ *
+ * @param[in] q Pointer to the queue
+ *
+ * @return Returns the number of questions, screen clears are not counted
+ */
+size_t prompt_pending(const prompt_queue* q); ///< Function for counting the open questions
+
+/**
+ * @brief Points the pending entries at the new place of activities that were moved in memory
+ *
+ * Called after the activity store grew, since the entries keep pointers to the activities they are about.
+ *
+ * @param[in,out] q Pointer to the queue
+ * @param[in] old Previous address of the activities
+ * @param[in] n Number of activities at the previous address
+ * @param[in] items New address of the activities
+ */
+void prompt_relocate(prompt_queue* q, const activity* old, size_t n, activity* items); ///< Function for following moved activities
+
+/**
+ * @brief Returns when prompt_poll() has to be called next
+ *
+ * @param[in] q Pointer to the queue
+ *
+ * @return Returns the simulated time in nanoseconds, or -1 if the queue only waits for input or is empty
+ */
+int64_t prompt_deadline(const prompt_queue* q); ///< Function for finding the next prompt deadline
+
+#endif /* HEADER_PROMPT_H */
@@ -0,0 +1,251 @@
+/**
+ * @file Recur.c
+ * @brief This file contains the recurrence rules, like "every day" or "every 4 hours on weekdays".
+ *
+ * A rule is kept as it was written and only turned into activities when the agenda of a day is built. The
+ * occurrences depend on nothing but the day of the week, so every weekday is expanded once and cached, and the
+ * memory stays proportional to the rules however many days the agenda runs.
+ */
+
+#include "Recur.h"
+
+#include <ctype.h>
+#include <errno.h>
+
+static const char* const day_names[7] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" }; // Like tm_wday
+
+
+/**
+ * @brief Drops the cached occurrences of every day
+ *
+ * @param[in,out] r Pointer to the rule set
+ */
+static void drop_expanded(recur_set* r) {
+    for (int d = 0; d < 7; d++) {
+        free(r->expanded[d]);
+        r->expanded[d] = NULL;
+        r->expanded_count[d] = 0;
+    }
+}
+
+
+/**
+ * @brief Parses the days a rule applies to
+ *
+ * @param[in] word Null terminated days of the rule
+ *
+ * @return Returns the days as a mask with bit 0 for Sunday, 0 if the word is invalid
+ */
+static uint8_t parse_days(const char* word) {
+    if (strcmp(word, "daily") == 0) {
+        return RECUR_DAILY;
+    }
+    if (strcmp(word, "weekdays") == 0) {
+        return RECUR_WEEKDAYS;
+    }
+    if (strcmp(word, "weekends") == 0) {
+        return RECUR_WEEKENDS;
+    }
+
+    uint8_t days = 0;
+    while (*word) {
+        int d = 0;
+        while (d < 7 && strncmp(word, day_names[d], 3)) {
+            d++;
+        }
+        if (d == 7 || (word[3] && word[3] != ',')) {
+            return 0;
+        }
+        days |= (uint8_t)(1U << d);
+        word += word[3] ? 4 : 3;
+    }
+    return days;
+}
+
+
+/**
+ * @brief Validates a time of day
+ *
+ * @param[in] h Hour
+ * @param[in] m Minute
+ *
+ * @return Returns the minutes since midnight, or -1 if the time is outside 00:00 to 24:00
+ */
+static int day_minute(int h, int m) {
+    int minute = h * 60 + m;
+
+    return h >= 0 && m >= 0 && m <= 59 && minute <= MINUTES_PER_DAY ? minute : -1;
+}
+
+
+/**
+ * @brief Lists the occurrences of one rule on a day of the week
+ *
+ * @param[in] rule Pointer to the rule
+ * @param[in] wday Day of the week, 0 for Sunday
+ * @param[out] out Array receiving the occurrences, or NULL to only count them
+ *
+ * @return Returns the number of occurrences, the ones that would end after midnight are left out
+ */
+static size_t occurrences(const recur_rule* rule, int wday, activity* out) {
+    size_t n = 0;
+
+    if (!(rule->days >> wday & 1)) {
+        return 0;
+    }
+    for (int t = rule->start; t <= rule->until && t + rule->length <= MINUTES_PER_DAY; t += rule->every) {
+        int end = t + rule->length;
+        if (out) {
+            out[n] = (activity){ rule->name, { t / 60, t % 60 }, { end / 60, end % 60 }, 0 };
+        }
+        n++;
+        if (!rule->every) {
+            break;
+        }
+    }
+    return n;
+}
+
+
+void recur_init(recur_set* r) {
+    memset(r, 0, sizeof(*r));
+}
+
+
+void recur_free(recur_set* r) {
+    drop_expanded(r);
+    free(r->rules);
+    memset(r, 0, sizeof(*r));
+}
+
+
+int recur_add(recur_set* r, const recur_rule* rule) {
+    if (r->count == r->capacity) {
+        size_t capacity = r->capacity ? r->capacity * 2 : 8;
+        recur_rule* rules = realloc(r->rules, capacity * sizeof(recur_rule));
+        if (!rules) {
+            return -1;
+        }
+        r->rules = rules;
+        r->capacity = capacity;
+    }
+    r->rules[r->count++] = *rule;
+    drop_expanded(r);
+    return 0;
+}
+
+
+int recur_parse(const char* line, recur_rule* rule) {
+    char word[32];
+    int sh, sm, eh, em, used = 0;
+
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (!*line || *line == '#') {
+        return 0;
+    }
+    if (sscanf(line, "%31s %d:%d %d:%d %n", word, &sh, &sm, &eh, &em, &used) != 5 || !used) {
+        return -1;
+    }
+
+    int start = day_minute(sh, sm);
+    int end = day_minute(eh, em);
+    memset(rule, 0, sizeof(*rule));
+    rule->days = parse_days(word);
+    if (!rule->days || start < 0 || end < start) {
+        return -1;
+    }
+    rule->start = (uint16_t)start;
+    rule->length = (uint16_t)(end - start);
+    rule->until = MINUTES_PER_DAY - 1;
+    line += used;
+
+    unsigned n;
+    char unit;
+    used = 0;
+    if (sscanf(line, "every %u%c %n", &n, &unit, &used) == 2 && used) {
+        n = unit == 'h' ? n * 60 : (unit == 'm' ? n : 0);
+        if (!n || n >= MINUTES_PER_DAY) {
+            return -1;
+        }
+        rule->every = (uint16_t)n;
+        line += used;
+    }
+    used = 0;
+    if (sscanf(line, "until %d:%d %n", &eh, &em, &used) == 2 && used) {
+        int until = day_minute(eh, em);
+        if (until < start) {
+            return -1;
+        }
+        rule->until = (uint16_t)until;
+        line += used;
+    }
+
+    size_t len = strcspn(line, "\r\n");
+    while (len && isspace((unsigned char)line[len - 1])) {
+        len--;
+    }
+    if (!len) {
+        return -1;
+    }
+    rule->name = name_intern(line, len);
+    return rule->name == POOL_INVALID_ID ? -1 : 1;
+}
+
+
+int recur_load(recur_set* r, const char* path, size_t* line) {
+    char text[RECUR_LINE_LENGTH];
+    recur_rule rule;
+
+    *line = 0;
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        return -1;
+    }
+    size_t number = 0;
+    while (fgets(text, sizeof(text), in)) {
+        number++;
+
+        int parsed = recur_parse(text, &rule);
+        if (parsed < 0 || (parsed && recur_add(r, &rule))) {
+            *line = parsed < 0 ? number : 0;
+            fclose(in);
+            errno = parsed < 0 ? EINVAL : ENOMEM;
+            return -1;
+        }
+    }
+    int failed = ferror(in);
+    fclose(in);
+    if (failed) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+
+int recur_expand(recur_set* r, int wday, const activity** day, size_t* n) {
+    if (!r->expanded[wday]) {
+        // Count first, so the day is a single block
+        size_t count = 0;
+        for (size_t k = 0; k < r->count; k++) {
+            count += occurrences(&r->rules[k], wday, NULL);
+        }
+
+        activity* items = malloc((count ? count : 1) * sizeof(activity));
+        if (!items) {
+            return -1;
+        }
+        size_t i = 0;
+        for (size_t k = 0; k < r->count; k++) {
+            i += occurrences(&r->rules[k], wday, items + i);
+        }
+        r->expanded[wday] = items;
+        r->expanded_count[wday] = count;
+    }
+
+    *day = r->expanded[wday];
+    *n = r->expanded_count[wday];
+    return 0;
+}
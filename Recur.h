@@ -0,0 +1,96 @@
+#ifndef HEADER_RECUR_H
+#define HEADER_RECUR_H
+
+// Include any necessary headers here
+#include "Helper.h"
+
+// Declare any constants here
+#define RECUR_DAILY         0x7F    ///< Every day of the week, bit 0 is Sunday like tm_wday
+#define RECUR_WEEKDAYS      0x3E    ///< Monday to Friday
+#define RECUR_WEEKENDS      0x41    ///< Saturday and Sunday
+#define RECUR_LINE_LENGTH   512     ///< Longest line of a rule file, including the newline
+
+// Define struct for a recurrence rule, one rule stands for every occurrence it produces
+typedef struct {
+    uint32_t name; ///< Id of the name in activity_names
+    uint16_t start; ///< Start of the first occurrence in minutes since midnight
+    uint16_t length; ///< Duration of every occurrence in minutes
+    uint16_t every; ///< Minutes between the starts of two occurrences of a day, 0 for one occurrence
+    uint16_t until; ///< Latest start of an occurrence in minutes since midnight
+    uint8_t days; ///< Days of the week the rule applies to, bit 0 is Sunday
+} recur_rule;
+
+// Define struct for the rules of an agenda together with the days expanded so far
+typedef struct {
+    recur_rule* rules; ///< Rules in the order they were added
+    size_t count; ///< Number of rules
+    size_t capacity; ///< Number of rules the array has room for
+    activity* expanded[7]; ///< Occurrences of every day of the week, NULL until the day is first needed
+    size_t expanded_count[7]; ///< Number of occurrences in expanded
+} recur_set;
+
+/**
+ * @brief Initializes an empty rule set
+ *
+ * @param[out] r Pointer to the rule set to initialize
+ */
+void recur_init(recur_set* r); ///< Function for creating a rule set
+
+/**
+ * @brief Releases the rules and the cached occurrences
+ *
+ * @param[in,out] r Pointer to the rule set to free
+ */
+void recur_free(recur_set* r); ///< Function for freeing a rule set
+
+/**
+ * @brief Adds a rule, the cached occurrences are dropped
+ *
+ * @param[in,out] r Pointer to the rule set
+ * @param[in] rule Pointer to the rule to copy
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int recur_add(recur_set* r, const recur_rule* rule); ///< Function for adding a rule
+
+/**
+ * @brief Parses one line of a rule file
+ *
+ * A rule reads "DAYS HH:MM HH:MM [every N(m|h)] [until HH:MM] name". DAYS is "daily", "weekdays", "weekends"
+ * or a comma separated list of "sun" to "sat". The times are those of the first occurrence, "every" repeats it
+ * through the day and "until" gives the latest start of a repetition.
+ *
+ * @param[in] line Line to parse, the newline may still be there
+ * @param[out] rule Pointer to the rule to fill
+ *
+ * @return Returns 1 if a rule was read, 0 if the line is blank or a comment, -1 if it is invalid
+ */
+int recur_parse(const char* line, recur_rule* rule); ///< Function for parsing a rule
+
+/**
+ * @brief Adds every rule of a rule file
+ *
+ * @param[in,out] r Pointer to the rule set
+ * @param[in] path Path of the rule file
+ * @param[out] line Pointer receiving the number of the invalid line, 0 if the file could not be read
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int recur_load(recur_set* r, const char* path, size_t* line); ///< Function for reading a rule file
+
+/**
+ * @brief Returns the occurrences of the rules on a day of the week
+ *
+ * The day is expanded the first time it is asked for and kept, so the cache holds at most one list for every
+ * day of the week however long the agenda runs.
+ *
+ * @param[in,out] r Pointer to the rule set
+ * @param[in] wday Day of the week, 0 for Sunday like tm_wday
+ * @param[out] day Pointer receiving the occurrences, ordered by rule and then by start
+ * @param[out] n Pointer receiving the number of occurrences
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int recur_expand(recur_set* r, int wday, const activity** day, size_t* n); ///< Function for expanding a day
+
+#endif /* HEADER_RECUR_H */
@@ -0,0 +1,313 @@
+/**
+ * @file Render.c
+ * @brief This file contains the renderer that collects the output of a tick and writes it in one go.
+ *
+ * The agenda used to print every message with its own printf() and clear the screen with escape sequences in
+ * between, so a slow serial or SSH terminal saw many small writes and a flickering screen. Now the messages go
+ * into a frame in memory, and once per tick only the rows that differ from what is on the screen are rewritten,
+ * with a single write().
+ */
+
+#include "Render.h"
+#include "Stats.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+static bool frames = false;  // Draw frames instead of a plain log
+static int rows = 24;  // Height of the terminal
+static int cols = 80;  // Width of the terminal
+static char header[RENDER_HEADER_ROWS][RENDER_MAX_COLS + 1];  // Status rows
+static char messages[RENDER_MAX_ROWS][RENDER_MAX_COLS + 1];  // Latest messages, a ring starting at first_message
+static int first_message = 0;  // Index of the oldest message in messages
+static int message_count = 0;  // Number of messages in messages
+static char prompt[RENDER_MAX_COLS + 1];  // Question waiting for an answer, or empty
+static char shown[RENDER_MAX_ROWS][RENDER_MAX_COLS + 1];  // Rows on the screen after the previous flush
+static int shown_count = 0;  // Number of rows in shown
+static bool changed = false;  // Set when the frame may differ from the screen
+static bool seen_input = false;  // Set when the terminal echoed a line over the frame
+static volatile sig_atomic_t size_changed = 1;  // Set when the terminal has to be measured and redrawn
+static char out[RENDER_BUFFER_SIZE];  // Output collected since the previous flush
+static size_t out_len = 0;  // Number of bytes in out
+
+
+/**
+ * @brief Writes a buffer to standard output, waiting for a non-blocking terminal when it is not ready
+ *
+ * @param[in] buf Bytes to write
+ * @param[in] len Number of bytes
+ */
+static void write_out(const char* buf, size_t len) {
+    while (len) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        stats_count(STATS_WRITE);
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                struct pollfd fd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+                poll(&fd, 1, -1);
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+
+/**
+ * @brief Adds bytes to the output, writing what was collected first if they do not fit
+ *
+ * @param[in] buf Bytes to add
+ * @param[in] len Number of bytes
+ */
+static void append(const char* buf, size_t len) {
+    if (out_len + len > sizeof(out)) {
+        write_out(out, out_len);
+        out_len = 0;
+    }
+    if (len > sizeof(out)) {
+        write_out(buf, len);
+        return;
+    }
+    memcpy(out + out_len, buf, len);
+    out_len += len;
+}
+
+
+/**
+ * @brief Adds a cursor movement to the output
+ *
+ * @param[in] row Row, 0 for the top one
+ * @param[in] col Column, 0 for the left one
+ */
+static void move_to(int row, int col) {
+    char seq[32];
+    int len = snprintf(seq, sizeof(seq), "\033[%d;%dH", row + 1, col + 1);
+
+    append(seq, (size_t)len);
+}
+
+
+/**
+ * @brief Returns how much of a row fits on the terminal
+ *
+ * @param[in] row Text of the row
+ *
+ * @return Returns the number of bytes to write, one column is kept free so the terminal never wraps
+ */
+static size_t visible(const char* row) {
+    size_t len = strlen(row);
+    size_t room = cols > 1 ? (size_t)cols - 1 : 1;
+
+    return len < room ? len : room;
+}
+
+
+/**
+ * @brief Builds the frame from the status rows, the latest messages that fit and the question
+ *
+ * @param[out] frame Rows of the frame
+ *
+ * @return Returns the number of rows, the question is the last one
+ */
+static int build_frame(char frame[][RENDER_MAX_COLS + 1]) {
+    int usable = rows < RENDER_MAX_ROWS ? rows : RENDER_MAX_ROWS;
+    int n = 0;
+
+    for (int h = 0; h < RENDER_HEADER_ROWS; h++) {
+        memcpy(frame[n++], header[h], sizeof(header[h]));
+    }
+    frame[n++][0] = '\0';
+
+    // Keep the newest messages when the screen is too small for all of them
+    int room = usable - n - 1;
+    int count = message_count < room ? message_count : (room > 0 ? room : 0);
+    for (int k = message_count - count; k < message_count; k++) {
+        memcpy(frame[n++], messages[(first_message + k) % RENDER_MAX_ROWS], RENDER_MAX_COLS + 1);
+    }
+    memcpy(frame[n++], prompt, sizeof(prompt));
+    return n;
+}
+
+
+/**
+ * @brief Writes the rows of the frame that differ from the screen
+ */
+static void draw_frame(void) {
+    static char frame[RENDER_MAX_ROWS + RENDER_HEADER_ROWS + 2][RENDER_MAX_COLS + 1];
+    bool redraw = false;
+
+    if (size_changed) {
+        struct winsize ws;
+        size_changed = 0;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col) {
+            rows = ws.ws_row;
+            cols = ws.ws_col;
+        }
+        redraw = true;
+    }
+    if (!changed && !redraw && !seen_input) {
+        return;
+    }
+
+    int n = build_frame(frame);
+    int question = n - 1;
+    if (redraw) {
+        append("\033[H\033[2J", 7);
+    }
+    for (int r = 0; r < n; r++) {
+        // The question row also holds the echo of what the user typed
+        if (redraw || r >= shown_count || strcmp(frame[r], shown[r]) || (seen_input && r == question)) {
+            move_to(r, 0);
+            append(frame[r], visible(frame[r]));
+            append("\033[K", 3);
+            memcpy(shown[r], frame[r], sizeof(frame[r]));
+        }
+    }
+    // Clear the rows left over from a longer frame and the line the echoed newline moved to
+    if (!redraw && (n < shown_count || seen_input)) {
+        move_to(n, 0);
+        append("\033[J", 3);
+    }
+    shown_count = n;
+
+    size_t len = visible(frame[question]);
+    move_to(question, len ? (int)len + 1 : 0);
+    changed = false;
+    seen_input = false;
+}
+
+
+/**
+ * @brief Formats a row, cutting it at RENDER_MAX_COLS characters
+ *
+ * @param[out] row Row to fill
+ * @param[in] fmt Format string like printf()
+ * @param[in] ap Arguments of the format string
+ */
+static void format_row(char* row, const char* fmt, va_list ap) {
+    vsnprintf(row, RENDER_MAX_COLS + 1, fmt, ap);
+}
+
+
+void render_init(bool draw_frames) {
+    frames = draw_frames;
+    memset(header, 0, sizeof(header));
+    first_message = 0;
+    message_count = 0;
+    prompt[0] = '\0';
+    shown_count = 0;
+    changed = true;
+    seen_input = false;
+    size_changed = 1;
+    out_len = 0;
+}
+
+
+bool render_frames(void) {
+    return frames;
+}
+
+
+void render_header(int row, const char* fmt, ...) {
+    char text[RENDER_MAX_COLS + 1];
+    va_list ap;
+
+    if (!frames || row < 0 || row >= RENDER_HEADER_ROWS) {
+        return;
+    }
+    va_start(ap, fmt);
+    format_row(text, fmt, ap);
+    va_end(ap);
+    if (strcmp(text, header[row])) {
+        memcpy(header[row], text, sizeof(text));
+        changed = true;
+    }
+}
+
+
+void render_message(const char* fmt, ...) {
+    char text[RENDER_MAX_COLS + 1];
+    va_list ap;
+
+    va_start(ap, fmt);
+    format_row(text, fmt, ap);
+    va_end(ap);
+
+    if (!frames) {
+        append(text, strlen(text));
+        append("\n", 1);
+        return;
+    }
+    if (message_count == RENDER_MAX_ROWS) {
+        first_message = (first_message + 1) % RENDER_MAX_ROWS;
+        message_count--;
+    }
+    memcpy(messages[(first_message + message_count++) % RENDER_MAX_ROWS], text, sizeof(text));
+    changed = true;
+}
+
+
+void render_prompt(const char* fmt, ...) {
+    char text[RENDER_MAX_COLS + 1];
+    va_list ap;
+
+    va_start(ap, fmt);
+    format_row(text, fmt, ap);
+    va_end(ap);
+
+    if (!frames) {
+        if (*text) {
+            append(text, strlen(text));
+            append("\t", 1);
+        }
+        return;
+    }
+    if (strcmp(text, prompt)) {
+        memcpy(prompt, text, sizeof(text));
+        changed = true;
+    }
+}
+
+
+void render_clear(void) {
+    if (frames && message_count) {
+        first_message = 0;
+        message_count = 0;
+        changed = true;
+    }
+}
+
+
+void render_input_seen(void) {
+    seen_input = true;
+}
+
+
+void render_resized(void) {
+    size_changed = 1;
+}
+
+
+size_t render_flush(void) {
+    if (frames) {
+        draw_frame();
+    }
+
+    size_t len = out_len;
+    if (len) {
+        write_out(out, len);
+        out_len = 0;
+    }
+    return len;
+}
@@ -0,0 +1,80 @@
+#ifndef HEADER_RENDER_H
+#define HEADER_RENDER_H
+
+// Include any necessary headers here
+#include <stdbool.h>
+#include <stddef.h>
+
+// Declare any constants here
+#define RENDER_HEADER_ROWS  2       ///< Status rows at the top of the frame, set with render_header()
+#define RENDER_MAX_ROWS     48      ///< Most rows a frame uses, whatever the size of the terminal
+#define RENDER_MAX_COLS     160     ///< Most columns a row uses, longer rows are cut
+#define RENDER_BUFFER_SIZE  16384   ///< Bytes of output collected before they have to be written
+
+/**
+ * @brief Sets up the renderer for standard output
+ *
+ * In frame mode the screen is a frame of status rows, the latest messages and the open question, and every flush
+ * only rewrites the rows that changed. Otherwise the output is a plain log, as for a pipe or a file, and every
+ * flush writes what was added since the previous one. In both modes a flush is a single write().
+ *
+ * @param[in] frames True to draw frames, which only makes sense when standard output is a terminal
+ */
+void render_init(bool frames); ///< Function for setting up the renderer
+
+/**
+ * @brief Checks if the renderer draws frames
+ *
+ * @return Returns true in frame mode, false for a plain log
+ */
+bool render_frames(void); ///< Function for checking the render mode
+
+/**
+ * @brief Sets a status row of the frame, ignored for a plain log
+ *
+ * @param[in] row Index of the row, less than RENDER_HEADER_ROWS
+ * @param[in] fmt Format string like printf()
+ */
+void render_header(int row, const char* fmt, ...) __attribute__((format(printf, 2, 3))); ///< Function for setting a status row
+
+/**
+ * @brief Adds a message, like a reminder or the reply to a query
+ *
+ * @param[in] fmt Format string like printf(), without the newline
+ */
+void render_message(const char* fmt, ...) __attribute__((format(printf, 1, 2))); ///< Function for adding a message
+
+/**
+ * @brief Sets the question waiting for an answer, an empty string removes it
+ *
+ * @param[in] fmt Format string like printf()
+ */
+void render_prompt(const char* fmt, ...) __attribute__((format(printf, 1, 2))); ///< Function for setting the question
+
+/**
+ * @brief Removes every message from the frame, ignored for a plain log
+ */
+void render_clear(void); ///< Function for clearing the messages
+
+/**
+ * @brief Tells the renderer that the user typed a line, the terminal echoed it over the frame
+ */
+void render_input_seen(void); ///< Function for reporting echoed input
+
+/**
+ * @brief Makes the next flush measure the terminal again and redraw the whole frame
+ *
+ * Only sets a flag, so it may be called from a SIGWINCH handler.
+ */
+void render_resized(void); ///< Function for reporting a resized terminal
+
+/**
+ * @brief Writes the changes since the previous flush with a single write()
+ *
+ * Nothing is written if nothing changed. A terminal in non-blocking mode that is not ready is waited for.
+ *
+ * @return Returns the number of bytes written
+ */
+size_t render_flush(void); ///< Function for drawing the frame
+
+#endif /* HEADER_RENDER_H */
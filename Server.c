@@ -0,0 +1,507 @@
+/**
+ * @file Server.c
+ * @brief This file contains the multi-agenda server that schedules many residents in one process.
+ *
+ * Residents do not own a copy of their agenda. They refer to one of a few shared packed schedules and only keep
+ * their own done bits. The start and warning events of all schedules are kept in one timer wheel. On every tick
+ * the schedules with expired events are scanned with the due kernel and the resulting masks are fanned out to a
+ * fixed pool of workers, each owning a shard of the residents.
+ */
+
+#include "Server.h"
+
+#include <errno.h>
+
+
+/**
+ * @brief Collects the schedule of an expired event, called by the timer wheel
+ *
+ * @param[in,out] ctx Pointer to the server
+ * @param[in] id Id of the expired timer
+ * @param[in] data Index of the event
+ * @param[in] expiry Minute the event was scheduled for
+ */
+static void collect_due(void* ctx, uint32_t id, uint32_t data, uint32_t expiry) {
+    server* srv = ctx;
+    uint32_t s = srv->events[data].schedule;
+
+    (void)id;
+    (void)expiry;
+    // The due kernel finds every event of the schedule at the minute, one entry per schedule is enough
+    if (!bitset_test(&srv->pending, s)) {
+        bitset_set(&srv->pending, s);
+        srv->due[srv->due_count++].schedule = s;
+    }
+}
+
+
+/**
+ * @brief Returns the minute of the day an event fires at
+ *
+ * @param[in] srv Pointer to the server
+ * @param[in] e Pointer to the event
+ *
+ * @return Returns the minute
+ */
+static uint32_t event_minute(const server* srv, const server_event* e) {
+    const packed_agenda* p = &srv->schedules[e->schedule];
+
+    return e->kind == EVENT_START ? p->start[e->activity] : p->warning[e->activity];
+}
+
+
+/**
+ * @brief Appends a reminder to the output buffer of a worker
+ *
+ * @param[in,out] w Pointer to the worker
+ * @param[in] id Id of the resident
+ * @param[in] activity Index of the activity in the schedule of the resident
+ * @param[in] kind EVENT_START or EVENT_WARNING
+ * @param[in] name Name of the activity
+ * @param[in] minute Minute of the day the event was due at
+ */
+static void emit(server_worker* w, uint32_t id, uint32_t activity, uint32_t kind, const char* name, uint32_t minute) {
+    w->fired++;
+    if (w->srv->notes) {
+        notify_post(&w->batch, id, kind == EVENT_START ? NOTIFY_START : NOTIFY_WARNING, (int)minute, name);
+    }
+    if (w->srv->history) {
+        history_add(&w->events, w->srv->day_start + (int64_t)minute * 60000, id, activity,
+            kind == EVENT_START ? HISTORY_START : HISTORY_WARNING, 0);
+    }
+    if (w->srv->quiet) {
+        return;
+    }
+
+    // Make room for the longest possible line
+    size_t need = w->out_len + strlen(name) + 64;
+    if (need > w->out_cap) {
+        size_t cap = w->out_cap ? w->out_cap : 4096;
+        while (cap < need) {
+            cap *= 2;
+        }
+        char* out = realloc(w->out, cap);
+        if (!out) {
+            return;
+        }
+        w->out = out;
+        w->out_cap = cap;
+    }
+
+    if (kind == EVENT_START) {
+        w->out_len += (size_t)sprintf(w->out + w->out_len, "[resident %u] Time for %s\n", id, name);
+    }
+    else {
+        w->out_len += (size_t)sprintf(w->out + w->out_len, "[resident %u] Don't forget to do %s in 10 minutes!\n", id, name);
+    }
+}
+
+
+/**
+ * @brief Sends the reminders of the residents of one worker for the activities of a mask
+ *
+ * @param[in,out] w Pointer to the worker
+ * @param[in] schedule Index of the schedule
+ * @param[in] mask Activities due, one bit per activity of the schedule
+ * @param[in] kind EVENT_START or EVENT_WARNING
+ */
+static void emit_mask(server_worker* w, uint32_t schedule, const uint64_t* mask, uint32_t kind) {
+    server* srv = w->srv;
+    const packed_agenda* p = &srv->schedules[schedule];
+    size_t words = bitset_words(p->count);
+
+    for (size_t j = 0; j < words; j++) {
+        for (uint64_t bits = mask[j]; bits; bits &= bits - 1) {
+            uint64_t bit = bits & -bits;
+            uint32_t i = (uint32_t)(j * BITSET_WORD_BITS + (size_t)__builtin_ctzll(bits));
+            const char* name = pool_get(&activity_names, p->name[i], NULL);
+
+            for (uint32_t m = w->member_offsets[schedule]; m < w->member_offsets[schedule + 1]; m++) {
+                uint32_t id = w->members[m];
+                if (!(srv->done[srv->residents[id].done_offset + j] & bit)) {
+                    emit(w, id, i, kind, name, srv->due_minute);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Sends the reminders of the residents of one worker for the current tick
+ *
+ * @param[in,out] w Pointer to the worker
+ */
+static void run_shard(server_worker* w) {
+    server* srv = w->srv;
+    for (uint32_t k = 0; k < srv->due_count; k++) {
+        const server_due* d = &srv->due[k];
+
+        emit_mask(w, d->schedule, d->starts, EVENT_START);
+        emit_mask(w, d->schedule, d->warnings, EVENT_WARNING);
+    }
+
+    // Every worker hands its own batch over, a slow destination never holds up the shards
+    if (srv->notes) {
+        notify_submit(srv->notes, &w->batch);
+    }
+
+    // One write per worker and tick
+    for (size_t off = 0; off < w->out_len;) {
+        ssize_t n = write(STDOUT_FILENO, w->out + off, w->out_len - off);
+        if (n <= 0) {
+            break;
+        }
+        off += (size_t)n;
+    }
+    w->out_len = 0;
+}
+
+
+/**
+ * @brief Thread function of a worker
+ *
+ * @param[in] arg Pointer to the worker
+ *
+ * @return Returns NULL
+ */
+static void* worker_main(void* arg) {
+    server_worker* w = arg;
+    server* srv = w->srv;
+
+    // The barriers count every worker, so none enters them before server_start() knows they all started
+    pthread_mutex_lock(&srv->start_gate);
+    pthread_mutex_unlock(&srv->start_gate);
+    if (!srv->running) {
+        return NULL;
+    }
+    while (1) {
+        pthread_barrier_wait(&srv->tick_start);
+        if (!srv->running) {
+            break;
+        }
+        run_shard(w);
+        pthread_barrier_wait(&srv->tick_end);
+    }
+    return NULL;
+}
+
+
+int server_init(server* srv, const activity_store* schedules, size_t schedule_count) {
+    size_t events = 0;
+    size_t mask_words = 0;
+
+    memset(srv, 0, sizeof(*srv));
+    wheel_init(&srv->wheel, 0);
+    for (int k = 0; k < SERVER_MAX_WORKERS; k++) {
+        history_init(&srv->workers[k].events);
+    }
+
+    for (size_t s = 0; s < schedule_count; s++) {
+        events += 2 * schedules[s].count;
+        mask_words += 2 * bitset_words(schedules[s].count);
+    }
+    srv->schedules = calloc(schedule_count ? schedule_count : 1, sizeof(packed_agenda));
+    srv->events = malloc((events ? events : 1) * sizeof(server_event));
+    srv->due = malloc((schedule_count ? schedule_count : 1) * sizeof(server_due));
+    srv->grids = calloc(schedule_count ? schedule_count : 1, sizeof(day_grid));
+    srv->pending = (bitset){ calloc(bitset_words(schedule_count) + 1, sizeof(uint64_t)), schedule_count };
+    srv->masks = malloc((mask_words ? mask_words : 1) * sizeof(uint64_t));
+    srv->mask_offsets = malloc((schedule_count ? schedule_count : 1) * sizeof(size_t));
+    if (!srv->schedules || !srv->events || !srv->due || !srv->grids || !srv->pending.words || !srv->masks
+        || !srv->mask_offsets) {
+        server_free(srv);
+        return -1;
+    }
+    mask_words = 0;
+    for (size_t s = 0; s < schedule_count; s++) {
+        srv->mask_offsets[s] = mask_words;
+        mask_words += 2 * bitset_words(schedules[s].count);
+    }
+
+    for (size_t s = 0; s < schedule_count; s++) {
+        packed_agenda* p = &srv->schedules[s];
+        if (packed_build(p, &schedules[s])) {
+            server_free(srv);
+            return -1;
+        }
+        srv->schedule_count++;
+
+        for (size_t i = 0; i < p->count; i++) {
+            srv->events[srv->event_count++] = (server_event){ (uint32_t)s, (uint32_t)i, EVENT_START };
+            if (p->warning[i] != KERNEL_NEVER) {
+                srv->events[srv->event_count++] = (server_event){ (uint32_t)s, (uint32_t)i, EVENT_WARNING };
+            }
+        }
+    }
+
+    // Schedule once from midnight so the timer pool gets allocated here and never again
+    for (uint32_t k = 0; k < srv->event_count; k++) {
+        if (wheel_add(&srv->wheel, event_minute(srv, &srv->events[k]), k) == WHEEL_INVALID) {
+            server_free(srv);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int server_add_residents(server* srv, const uint32_t* assign, size_t count) {
+    size_t words = 0;
+
+    srv->residents = malloc((count ? count : 1) * sizeof(resident));
+    if (!srv->residents) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        srv->residents[i] = (resident){ assign[i], (uint32_t)words };
+        words += bitset_words(srv->schedules[assign[i]].count);
+    }
+
+    srv->done = calloc(words ? words : 1, sizeof(uint64_t));
+    if (!srv->done) {
+        return -1;
+    }
+    srv->resident_count = count;
+    return 0;
+}
+
+
+int server_start(server* srv, int workers, int quiet) {
+    if (workers < 1 || workers > SERVER_MAX_WORKERS) {
+        return -1;
+    }
+    srv->quiet = quiet;
+
+    // Shard the residents by id and group each shard by schedule with a counting sort
+    for (int k = 0; k < workers; k++) {
+        server_worker* w = &srv->workers[k];
+        w->srv = srv;
+        w->index = k;
+        w->member_offsets = calloc(srv->schedule_count + 1, sizeof(uint32_t));
+        w->members = malloc((srv->resident_count / (size_t)workers + 1) * sizeof(uint32_t));
+        if (!w->member_offsets || !w->members) {
+            return -1;
+        }
+    }
+    for (size_t id = 0; id < srv->resident_count; id++) {
+        srv->workers[id % (size_t)workers].member_offsets[srv->residents[id].schedule + 1]++;
+    }
+    for (int k = 0; k < workers; k++) {
+        server_worker* w = &srv->workers[k];
+        for (size_t s = 0; s < srv->schedule_count; s++) {
+            w->member_offsets[s + 1] += w->member_offsets[s];
+        }
+    }
+    for (size_t id = 0; id < srv->resident_count; id++) {
+        server_worker* w = &srv->workers[id % (size_t)workers];
+        // member_offsets[s] is used as the insert position and shifted back below
+        w->members[w->member_offsets[srv->residents[id].schedule]++] = (uint32_t)id;
+    }
+    for (int k = 0; k < workers; k++) {
+        server_worker* w = &srv->workers[k];
+        memmove(w->member_offsets + 1, w->member_offsets, srv->schedule_count * sizeof(uint32_t));
+        w->member_offsets[0] = 0;
+    }
+
+    if (pthread_mutex_init(&srv->start_gate, NULL)) {
+        return -1;
+    }
+    if (pthread_barrier_init(&srv->tick_start, NULL, (unsigned)workers + 1)) {
+        pthread_mutex_destroy(&srv->start_gate);
+        return -1;
+    }
+    if (pthread_barrier_init(&srv->tick_end, NULL, (unsigned)workers + 1)) {
+        pthread_barrier_destroy(&srv->tick_start);
+        pthread_mutex_destroy(&srv->start_gate);
+        return -1;
+    }
+
+    int failed = 0;
+    pthread_mutex_lock(&srv->start_gate);
+    srv->running = 1;
+    for (int k = 0; k < workers; k++) {
+        failed = pthread_create(&srv->workers[k].thread, NULL, worker_main, &srv->workers[k]);
+        if (failed) {
+            // The threads already running leave at the gate instead of waiting for the missing ones
+            srv->running = 0;
+            break;
+        }
+        srv->worker_count++;
+    }
+    pthread_mutex_unlock(&srv->start_gate);
+    if (srv->running) {
+        return 0;
+    }
+
+    for (int k = 0; k < srv->worker_count; k++) {
+        pthread_join(srv->workers[k].thread, NULL);
+    }
+    srv->worker_count = 0;
+    pthread_barrier_destroy(&srv->tick_start);
+    pthread_barrier_destroy(&srv->tick_end);
+    pthread_mutex_destroy(&srv->start_gate);
+    errno = failed;
+    return -1;
+}
+
+
+void server_tick(server* srv, int minute) {
+    int64_t next;
+
+    // The masks of a schedule hold a single minute, so a wheel that fell behind catches up minute by minute
+    while ((next = wheel_next(&srv->wheel)) >= 0 && next <= minute) {
+        srv->due_count = 0;
+        srv->due_minute = (uint32_t)next;
+        wheel_advance(&srv->wheel, (uint32_t)next, collect_due, srv);
+
+        // Find the activities of the due schedules, from their grid or by comparing the minute against all of them
+        for (uint32_t k = 0; k < srv->due_count; k++) {
+            server_due* d = &srv->due[k];
+            const packed_agenda* p = &srv->schedules[d->schedule];
+            const day_grid* g = &srv->grids[d->schedule];
+
+            bitset_clear(&srv->pending, d->schedule);
+            // A built grid answers with a row lookup
+            if (g->bits) {
+                d->starts = day_grid_row(g, GRID_STARTS, (int)next);
+                d->warnings = day_grid_row(g, GRID_WARNINGS, (int)next);
+                continue;
+            }
+            uint64_t* masks = srv->masks + srv->mask_offsets[d->schedule];
+            bitset starts = { masks, p->count };
+            bitset warnings = { masks + bitset_words(p->count), p->count };
+
+            packed_due(p, (int)next, &starts, &warnings);
+            d->starts = starts.words;
+            d->warnings = warnings.words;
+        }
+        if (!srv->due_count || !srv->worker_count) {
+            continue;
+        }
+        pthread_barrier_wait(&srv->tick_start);
+        pthread_barrier_wait(&srv->tick_end);
+
+        // The workers are parked at the barrier, their buffers are handed over without a lock
+        if (srv->history) {
+            for (int k = 0; k < srv->worker_count; k++) {
+                history_merge(srv->history, &srv->workers[k].events);
+            }
+        }
+    }
+    wheel_advance(&srv->wheel, (uint32_t)minute, collect_due, srv);
+}
+
+
+int server_next(const server* srv) {
+    return (int)wheel_next(&srv->wheel);
+}
+
+
+void server_seek(server* srv, int minute) {
+    // The timer pool already has room for every event, so this does not allocate
+    wheel_clear(&srv->wheel, (uint32_t)minute);
+    for (uint32_t k = 0; k < srv->event_count; k++) {
+        uint32_t m = event_minute(srv, &srv->events[k]);
+        if (m >= (uint32_t)minute) {
+            wheel_add(&srv->wheel, m, k);
+        }
+    }
+}
+
+
+int server_mark_done(server* srv, uint32_t id, uint32_t activity) {
+    if (id >= srv->resident_count || activity >= srv->schedules[srv->residents[id].schedule].count) {
+        return -1;
+    }
+
+    bitset done = { srv->done + srv->residents[id].done_offset, srv->schedules[srv->residents[id].schedule].count };
+    bitset_set(&done, activity);
+    return 0;
+}
+
+
+void server_new_day(server* srv) {
+    size_t words = 0;
+
+    for (size_t id = 0; id < srv->resident_count; id++) {
+        words += bitset_words(srv->schedules[srv->residents[id].schedule].count);
+    }
+    memset(srv->done, 0, words * sizeof(uint64_t));
+    server_seek(srv, 0);
+}
+
+
+uint64_t server_fired(const server* srv) {
+    uint64_t fired = 0;
+
+    for (int k = 0; k < srv->worker_count; k++) {
+        fired += srv->workers[k].fired;
+    }
+    return fired;
+}
+
+
+size_t server_resident_bytes(const server* srv) {
+    size_t bytes = 0;
+
+    if (!srv->resident_count) {
+        return 0;
+    }
+    for (size_t id = 0; id < srv->resident_count; id++) {
+        // Resident record, its done words and its entry in the shard of its worker
+        bytes += sizeof(resident) + bitset_words(srv->schedules[srv->residents[id].schedule].count) * sizeof(uint64_t)
+            + sizeof(uint32_t);
+    }
+    return bytes / srv->resident_count;
+}
+
+
+long server_build_grids(server* srv) {
+    return day_grid_build_all(srv->grids, srv->schedules, srv->schedule_count, srv->worker_count);
+}
+
+
+const uint64_t* server_grid(const server* srv, size_t schedule, int plane, int minute) {
+    return day_grid_row(&srv->grids[schedule], plane, minute);
+}
+
+
+void server_free(server* srv) {
+    if (srv->running) {
+        srv->running = 0;
+        pthread_barrier_wait(&srv->tick_start);
+        for (int k = 0; k < srv->worker_count; k++) {
+            pthread_join(srv->workers[k].thread, NULL);
+        }
+        pthread_barrier_destroy(&srv->tick_start);
+        pthread_barrier_destroy(&srv->tick_end);
+        pthread_mutex_destroy(&srv->start_gate);
+    }
+    for (int k = 0; k < SERVER_MAX_WORKERS; k++) {
+        free(srv->workers[k].members);
+        free(srv->workers[k].member_offsets);
+        free(srv->workers[k].out);
+        notify_batch_free(&srv->workers[k].batch);
+        history_close(&srv->workers[k].events);
+    }
+    wheel_free(&srv->wheel);
+    free(srv->events);
+    free(srv->due);
+    free(srv->pending.words);
+    free(srv->masks);
+    free(srv->mask_offsets);
+    for (size_t s = 0; s < srv->schedule_count; s++) {
+        packed_free(&srv->schedules[s]);
+    }
+    free(srv->schedules);
+    if (srv->grids) {
+        for (size_t s = 0; s < srv->schedule_count; s++) {
+            day_grid_free(&srv->grids[s]);
+        }
+        free(srv->grids);
+    }
+    free(srv->residents);
+    free(srv->done);
+    memset(srv, 0, sizeof(*srv));
+}
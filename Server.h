@@ -0,0 +1,223 @@
+#ifndef HEADER_SERVER_H
+#define HEADER_SERVER_H
+
+// Include any necessary headers here
+#include "Packed.h"
+#include "DayGrid.h"
+#include "Wheel.h"
+#include "Notify.h"
+#include "History.h"
+
+// Declare any constants here
+#define SERVER_MAX_WORKERS  64 ///< Maximum number of worker threads
+#define EVENT_START         0  ///< Kind of an event announcing the start of an activity
+#define EVENT_WARNING       1  ///< Kind of an event reminding of an activity that ends in 10 minutes
+
+// Define struct for a resident scheduled by the server
+typedef struct {
+    uint32_t schedule; ///< Index of the shared schedule the resident follows
+    uint32_t done_offset; ///< First word of the done bits of the resident in the server's done array
+} resident;
+
+// Define struct for an event of a shared schedule
+typedef struct {
+    uint32_t schedule; ///< Index of the schedule
+    uint32_t activity; ///< Index of the activity in the schedule
+    uint32_t kind; ///< EVENT_START or EVENT_WARNING
+} server_event;
+
+// Define struct for a schedule with events at the minute being run
+typedef struct {
+    uint32_t schedule; ///< Index of the schedule
+    const uint64_t* starts; ///< Activities of the schedule starting at the minute, one bit per activity
+    const uint64_t* warnings; ///< Activities of the schedule whose warning is due at the minute
+} server_due;
+
+typedef struct server server;
+
+// Define struct for a worker thread and the residents it owns
+typedef struct {
+    server* srv; ///< Server the worker belongs to
+    int index; ///< Index of the worker
+    uint32_t* members; ///< Residents owned by the worker, grouped by schedule
+    uint32_t* member_offsets; ///< Start of the residents of every schedule in members, schedule_count + 1 entries
+    char* out; ///< Reminders written during the current tick
+    size_t out_len; ///< Number of bytes in out
+    size_t out_cap; ///< Number of bytes allocated for out
+    notify_batch batch; ///< Reminders of the current tick for the notifier
+    history events; ///< Reminders of the current tick for the history, merged into it after the tick
+    uint64_t fired; ///< Number of reminders sent so far
+    pthread_t thread; ///< Thread running the worker
+} server_worker;
+
+// Define struct for the multi-agenda server
+struct server {
+    packed_agenda* schedules; ///< Shared schedules
+    size_t schedule_count; ///< Number of schedules
+    resident* residents; ///< Residents
+    size_t resident_count; ///< Number of residents
+    uint64_t* done; ///< Done bits of all residents
+    server_event* events; ///< Start and warning events of all schedules
+    day_grid* grids; ///< Precomputed day of every schedule, built by server_build_grids()
+    uint32_t event_count; ///< Number of events
+    timer_wheel wheel; ///< Pending events, one tick per minute of the day, timer data indexes events
+    server_worker workers[SERVER_MAX_WORKERS]; ///< Worker pool
+    int worker_count; ///< Number of workers
+    pthread_barrier_t tick_start; ///< Releases the workers into a tick
+    pthread_barrier_t tick_end; ///< Waits for every worker to finish a tick
+    pthread_mutex_t start_gate; ///< Held by server_start() until every worker thread exists
+    server_due* due; ///< Schedules with events at the minute being run, room for every schedule
+    uint32_t due_count; ///< Number of schedules in due
+    uint32_t due_minute; ///< Minute being run
+    bitset pending; ///< Schedules already in due
+    uint64_t* masks; ///< Start and warning masks of every schedule, filled by packed_due() for the minute being run
+    size_t* mask_offsets; ///< First word of the masks of every schedule in masks
+    int quiet; ///< Flag indicating if reminders are only counted instead of written
+    notifier* notes; ///< Destinations the reminders are also sent to, set before server_start(), or NULL
+    history* history; ///< History the reminders are recorded in, or NULL
+    int64_t day_start; ///< Start of the current day in milliseconds since the epoch, the history is stamped from it
+    int running; ///< Flag cleared to stop the workers
+};
+
+/**
+ * @brief Creates a server from a set of schedules
+ *
+ * Every schedule is packed once and its start and warning events are scheduled in the shared timer wheel from
+ * midnight on.
+ *
+ * @param[out] srv Pointer to the server to initialize
+ * @param[in] schedules Activity stores of the schedules
+ * @param[in] schedule_count Number of schedules
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int server_init(server* srv, const activity_store* schedules, size_t schedule_count); ///< Function for creating a server
+
+/**
+ * @brief Adds residents to the server
+ *
+ * Resident i follows the schedule assign[i]. All residents have to be added before server_start().
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] assign Schedule of every resident
+ * @param[in] count Number of residents
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int server_add_residents(server* srv, const uint32_t* assign, size_t count); ///< Function for adding residents
+
+/**
+ * @brief Starts the worker pool
+ *
+ * Residents are sharded across the workers by id, so each resident is always handled by the same thread. If one
+ * of the threads cannot be started, the ones that were are stopped again before the function returns.
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] workers Number of worker threads
+ * @param[in] quiet Nonzero to only count reminders instead of writing them to stdout
+ *
+ * @return Returns 0 on success, -1 with errno set if the workers could not be started
+ */
+int server_start(server* srv, int workers, int quiet); ///< Function for starting the worker pool
+
+/**
+ * @brief Sends the reminders of every resident due at a minute
+ *
+ * The wheel is advanced to the minute, one minute with events at a time when it has fallen behind. For every
+ * schedule with expired events, the start and warning rows of its grid are looked up once server_build_grids()
+ * built it, otherwise packed_due() compares the minute against all of its activities at once. The masks are handed
+ * to all workers, which skip the activities every resident already did. The
+ * function returns once every worker has finished the tick and their reminders are buffered in the history, if any.
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] minute Minute of the day
+ */
+void server_tick(server* srv, int minute); ///< Function for running one tick of all agendas
+
+/**
+ * @brief Finds the minute of the next pending event
+ *
+ * @param[in] srv Pointer to the server
+ *
+ * @return Returns the next minute with events, or -1 if nothing is left today
+ */
+int server_next(const server* srv); ///< Function for finding the next boundary
+
+/**
+ * @brief Reschedules every event of the day, skipping those before the given minute
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] minute Minute of the day
+ */
+void server_seek(server* srv, int minute); ///< Function for positioning the server in the day
+
+/**
+ * @brief Marks an activity of a resident as done
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] id Id of the resident
+ * @param[in] activity Index of the activity in the schedule of the resident
+ *
+ * @return Returns 0 on success, -1 if the resident or the activity does not exist
+ */
+int server_mark_done(server* srv, uint32_t id, uint32_t activity); ///< Function for completing an activity
+
+/**
+ * @brief Clears the done bits of every resident and reschedules the whole day, used when a new day starts
+ *
+ * @param[in,out] srv Pointer to the server
+ */
+void server_new_day(server* srv); ///< Function for starting a new day
+
+/**
+ * @brief Returns the number of reminders sent so far
+ *
+ * @param[in] srv Pointer to the server
+ *
+ * @return Returns the number of reminders
+ */
+uint64_t server_fired(const server* srv); ///< Function for counting reminders
+
+/**
+ * @brief Returns the memory used per resident
+ *
+ * @param[in] srv Pointer to the server
+ *
+ * @return Returns the number of bytes of resident, done and shard data per resident
+ */
+size_t server_resident_bytes(const server* srv); ///< Function for measuring the per-resident footprint
+
+/**
+ * @brief Builds the minute-by-minute grids of the schedules that have none yet
+ *
+ * The grids are built in parallel with one thread per worker, or one per CPU before server_start(). The schedules
+ * never change after server_init(), so every grid is built once. Afterwards server_grid() answers which activities
+ * of a schedule are in progress, start or are due for a warning at any minute with a single row lookup, and
+ * server_tick() reads the due activities from the same rows.
+ *
+ * @param[in,out] srv Pointer to the server
+ *
+ * @return Returns the number of grids built, or -1 if memory could not be allocated
+ */
+long server_build_grids(server* srv); ///< Function for precomputing the day of every schedule
+
+/**
+ * @brief Returns one row of the grid of a schedule
+ *
+ * @param[in] srv Pointer to the server, after server_build_grids()
+ * @param[in] schedule Index of the schedule
+ * @param[in] plane GRID_OCCUPANCY, GRID_STARTS or GRID_WARNINGS
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns the words of the row, bit i stands for activity i of the schedule
+ */
+const uint64_t* server_grid(const server* srv, size_t schedule, int plane, int minute); ///< Function for looking up a schedule at a minute
+
+/**
+ * @brief Stops the worker pool and releases the memory held by the server
+ *
+ * @param[in,out] srv Pointer to the server
+ */
+void server_free(server* srv); ///< Function for destroying a server
+
+#endif /* HEADER_SERVER_H */
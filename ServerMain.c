@@ -0,0 +1,471 @@
+/**
+ * @file ServerMain.c
+ * @brief This file contains the entry point of the multi-agenda server.
+ *
+ * The server loads one or more shared schedules, assigns them round-robin to the residents and runs all of them
+ * in one process. It either follows the simulated clock like the single agenda program, sleeping until the next
+ * boundary, or fast-forwards through whole days on a virtual clock to measure throughput.
+ */
+
+#include "Helper.h"
+#include "Agenda.h"
+#include "EventLoop.h"
+#include "Server.h"
+#include "Input.h"
+#include "Journal.h"
+#include "History.h"
+
+#include <signal.h>
+
+static journal done_log = { .fd = -1 }; // Log of the completions of all residents, only open with -j
+static history history_log = { .fd = -1 }; // Every reminder and completion of all residents, only open with -H
+
+
+/**
+ * @brief Requests a shutdown from a signal handler
+ *
+ * @param[in] sig Number of the signal
+ */
+static void handle_signal(int sig) {
+    (void)sig;
+    loop_request_shutdown();
+}
+
+
+/**
+ * @brief Reads CLOCK_MONOTONIC
+ *
+ * @return Returns the monotonic time in nanoseconds
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Returns the start of the local day of a time
+ *
+ * @param[in] t Pointer to the local time
+ * @param[in] now The same time as seconds since the epoch
+ *
+ * @return Returns the local midnight in milliseconds since the epoch
+ */
+static int64_t day_start_ms(const struct tm* t, time_t now) {
+    return ((int64_t)now - t->tm_hour * 3600 - t->tm_min * 60 - t->tm_sec) * 1000;
+}
+
+
+/**
+ * @brief Records a completion typed on stdin in the history
+ *
+ * The latency is the time since the latest reminder of the activity, the warning once it was sent.
+ *
+ * @param[in] srv Pointer to the server
+ * @param[in] id Id of the resident
+ * @param[in] act Index of the activity in the schedule of the resident, it must exist
+ */
+static void record_done(const server* srv, uint32_t id, uint32_t act) {
+    const packed_agenda* p = &srv->schedules[srv->residents[id].schedule];
+    int64_t now = clock_now_ns(&agenda_clock) / NSEC_PER_MSEC;
+    int minute = tm_minutes(time_info.local_time);
+    int reminder = p->warning[act] <= minute ? p->warning[act] : (p->start[act] <= minute ? p->start[act] : -1);
+    int64_t latency = reminder < 0 ? 0 : now - (srv->day_start + (int64_t)reminder * 60000);
+
+    if (history_add(&history_log, now, id, act, HISTORY_YES, latency > 0 ? (uint32_t)latency : 0)) {
+        perror("history");
+    }
+}
+
+
+/**
+ * @brief Fills an activity struct with an activity of the schedule of a resident
+ *
+ * @param[in] srv Pointer to the server
+ * @param[in] id Id of the resident
+ * @param[in] act Index of the activity in the schedule of the resident, it must exist
+ * @param[out] a Pointer to the activity to fill
+ */
+static void resident_activity(const server* srv, uint32_t id, uint32_t act, activity* a) {
+    const packed_agenda* p = &srv->schedules[srv->residents[id].schedule];
+
+    memset(a, 0, sizeof(*a));
+    a->name = p->name[act];
+    a->start_time = (atime){ p->start[act] / 60, p->start[act] % 60 };
+    a->end_time = (atime){ p->end[act] / 60, p->end[act] % 60 };
+}
+
+
+/**
+ * @brief Marks the activity of a logged completion as done again
+ *
+ * @param[in,out] ctx Pointer to the server
+ * @param[in] r Pointer to the logged completion
+ */
+static void replay_done(void* ctx, const journal_record* r) {
+    server* srv = ctx;
+    activity a;
+
+    // Skip completions of residents or activities that do not exist with these options
+    if (r->owner >= srv->resident_count || r->item >= srv->schedules[srv->residents[r->owner].schedule].count) {
+        return;
+    }
+    resident_activity(srv, r->owner, r->item, &a);
+    if (strncmp(activity_name(&a), r->name, MAX_LENGTH - 1) == 0) {
+        server_mark_done(srv, r->owner, r->item);
+    }
+}
+
+
+/**
+ * @brief Prints what every schedule looks like at a minute, from the precomputed grids
+ *
+ * @param[in] srv Pointer to the server
+ * @param[in] minute Minute of the day
+ */
+static void show_minute(const server* srv, int minute) {
+    static const char* const labels[GRID_PLANES] = { "in progress", "starting", "warning" };
+
+    for (size_t s = 0; s < srv->schedule_count; s++) {
+        const packed_agenda* p = &srv->schedules[s];
+        int empty = 1;
+
+        printf("[schedule %zu] %02d:%02d", s, minute / 60, minute % 60);
+        for (int plane = 0; plane < GRID_PLANES; plane++) {
+            const uint64_t* row = server_grid(srv, s, plane, minute);
+            int first = 1;
+
+            // Walk the set bits of the row, one activity each
+            for (size_t w = 0; w < bitset_words(p->count); w++) {
+                for (uint64_t bits = row[w]; bits; bits &= bits - 1) {
+                    size_t i = w * BITSET_WORD_BITS + (size_t)__builtin_ctzll(bits);
+                    if (first) {
+                        printf("  %s: ", labels[plane]);
+                    }
+                    else {
+                        printf(", ");
+                    }
+                    printf("%s", pool_get(&activity_names, p->name[i], NULL));
+                    first = 0;
+                    empty = 0;
+                }
+            }
+        }
+        printf("%s\n", empty ? "  nothing planned" : "");
+    }
+}
+
+
+/**
+ * @brief Handles a command typed on stdin
+ *
+ * "done <resident> <activity>" marks an activity of a resident as completed, "at HH:MM" or "at now" prints what
+ * every schedule looks like at that minute.
+ *
+ * @param[in,out] ctx Pointer to the server
+ * @param[in] line Line taken from the stdin reader
+ */
+static void handle_command(void* ctx, const input_line* line) {
+    server* srv = ctx;
+    unsigned id, act;
+    int minute = -1;
+
+    if (!line->truncated && strncmp(line->text, "at ", 3) == 0) {
+        minute = parse_query(line->text + 3, tm_minutes(time_info.local_time));
+    }
+    if (minute >= 0 && server_build_grids(srv) < 0) {
+        perror("grids");
+    }
+    else if (minute >= 0) {
+        show_minute(srv, minute);
+    }
+    else if (!line->truncated && sscanf(line->text, "done %u %u", &id, &act) == 2 && !server_mark_done(srv, id, act)) {
+        printf("[resident %u] activity %u marked as done.\n", id, act);
+        if (history_log.fd >= 0) {
+            record_done(srv, id, act);
+        }
+        if (done_log.path) {
+            activity a;
+            resident_activity(srv, id, act, &a);
+            if (journal_append(&done_log, id, act, &a)) {
+                perror("journal");
+            }
+        }
+    }
+    else {
+        printf("Please enter \"done <resident> <activity>\" or \"at HH:MM\"\n");
+    }
+    fflush(stdout);
+}
+
+
+/**
+ * @brief Runs the server on the simulated clock until it is stopped
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] log_path Path of the completion log, or NULL to keep the completions in memory only
+ *
+ * @return Returns 0 on success, 1 if the event loop could not be created or failed
+ */
+static int run_live(server* srv, const char* log_path) {
+    int today, status = 0;
+
+    if (loop_init() || input_start(&stdin_reader, STDIN_FILENO)
+        || loop_watch(input_fd(&stdin_reader), LOOP_INPUT)) {
+        perror("event loop");
+        return 1;
+    }
+
+    get_time(&time_info);
+    today = time_info.local_time->tm_yday;
+    srv->day_start = day_start_ms(time_info.local_time, time_info.current_time);
+
+    // Restore what the residents already did today before a crash or restart
+    if (log_path && journal_open(&done_log, log_path, journal_day(time_info.local_time), replay_done, srv)) {
+        perror(log_path);
+    }
+    server_seek(srv, tm_minutes(time_info.local_time));
+    while (!loop_stopped()) {
+        int now = tm_minutes(time_info.local_time);
+
+        server_tick(srv, now);
+
+        // One flush for the completions of every resident since the previous tick
+        if (done_log.path && journal_commit(&done_log)) {
+            perror(log_path);
+        }
+        if (history_log.fd >= 0 && history_commit(&history_log, clock_now_ns(&agenda_clock) / NSEC_PER_MSEC)) {
+            perror("history");
+        }
+
+        // Sleep until the next minute with events, or until midnight when nothing is left today
+        int next = server_next(srv);
+        int until = next < 0 ? MINUTES_PER_DAY : next;
+        time_t boundary = time_info.current_time - time_info.local_time->tm_sec + (time_t)(until - now) * 60;
+        loop_arm(clock_real_until(&agenda_clock, boundary));
+        uint32_t events = loop_wait();
+        if (events & LOOP_ERROR) {
+            perror("event loop");
+            status = 1;
+        }
+        if (events & LOOP_INPUT) {
+            input_drain(&stdin_reader, handle_command, srv);
+        }
+        get_time(&time_info);
+
+        if (time_info.local_time->tm_yday != today) {
+            // Send the reminders a stall across midnight made late before the day they belong to is dropped
+            server_tick(srv, MINUTES_PER_DAY - 1);
+            today = time_info.local_time->tm_yday;
+            srv->day_start = day_start_ms(time_info.local_time, time_info.current_time);
+            server_new_day(srv);
+            if (done_log.path && journal_new_day(&done_log, journal_day(time_info.local_time))) {
+                perror(log_path);
+            }
+        }
+    }
+    journal_close(&done_log);
+    input_stop(&stdin_reader);
+    loop_close();
+    return status;
+}
+
+
+/**
+ * @brief Runs whole days on a virtual clock and prints the throughput
+ *
+ * The virtual days follow each other from today on, so a history written this way spans as many days.
+ *
+ * @param[in,out] srv Pointer to the server
+ * @param[in] days Number of days to run
+ */
+static void run_fast(server* srv, int days) {
+    int64_t t0 = now_ns();
+    uint64_t ticks = 0;
+    time_t now = time(NULL);
+    struct tm local;
+
+    localtime_r(&now, &local);
+    int64_t first_day = day_start_ms(&local, now);
+    for (int d = 0; d < days; d++) {
+        srv->day_start = first_day + (int64_t)d * MINUTES_PER_DAY * 60000;
+        server_new_day(srv);
+        for (int m = server_next(srv); m >= 0; m = server_next(srv)) {
+            server_tick(srv, m);
+            if (history_log.fd >= 0 && history_commit(&history_log, srv->day_start + (int64_t)m * 60000)) {
+                perror("history");
+            }
+            ticks++;
+        }
+    }
+
+    double seconds = (double)(now_ns() - t0) / (double)NSEC_PER_SEC;
+    uint64_t fired = server_fired(srv);
+    fprintf(stderr, "runtime:     %.6f s\n", seconds);
+    fprintf(stderr, "ticks:       %llu\n", (unsigned long long)ticks);
+    fprintf(stderr, "reminders:   %llu (%.0f reminders/s)\n", (unsigned long long)fired, (double)fired / seconds);
+}
+
+
+/**
+ * @brief Prints how to call the server
+ *
+ * @param[in] name Name the program was started with
+ */
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-r residents] [-s schedules] [-n activities] [-w workers] [-x speed] [-f days] [-j journal] [-N sink] [-H history] [-g] [-q] [-h]\n", name);
+    fprintf(stderr, "  -r residents   number of residents (default 1000)\n");
+    fprintf(stderr, "  -s schedules   number of distinct schedules, 0 for the built-in one (default 0)\n");
+    fprintf(stderr, "  -n activities  activities per generated schedule (default 10)\n");
+    fprintf(stderr, "  -w workers     number of worker threads (default: number of CPUs)\n");
+    fprintf(stderr, "  -x speed       speed factor of the simulated clock (default 1)\n");
+    fprintf(stderr, "  -f days        fast-forward this many days and print the throughput\n");
+    fprintf(stderr, "  -j journal     log the completions to this file and restore them at startup\n");
+    fprintf(stderr, "  -N sink        also send the reminders to unix:PATH or tcp:HOST:PORT, may be repeated\n");
+    fprintf(stderr, "  -H history     record the reminders and completions in this file for grandmas-convert -H\n");
+    fprintf(stderr, "  -g             precompute the minute-by-minute grid of every schedule at startup\n");
+    fprintf(stderr, "  -q             count reminders instead of printing them\n");
+    fprintf(stderr, "  -h             print this help\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    int residents = 1000, schedules = 0, activities = 10, speed = 1, days = 0, quiet = 0, grids = 0, opt;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* log_path = NULL;
+    const char* history_path = NULL;
+    notifier notes = { .wake_fd = -1 };
+    server srv;
+
+    while ((opt = getopt(argc, argv, "r:s:n:w:x:f:j:N:H:gqh")) != -1) {
+        switch (opt) {
+        case 'r': residents = atoi(optarg); break;
+        case 's': schedules = atoi(optarg); break;
+        case 'n': activities = atoi(optarg); break;
+        case 'w': workers = atoi(optarg); break;
+        case 'x': speed = atoi(optarg); break;
+        case 'f': days = atoi(optarg); break;
+        case 'j': log_path = optarg; break;
+        case 'H': history_path = optarg; break;
+        case 'N':
+            if ((!notes.sink_count && notify_init(&notes)) || notify_add_sink(&notes, optarg)) {
+                perror(optarg);
+                return 2;
+            }
+            break;
+        case 'g': grids = 1; break;
+        case 'q': quiet = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (workers > SERVER_MAX_WORKERS) {
+        workers = SERVER_MAX_WORKERS;
+    }
+    if (residents < 1 || schedules < 0 || activities < 1 || workers < 1 || speed < 1 || days < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Build the shared schedules
+    size_t count = schedules ? (size_t)schedules : 1;
+    activity_store* stores = calloc(count, sizeof(activity_store));
+    activity* day = malloc((size_t)activities * sizeof(activity));
+    if (!stores || !day) {
+        perror("schedules");
+        return 1;
+    }
+    srand(1);
+    for (size_t s = 0; s < count; s++) {
+        const activity* src = default_day;
+        size_t n = default_day_count;
+        if (schedules) {
+            generate_day(day, (size_t)activities);
+            src = day;
+            n = (size_t)activities;
+        }
+        store_init(&stores[s], n);
+        for (size_t i = 0; i < n; i++) {
+            store_add(&stores[s], src[i].name, src[i].start_time, src[i].end_time);
+        }
+    }
+
+    int failed = server_init(&srv, stores, count);
+    for (size_t s = 0; s < count; s++) {
+        store_free(&stores[s]);
+    }
+    free(stores);
+    free(day);
+    if (failed) {
+        perror("server");
+        return 1;
+    }
+
+    // Residents follow the schedules round-robin
+    uint32_t* assign = malloc((size_t)residents * sizeof(uint32_t));
+    if (!assign) {
+        perror("residents");
+        return 1;
+    }
+    for (int i = 0; i < residents; i++) {
+        assign[i] = (uint32_t)((size_t)i % count);
+    }
+    if (notes.sink_count) {
+        if (notify_start(&notes)) {
+            perror("notify");
+            return 1;
+        }
+        srv.notes = &notes;
+    }
+    if (history_path) {
+        if (history_open(&history_log, history_path)) {
+            perror(history_path);
+            return 1;
+        }
+        srv.history = &history_log;
+    }
+    if (server_add_residents(&srv, assign, (size_t)residents) || server_start(&srv, workers, quiet)) {
+        perror("server");
+        return 1;
+    }
+    free(assign);
+
+    // Precompute the day of every schedule on the worker threads, otherwise the first "at" command does it
+    if (grids) {
+        int64_t grid_start = now_ns();
+        long built = server_build_grids(&srv);
+        if (built < 0) {
+            perror("grids");
+            return 1;
+        }
+        fprintf(stderr, "%ld schedule grid(s) built in %.3f ms\n", built, (double)(now_ns() - grid_start) / 1e6);
+    }
+
+    fprintf(stderr, "%d residents, %zu schedule(s), %d worker(s), %zu bytes per resident\n", residents, count, workers,
+        server_resident_bytes(&srv));
+
+    int status = 0;
+    if (days) {
+        run_fast(&srv, days);
+    }
+    else {
+        clock_start(&agenda_clock, time(NULL), speed);
+        status = run_live(&srv, log_path);
+    }
+    server_free(&srv);
+    history_close(&history_log);
+    if (notes.sink_count) {
+        notify_stop(&notes);
+        notify_report(&notes, stderr);
+        notify_free(&notes);
+    }
+    return status;
+}
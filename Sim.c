@@ -0,0 +1,339 @@
+/**
+ * @file Sim.c
+ * @brief This file contains the headless simulator used to benchmark the scheduling path.
+ *
+ * The simulator runs the same agenda ticks as the main loop, but against a virtual clock: instead of sleeping
+ * until the next boundary it jumps straight to it, and the prompts are answered from a script. A full day
+ * therefore runs as fast as the CPU allows and always produces the same events.
+ */
+
+#include "Helper.h"
+#include "Agenda.h"
+#include "Prompt.h"
+#include "AgendaFile.h"
+#include "Render.h"
+#include "Stats.h"
+
+#define SIM_START_YEAR          2024    // Year of the first simulated day
+#define SIM_QUERY_NOW           MINUTES_PER_DAY // Minute parse_queries() stores for "now", replaced when replayed
+
+// Define struct for the results of a simulation run
+typedef struct {
+    uint64_t ticks; // Number of agenda ticks run
+    uint64_t events; // Number of starts and warnings announced
+    stats_histogram latency; // Tick latencies
+} sim_result;
+
+static const char* answers = "n";   // Script of answers, 'y' for yes and anything else for no
+static size_t answer_count = 0;     // Number of answers given so far
+static int* queries = NULL;         // Decoded command log replayed one query per tick, -1 for invalid lines
+static size_t query_count = 0;      // Number of lines in queries
+static size_t query_next = 0;       // Index of the next query to replay
+
+
+/**
+ * @brief Answers a prompt from the script, cycling through it
+ *
+ * @param[in] a Pointer to the activity the question is about
+ *
+ * @return Returns "yes" or "no"
+ */
+static const char* next_answer(const activity* a) {
+    (void)a;
+    return answers[answer_count++ % strlen(answers)] == 'y' ? "yes" : "no";
+}
+
+
+/**
+ * @brief Reads CLOCK_MONOTONIC
+ *
+ * @return Returns the monotonic time in nanoseconds
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Returns the local midnight starting a simulated day
+ *
+ * @param[in] day Number of the day, 0 for the first one
+ *
+ * @return Returns the time of midnight
+ */
+static time_t day_start(int day) {
+    struct tm t = { 0 };
+
+    t.tm_year = SIM_START_YEAR - 1900;
+    t.tm_mday = 1 + day;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+
+/**
+ * @brief Reads a command log and decodes all of its queries in one batch
+ *
+ * @param[in] path Path of the command log, one "now" or "HH:MM" per line
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+static int load_queries(const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        return -1;
+    }
+
+    size_t len = 0, capacity = 4096;
+    char* text = malloc(capacity);
+    size_t n;
+    while (text && (n = fread(text + len, 1, capacity - len, in)) > 0) {
+        len += n;
+        if (len == capacity) {
+            char* grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(in);
+    if (!text) {
+        return -1;
+    }
+
+    size_t lines = 1;
+    for (const char* p = text; (p = memchr(p, '\n', (size_t)(text + len - p))) != NULL; p++) {
+        lines++;
+    }
+    queries = malloc(lines * sizeof(int));
+    if (!queries) {
+        free(text);
+        return -1;
+    }
+    query_count = parse_queries(text, len, SIM_QUERY_NOW, queries, lines);
+    free(text);
+    return 0;
+}
+
+
+/**
+ * @brief Advances the virtual clock until the simulated time reaches a target
+ *
+ * @param[in] target_ns Simulated time to reach in nanoseconds
+ */
+static void advance_to(int64_t target_ns) {
+    int64_t left = target_ns - clock_now_ns(&agenda_clock);
+
+    if (left > 0) {
+        clock_advance(&agenda_clock, (left + agenda_clock.speed - 1) / agenda_clock.speed);
+    }
+}
+
+
+/**
+ * @brief Runs the agenda for a number of simulated days
+ *
+ * @param[in,out] ag Pointer to the agenda to run
+ * @param[in] days Number of days to simulate
+ * @param[in] step Longest simulated time between two ticks in seconds, or 0 to only tick on boundaries
+ * @param[in] period Simulated time between two ticks in seconds regardless of the boundaries, or 0
+ * @param[out] r Pointer to the results
+ */
+static void run(agenda* ag, int days, int step, int period, sim_result* r) {
+    for (int d = 0; d < days; d++) {
+        time_t end = day_start(d + 1);
+
+        // Every day starts with nothing done
+        for (size_t i = 0; i < ag->store.count; i++) {
+            ag->store.items[i].done = 0;
+        }
+        advance_to((int64_t)day_start(d) * NSEC_PER_SEC);
+        get_time(&time_info);
+        agenda_seek(ag, 0);
+
+        while (time_info.current_time < end) {
+            int now = tm_minutes(time_info.local_time);
+
+            int64_t t0 = now_ns();
+            r->events += agenda_tick(ag, now);
+            if (query_count) {
+                int minute = queries[query_next++ % query_count];
+                if (minute >= 0) {
+                    answer_query(&ag->store, minute == SIM_QUERY_NOW ? now : minute);
+                }
+            }
+            prompt_poll(&prompts);
+            render_flush();
+            int64_t latency = now_ns() - t0;
+
+            stats_record(&r->latency, latency);
+            r->ticks++;
+
+            // Jump to the next boundary or prompt deadline instead of sleeping
+            int next = agenda_next(ag);
+            time_t target = next < 0 ? end : time_info.current_time - time_info.local_time->tm_sec + (time_t)(next - now) * 60;
+            if (step > 0 && target > time_info.current_time + step) {
+                target = time_info.current_time + step;
+            }
+            // A fixed period stands in for a loop that is stalled, the skipped events get caught up
+            if (period > 0) {
+                target = time_info.current_time + period < end ? time_info.current_time + period : end;
+            }
+            int64_t target_ns = (int64_t)target * NSEC_PER_SEC;
+            int64_t deadline = prompt_deadline(&prompts);
+            if (deadline >= 0 && deadline < target_ns && !period) {
+                target_ns = deadline;
+            }
+            advance_to(target_ns);
+            get_time(&time_info);
+        }
+    }
+}
+
+
+/**
+ * @brief Prints the results of a run
+ *
+ * @param[in] out Stream to print to
+ * @param[in] r Pointer to the results
+ * @param[in] runtime Wall clock time the run took in nanoseconds
+ */
+static void report(FILE* out, const sim_result* r, int64_t runtime) {
+    double seconds = (double)runtime / (double)NSEC_PER_SEC;
+
+    fprintf(out, "runtime:     %.6f s\n", seconds);
+    fprintf(out, "ticks:       %llu (%.0f ticks/s)\n", (unsigned long long)r->ticks, (double)r->ticks / seconds);
+    fprintf(out, "events:      %llu (%.0f events/s)\n", (unsigned long long)r->events, (double)r->events / seconds);
+    fprintf(out, "max tick:    %lld ns\n", (long long)r->latency.max);
+    // Event lag is in real time, a stalled loop shows up here once the skipped events are caught up
+    fprintf(out, "max lag:     start %lld ns, warning %lld ns\n", (long long)stats.histograms[STATS_LAG_START].max,
+        (long long)stats.histograms[STATS_LAG_WARNING].max);
+    fprintf(out, "tick latency histogram:\n");
+    stats_print_histogram(out, &r->latency);
+}
+
+
+/**
+ * @brief Prints how to call the simulator
+ *
+ * @param[in] name Name the program was started with
+ */
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-d days] [-n activities | -f file] [-x speed] [-t step] [-p period] [-a answers] [-q log] [-r seed] [-v] [-h]\n", name);
+    fprintf(stderr, "  -d days        number of days to simulate (default 1)\n");
+    fprintf(stderr, "  -n activities  generate a random agenda of this size instead of the built-in one\n");
+    fprintf(stderr, "  -f file        load the agenda from a binary agenda file instead of the built-in one\n");
+    fprintf(stderr, "  -x speed       speed factor of the simulated clock (default 30)\n");
+    fprintf(stderr, "  -t step        also tick at least every step simulated seconds (default 0, boundaries only)\n");
+    fprintf(stderr, "  -p period      tick every period simulated seconds only, to test the catch-up of missed events\n");
+    fprintf(stderr, "  -a answers     answers to the prompts, e.g. \"yyn\" (default \"n\")\n");
+    fprintf(stderr, "  -q log         replay the queries of a command log, one per tick\n");
+    fprintf(stderr, "  -r seed        seed of the random agenda (default 1)\n");
+    fprintf(stderr, "  -v             print the agenda output instead of discarding it\n");
+    fprintf(stderr, "  -h             print this help\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    int days = 1, count = 0, speed = 30, step = 0, period = 0, verbose = 0, opt;
+    unsigned seed = 1;
+    const char* path = NULL;
+    const char* query_path = NULL;
+    sim_result result = { 0 };
+    agenda ag;
+
+    while ((opt = getopt(argc, argv, "d:n:f:x:t:p:a:q:r:vh")) != -1) {
+        switch (opt) {
+        case 'd': days = atoi(optarg); break;
+        case 'n': count = atoi(optarg); break;
+        case 'f': path = optarg; break;
+        case 'x': speed = atoi(optarg); break;
+        case 't': step = atoi(optarg); break;
+        case 'p': period = atoi(optarg); break;
+        case 'a': answers = optarg; break;
+        case 'q': query_path = optarg; break;
+        case 'r': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'v': verbose = 1; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (days < 1 || count < 0 || speed < 1 || step < 0 || period < 0 || !*answers) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (query_path && load_queries(query_path)) {
+        perror(query_path);
+        return 1;
+    }
+
+    if (path) {
+        agenda_file f;
+        if (agenda_file_open(&f, path) || agenda_file_load(&ag, &f)) {
+            perror(path);
+            agenda_file_close(&f);
+            return 1;
+        }
+        agenda_file_close(&f);
+    }
+    else if (count) {
+        activity* day = malloc((size_t)count * sizeof(activity));
+        if (!day) {
+            perror("agenda");
+            return 1;
+        }
+        srand(seed);
+        generate_day(day, (size_t)count);
+        if (agenda_init(&ag, day, (size_t)count)) {
+            perror("agenda");
+            return 1;
+        }
+        free(day);
+    }
+    else if (agenda_init(&ag, default_day, default_day_count)) {
+        perror("agenda");
+        return 1;
+    }
+
+    // The report goes to the original stdout, the agenda output is discarded unless asked for
+    FILE* out = stdout;
+    if (!verbose) {
+        out = fdopen(dup(STDOUT_FILENO), "w");
+        if (!out || !freopen("/dev/null", "w", stdout)) {
+            perror("stdout");
+            return 1;
+        }
+    }
+
+    // The output is a plain log, even on a terminal, as the frames would go by too fast to be read
+    render_init(false);
+    scripted_answer = next_answer;
+    agenda_attach(&ag);
+    clock_start_virtual(&agenda_clock, day_start(0), speed);
+
+    stats_reset();
+    int64_t t0 = now_ns();
+    run(&ag, days, step, period, &result);
+    int64_t runtime = now_ns() - t0;
+
+    render_flush();
+    fprintf(out, "agenda:      %zu activities, %d day(s), speed %d\n", ag.store.count, days, speed);
+    report(out, &result, runtime);
+    fprintf(out, "late events: %llu (up to %u min)\n", (unsigned long long)ag.late, ag.max_late);
+    if (query_count) {
+        fprintf(out, "queries:     %zu replayed from %zu lines\n", query_next, query_count);
+    }
+    fclose(out);
+    free(queries);
+    prompt_free(&prompts);
+    agenda_free(&ag);
+    return 0;
+}
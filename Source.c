@@ -1,54 +1,569 @@
 ﻿#include "Helper.h"
+#include "Agenda.h"
+#include "EventLoop.h"
+#include "Prompt.h"
+#include "Input.h"
+#include "AgendaFile.h"
+#include "Watch.h"
+#include "Journal.h"
+#include "Render.h"
+#include "Stats.h"
+#include "Recur.h"
+#include "Notify.h"
+#include "History.h"
+
+#include <signal.h>
+
+#ifdef AGENDA_TABLE
+#include "AgendaTable.h"
+#endif
 
-int delay_us = 100000;
 int speed_factor = 1;
+static journal done_log = { .fd = -1 }; // Log of the completions, only open with -j
+static volatile sig_atomic_t stats_requested = 0; // Set by SIGUSR1, the statistics are printed by the main loop
+static recur_set rules = { 0 }; // Recurring activities added to the agenda of every day, only set with -r
+static notifier notes = { .wake_fd = -1 }; // Destinations the reminders are sent to, only set with -N
+static notify_batch note_batch = { 0 }; // Reminders of the current tick, handed to the sender once per tick
+static history history_log = { .fd = -1 }; // Every reminder and answer for the adherence reports, only open with -H
+
+static void handle_signal(int sig);
+static void handle_resize(int sig);
+static void handle_stats(int sig);
+static void show_status(const agenda* ag, int now);
+static int load_agenda(agenda* ag, const char* path);
+static int add_recurring(agenda* ag, int wday);
+static void start_day(agenda* ag, const char* path, const struct tm* t);
+static void reload_agenda(agenda* ag, const char* path);
+static void record_done(void* ctx, activity* a);
+static void replay_done(void* ctx, const journal_record* r);
+static void record_reminder(void* ctx, const activity* a, bool start);
+static void record_answer(void* ctx, const activity* a, bool yes, int64_t latency);
+static void release_all(agenda* ag);
+
+int main(int argc, char* argv[]) {
+    // Stop cleanly on Ctrl+C, without SA_RESTART so a pending prompt is interrupted too
+    struct sigaction sa = { 0 };
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = handle_resize;
+    sigaction(SIGWINCH, &sa, NULL);
+    sa.sa_handler = handle_stats;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    const char* path = NULL;
+    const char* log_path = NULL;
+    const char* rules_path = NULL;
+    const char* history_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:r:N:H:l:")) != -1) {
+        if (opt == 'j') {
+            log_path = optarg;
+        }
+        else if (opt == 'r') {
+            rules_path = optarg;
+        }
+        else if (opt == 'H') {
+            history_path = optarg;
+        }
+        else if (opt == 'l' && atoi(optarg) >= 0) {
+            loop_set_budget(atoi(optarg) / 1000.0);
+        }
+        else if (opt == 'N') {
+            if ((!notes.sink_count && notify_init(&notes)) || notify_add_sink(&notes, optarg)) {
+                perror(optarg);
+                return 2;
+            }
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-j journal] [-r rules] [-N unix:PATH|tcp:HOST:PORT] [-H history] [-l budget-ms] [agenda-file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind > 1) {
+        fprintf(stderr, "Usage: %s [-j journal] [-r rules] [-N unix:PATH|tcp:HOST:PORT] [-H history] [-l budget-ms] [agenda-file]\n", argv[0]);
+        return 2;
+    }
+    if (optind < argc) {
+        path = argv[optind];
+    }
+
+    // Read the recurring activities, they are expanded for the current day once the clock is running
+    size_t bad_line;
+    if (rules_path && recur_load(&rules, rules_path, &bad_line)) {
+        if (bad_line) {
+            fprintf(stderr, "%s:%zu: expected \"DAYS HH:MM HH:MM [every N(m|h)] [until HH:MM] name\"\n", rules_path,
+                bad_line);
+        }
+        else {
+            perror(rules_path);
+        }
+        recur_free(&rules);
+        return 1;
+    }
+
+    // Initialize activities, from the agenda file if one is given
+    agenda ag;
+    if (load_agenda(&ag, path)) {
+        recur_free(&rules);
+        return 1;
+    }
 
-void* increment(void* arg);
-
-int main() {
-    // Initialize activities
-    activity activities[MAX_ACTIVITIES] = {
-    {"Breakfast", {8, 50}, {9, 30}, 0},
-    {"Morning walk", {9, 00},{10, 15}, 0},
-    {"House cleaning", {10, 20},{10, 55}, 0},
-    {"Lunch", {11, 00},{12, 00}, 0},
-    {"Afternoon nap", {13, 45},{15, 00}, 0},
-    {"Grocery shopping", {15, 20}, {15, 45}, 0},
-    {"Cooking", {16, 15}, {17, 30}, 0},
-    {"Dinner", {17, 45},{18, 30}, 0},
-    {"Evening reading", {19, 00},{21, 30}, 0},
-    {"Get medicine", {21, 30},{21, 45}, 0}
-        };
+    // Answering "yes" to a prompt cancels the remaining reminders of the activity and logs the completion
+    on_done = (done_hook){ record_done, &ag };
+
+    // Send the reminders on from their own thread and record them with the answers, the loop only hands over one
+    // batch per tick
+    if (notes.sink_count) {
+        if (notify_start(&notes)) {
+            perror("notify");
+        }
+    }
+    if (history_path && history_open(&history_log, history_path)) {
+        perror(history_path);
+    }
+    if (history_log.fd >= 0) {
+        on_answer = (answer_hook){ record_answer, &ag };
+    }
+    if (notes.sink_count || history_log.fd >= 0) {
+        on_reminder = (reminder_hook){ record_reminder, &ag };
+    }
+
+    // Draw frames on a terminal, keep a plain log when the output goes to a pipe or a file
+    render_init(isatty(STDOUT_FILENO));
+
+    // Frame stdin into lines on its own thread from the start, the speed question already reads from it
+    if (input_start(&stdin_reader, STDIN_FILENO)) {
+        perror("input");
+        release_all(&ag);
+        return 1;
+    }
 
     get_speed_factor(&speed_factor);
-    // Get initial time
+    if (loop_stopped()) {
+        release_all(&ag);
+        return 0;
+    }
+    // Start the simulated clock from the current time and get the initial time
+    clock_start(&agenda_clock, time(NULL), speed_factor);
     get_time(&time_info);
+    uint32_t today = journal_day(time_info.local_time);
+    if (add_recurring(&ag, time_info.local_time->tm_wday)) {
+        perror("rules");
+    }
 
     do_terminal_setting();
 
-    pthread_t tid;
-    pthread_create(&tid, NULL, &increment, &total_time);
-    // Loop until end of day (i.e. 24:00)
-    while (time_info.local_time->tm_hour < 24) {
-        for (int8_t i = 0 ; i < MAX_ACTIVITIES; i++) {
-            if (!activities[i].done) {
-                is_scheduled(&activities[i], i, time_info.local_time);
-                is_due_soon(&activities[i], i, time_info.local_time);
+    // Restore what was already done today before a crash or restart
+    if (log_path && journal_open(&done_log, log_path, today, replay_done, &ag)) {
+        perror(log_path);
+    }
+
+    // Skip every event that is already over
+    agenda_seek(&ag, tm_minutes(time_info.local_time));
+
+    if (loop_init() || loop_watch(input_fd(&stdin_reader), LOOP_INPUT)) {
+        perror("event loop");
+        loop_close();
+        release_all(&ag);
+        tcsetattr(STDIN_FILENO, TCSANOW, &old_terminal_settings);
+        return 1;
+    }
+
+    // Pick up edits of the agenda file while running, the agenda keeps working without them if this fails
+    file_watch watch = { -1, -1, "" };
+    if (path && (watch_open(&watch, path) || loop_watch(watch_fd(&watch), LOOP_RELOAD))) {
+        perror("watch");
+        watch_close(&watch);
+    }
+
+    // Measure the day from here, the setup and the speed question are not part of it
+    stats_reset();
+
+    // Loop until stopped, every midnight starts the agenda of the new day
+    int status = 0;
+    while (!loop_stopped()) {
+        if (journal_day(time_info.local_time) != today) {
+            today = journal_day(time_info.local_time);
+            start_day(&ag, path, time_info.local_time);
+        }
+        int now = tm_minutes(time_info.local_time);
+        int64_t stage = stats_now();
+        int64_t stage_end;
+
+        agenda_tick(&ag, now);
+        stage_end = stats_now();
+        stats_add(STATS_TICK, stage_end - stage);
+        stage = stage_end;
+
+        prompt_poll(&prompts);
+        stage_end = stats_now();
+        stats_add(STATS_PROMPT, stage_end - stage);
+        stage = stage_end;
+
+        // One hand-over for every reminder of the tick, the network is never waited for here
+        if (notes.sink_count) {
+            notify_submit(&notes, &note_batch);
+        }
+
+        // One flush for everything answered since the previous tick
+        if (done_log.path) {
+            if (journal_commit(&done_log)) {
+                perror(log_path);
             }
-        }       
-        get_non_blocking_inputs(activities, &time_info);
-        usleep(delay_us);
+            stage_end = stats_now();
+            stats_add(STATS_JOURNAL, stage_end - stage);
+            stage = stage_end;
+        }
+
+        // The history is written in blocks, most ticks only buffer
+        if (history_log.fd >= 0 && history_commit(&history_log, clock_now_ns(&agenda_clock) / NSEC_PER_MSEC)) {
+            perror(history_path);
+        }
+
+        // One write for everything shown since the previous tick
+        show_status(&ag, now);
+        render_flush();
+        stage_end = stats_now();
+        stats_add(STATS_RENDER, stage_end - stage);
+
+        if (stats_requested) {
+            stats_requested = 0;
+            stats_report(stderr);
+        }
+
+        // Sleep until the next start or warning boundary, or until the user types something
+        int next = agenda_next(&ag);
+        time_t boundary = time_info.current_time - time_info.local_time->tm_sec + (time_t)(next - now) * 60;
+        double wait = next < 0 ? -1.0 : clock_real_until(&agenda_clock, boundary);
+        // Wake up at midnight even when nothing is left today, the new day has to be set up before its first events
+        double midnight_wait = clock_real_until(&agenda_clock, time_info.current_time - time_info.local_time->tm_sec
+            + (time_t)(MINUTES_PER_DAY - now) * 60);
+        wait = midnight_wait >= 0 && (wait < 0 || midnight_wait < wait) ? midnight_wait : wait;
+        // The prompt delays and the clock on the frame may be late by the latency budget and are coalesced
+        double soft = -1.0;
+        int64_t deadline = prompt_deadline(&prompts);
+        if (deadline >= 0) {
+            soft = clock_real_until_ns(&agenda_clock, deadline);
+        }
+        if (render_frames()) {
+            double minute_wait = clock_real_until(&agenda_clock, time_info.current_time - time_info.local_time->tm_sec + 60);
+            soft = minute_wait >= 0 && (soft < 0 || minute_wait < soft) ? minute_wait : soft;
+        }
+        loop_arm_deadlines(wait, soft);
+        stage = stats_now();
+        uint32_t events = loop_wait();
+        if (events & LOOP_ERROR) {
+            perror("event loop");
+            status = 1;
+        }
+        stage_end = stats_now();
+        stats_add(STATS_IDLE, stage_end - stage);
+        if (events & LOOP_SHUTDOWN) {
+            break;
+        }
+        if (events & LOOP_INPUT) {
+            get_non_blocking_inputs(&ag.store, &time_info);
+            stats_add(STATS_INPUT, stats_now() - stage_end);
+        }
+        if ((events & LOOP_RELOAD) && watch_changed(&watch)) {
+            reload_agenda(&ag, path);
+        }
         get_time(&time_info);
     }
+    render_flush();
+    loop_close();
+    watch_close(&watch);
+    if (notes.sink_count) {
+        notify_stop(&notes);
+        notify_report(&notes, stderr);
+    }
+    release_all(&ag);
     tcsetattr(STDIN_FILENO, TCSANOW, &old_terminal_settings);
 
+    return status;
+}
+
+/**
+ * @brief Stops the threads and releases everything set up before the event loop, on every way out of main
+ *
+ * @param[in,out] ag Pointer to the agenda to free
+ */
+static void release_all(agenda* ag) {
+    input_stop(&stdin_reader);
+    journal_close(&done_log);
+    history_close(&history_log);
+    if (notes.sink_count) {
+        notify_free(&notes);
+    }
+    notify_batch_free(&note_batch);
+    prompt_free(&prompts);
+    agenda_free(ag);
+    recur_free(&rules);
+}
+
+
+/**
+ * @brief Builds the activities every day starts with, from the agenda file or the built-in agenda
+ *
+ * A build with make AGENDA=text-file has the agenda compiled in, it is used in place of the built-in one.
+ *
+ * @param[out] ag Pointer to the agenda to initialize
+ * @param[in] path Path of the agenda file, or NULL for the built-in agenda
+ *
+ * @return Returns 0 on success, -1 after reporting the error
+ */
+static int load_agenda(agenda* ag, const char* path) {
+    if (path) {
+        agenda_file f;
+        if (agenda_file_open(&f, path) || agenda_file_load(ag, &f)) {
+            perror(path);
+            agenda_file_close(&f);
+            return -1;
+        }
+        agenda_file_close(&f);
+    }
+#ifdef AGENDA_TABLE
+    else if (agenda_init_table(ag, &compiled_agenda)) {
+#else
+    else if (agenda_init(ag, default_day, default_day_count)) {
+#endif
+        perror("agenda");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds the occurrences of the recurring activities on a day of the week to an agenda
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] wday Day of the week, 0 for Sunday
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int add_recurring(agenda* ag, int wday) {
+    const activity* day;
+    size_t n;
+
+    if (recur_expand(&rules, wday, &day, &n)) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        long added = agenda_add(ag, &day[i]);
+        if (added < 0) {
+            return -1;
+        }
+        // The occurrences are not in the agenda file, a reload must not take them for removed records
+        bitset_set(&ag->fixed, (size_t)added);
+    }
     return 0;
 }
 
-void* increment(void* arg) {
-    double* total_time = (double*)arg;
-    while (1) {
-        usleep(delay_us);  // sleep for 10ms
-        *total_time += speed_factor * ((double)delay_us / 1000000.0);
+/**
+ * @brief Replaces the agenda of the day that ended by the agenda of the new one
+ *
+ * What the previous day still had due is announced first, since a stall or a suspend may have crossed midnight,
+ * and the open questions about it are dropped. The new day starts from midnight, so the next tick catches up on
+ * its events up to now as late ones. If the new agenda cannot be built, the old activities are kept and simply
+ * start again as not done.
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] path Path of the agenda file, or NULL for the built-in agenda
+ * @param[in] t Pointer to the local time of the new day
+ */
+static void start_day(agenda* ag, const char* path, const struct tm* t) {
+    agenda next;
+
+    agenda_tick(ag, MINUTES_PER_DAY - 1);
+    prompt_free(&prompts);
+    render_prompt("%s", "");
+    if (load_agenda(&next, path) == 0) {
+        if (add_recurring(&next, t->tm_wday)) {
+            perror("rules");
+        }
+        agenda_free(ag);
+        *ag = next;
+        on_done = (done_hook){ record_done, ag };
+        on_reminder.ctx = ag;
+        on_answer.ctx = ag;
+    }
+    else {
+        for (size_t i = 0; i < ag->store.count; i++) {
+            ag->store.items[i].done = bitset_test(&ag->removed, i);
+        }
+    }
+    agenda_seek(ag, 0);
+
+    if (done_log.path && journal_new_day(&done_log, journal_day(t))) {
+        perror("journal");
+    }
+    render_message("A new day has started");
+}
+
+/**
+ * @brief Applies the edits of the agenda file to the running agenda
+ *
+ * @param[in,out] ag Pointer to the agenda
+ * @param[in] path Path of the agenda file
+ */
+static void reload_agenda(agenda* ag, const char* path) {
+    const activity* items = ag->store.items;
+    size_t count = ag->store.count;
+    agenda_changes changes;
+    agenda_file f;
+
+    if (agenda_file_open(&f, path) || agenda_file_reload(ag, &f, &changes)) {
+        perror(path);
+        agenda_file_close(&f);
+        return;
+    }
+    agenda_file_close(&f);
+
+    // The store may have grown into a new block while activities were added
+    if (ag->store.items != items) {
+        prompt_relocate(&prompts, items, count, ag->store.items);
+    }
+    if (changes.added || changes.updated || changes.removed) {
+        render_message("Agenda updated: %zu added, %zu changed, %zu removed", changes.added, changes.updated,
+            changes.removed);
+    }
+}
+
+/**
+ * @brief Cancels the reminders of an activity the user marked as done and queues it for the journal
+ *
+ * @param[in,out] ctx Pointer to the agenda
+ * @param[in] a Pointer to the activity
+ */
+static void record_done(void* ctx, activity* a) {
+    agenda* ag = ctx;
+    size_t i = (size_t)(a - ag->store.items);
+
+    agenda_cancel(ag, i);
+    if (done_log.path && journal_append(&done_log, 0, (uint32_t)i, a)) {
+        perror("journal");
+    }
+}
+
+/**
+ * @brief Adds a reminder to the batch of the current tick and to the history
+ *
+ * @param[in] ctx Pointer to the agenda
+ * @param[in] a Pointer to the activity
+ * @param[in] start True for the start of the activity, false for its warning
+ */
+static void record_reminder(void* ctx, const activity* a, bool start) {
+    const agenda* ag = ctx;
+    int minute = start ? atime_minutes(&a->start_time) : atime_minutes(&a->end_time) - WARNING_MINUTES;
+
+    if (notes.sink_count && notify_post(&note_batch, 0, start ? NOTIFY_START : NOTIFY_WARNING, minute, activity_name(a))) {
+        perror("notify");
+    }
+    if (history_log.fd >= 0 && history_add(&history_log, clock_now_ns(&agenda_clock) / NSEC_PER_MSEC, 0,
+        (uint32_t)(a - ag->store.items), start ? HISTORY_START : HISTORY_WARNING, 0)) {
+        perror("history");
+    }
+}
+
+/**
+ * @brief Adds an answer to a question to the history
+ *
+ * @param[in] ctx Pointer to the agenda
+ * @param[in] a Pointer to the activity
+ * @param[in] yes True for "yes", false for "no"
+ * @param[in] latency Simulated nanoseconds since the question was asked
+ */
+static void record_answer(void* ctx, const activity* a, bool yes, int64_t latency) {
+    const agenda* ag = ctx;
+
+    if (history_add(&history_log, clock_now_ns(&agenda_clock) / NSEC_PER_MSEC, 0, (uint32_t)(a - ag->store.items),
+        yes ? HISTORY_YES : HISTORY_NO, (uint32_t)(latency / NSEC_PER_MSEC))) {
+        perror("history");
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Checks if a logged completion is about an activity of the agenda
+ *
+ * @param[in] ag Pointer to the agenda
+ * @param[in] i Index of the activity
+ * @param[in] r Pointer to the logged completion
+ *
+ * @return Returns true if the activity is still in the agenda with the same name and times
+ */
+static bool record_matches(const agenda* ag, size_t i, const journal_record* r) {
+    const activity* a = &ag->store.items[i];
+
+    return !bitset_test(&ag->removed, i) && atime_minutes(&a->start_time) == r->start
+        && atime_minutes(&a->end_time) == r->end && strncmp(activity_name(a), r->name, MAX_LENGTH - 1) == 0;
+}
+
+/**
+ * @brief Marks the activity of a logged completion as done again
+ *
+ * @param[in,out] ctx Pointer to the agenda
+ * @param[in] r Pointer to the logged completion
+ */
+static void replay_done(void* ctx, const journal_record* r) {
+    agenda* ag = ctx;
+
+    // The index is only a hint, the agenda file may have been edited since
+    if (r->item < ag->store.count && record_matches(ag, r->item, r)) {
+        ag->store.items[r->item].done = 1;
+        return;
+    }
+    for (size_t i = 0; i < ag->store.count; i++) {
+        if (!ag->store.items[i].done && record_matches(ag, i, r)) {
+            ag->store.items[i].done = 1;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Fills the status rows of the frame with the time, the activities in progress and the open questions
+ *
+ * @param[in] ag Pointer to the agenda
+ * @param[in] now Current minute of the day
+ */
+static void show_status(const agenda* ag, int now) {
+    char doing[RENDER_MAX_COLS + 1] = "";
+    size_t len = 0;
+
+    if (!render_frames()) {
+        return;
+    }
+
+    // A compiled agenda has no minute table, its few activities are simply checked one by one
+    const minute_slot* slot = ag->store.occupancy ? minute_table_at(ag->store.occupancy, now) : NULL;
+    size_t count = slot ? slot->count : ag->store.count;
+    for (size_t k = 0; k < count && len < sizeof(doing) - 1; k++) {
+        const activity* a = &ag->store.items[slot ? slot->items[k] : k];
+        if (!slot && !store_in_progress(&ag->store, k, now)) {
+            continue;
+        }
+        int n = snprintf(doing + len, sizeof(doing) - len, "%s%s%s", len ? ", " : "", activity_name(a), a->done ? " (done)" : "");
+        len += n > 0 ? (size_t)n : 0;
+    }
+
+    size_t waiting = prompt_pending(&prompts);
+    render_header(0, "%02d:%02d   %zu question%s waiting", now / 60, now % 60, waiting, waiting == 1 ? "" : "s");
+    render_header(1, "Now: %s", len ? doing : "nothing planned");
+}
+
+static void handle_resize(int sig) {
+    (void)sig;
+    render_resized();
+}
+
+static void handle_stats(int sig) {
+    (void)sig;
+    stats_requested = 1;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    loop_request_shutdown();
+}
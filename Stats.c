@@ -0,0 +1,102 @@
+/**
+ * @file Stats.c
+ * @brief This file contains the instrumentation of the hot paths.
+ *
+ * The main loop takes a monotonic timestamp around each of its stages and every announcement records how late it
+ * came. The samples go into power-of-two histograms, which cost a few instructions each, and a handful of
+ * counters tell how many system calls a tick costs. The report is printed on request.
+ */
+
+#include "Stats.h"
+
+#include <string.h>
+
+agenda_stats stats = { .started = 0 }; // Instrumentation of the process
+
+// Names of the histograms in the report, in the order of stats_kind
+static const char* const histogram_names[STATS_HISTOGRAMS] = {
+    "tick", "prompt", "input", "parse", "journal", "render", "idle", "lag_start", "lag_warning", "lag_soft"
+};
+
+// Names of the counters in the report, in the order of stats_counter
+static const char* const counter_names[STATS_COUNTERS] = {
+    "read", "write", "localtime", "wakeup", "fsync", "wakeup_tight", "wakeup_coarse"
+};
+
+
+/**
+ * @brief Finds the upper bound of the bucket holding a percentile
+ *
+ * @param[in] h Pointer to the histogram
+ * @param[in] percent Percentile to find
+ *
+ * @return Returns the upper bound in nanoseconds, or 0 if the histogram is empty
+ */
+static uint64_t percentile(const stats_histogram* h, double percent) {
+    uint64_t wanted = (uint64_t)((double)h->count * percent / 100.0 + 0.5);
+    uint64_t seen = 0;
+
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen && seen >= wanted) {
+            return 1ULL << (b + 1);
+        }
+    }
+    return 0;
+}
+
+
+void stats_record(stats_histogram* h, int64_t ns) {
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    int bucket = v ? 63 - __builtin_clzll(v) : 0;
+
+    h->buckets[bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1]++;
+    h->count++;
+    h->total += v;
+    if (ns > h->max) {
+        h->max = ns;
+    }
+}
+
+
+void stats_reset(void) {
+    memset(stats.histograms, 0, sizeof(stats.histograms));
+    for (int c = 0; c < STATS_COUNTERS; c++) {
+        atomic_store_explicit(&stats.counters[c], 0, memory_order_relaxed);
+    }
+    stats.started = stats_now();
+}
+
+
+void stats_print_histogram(FILE* out, const stats_histogram* h) {
+    uint64_t seen = 0;
+
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        if (!h->buckets[b]) {
+            continue;
+        }
+        seen += h->buckets[b];
+        fprintf(out, "  < %12llu ns  %10llu  %6.2f%%\n", 1ULL << (b + 1), (unsigned long long)h->buckets[b],
+            100.0 * (double)seen / (double)h->count);
+    }
+}
+
+
+void stats_report(FILE* out) {
+    double uptime = (double)(stats_now() - stats.started) / 1e9;
+
+    fprintf(out, "stats: uptime=%.3f", uptime);
+    for (int c = 0; c < STATS_COUNTERS; c++) {
+        fprintf(out, " %s=%llu", counter_names[c],
+            (unsigned long long)atomic_load_explicit(&stats.counters[c], memory_order_relaxed));
+    }
+    fprintf(out, "\n");
+
+    for (int k = 0; k < STATS_HISTOGRAMS; k++) {
+        const stats_histogram* h = &stats.histograms[k];
+        fprintf(out, "stats: %s count=%llu mean_ns=%llu p50_ns=%llu p99_ns=%llu max_ns=%lld\n", histogram_names[k],
+            (unsigned long long)h->count, (unsigned long long)(h->count ? h->total / h->count : 0),
+            (unsigned long long)percentile(h, 50.0), (unsigned long long)percentile(h, 99.0), (long long)h->max);
+    }
+    fflush(out);
+}
@@ -0,0 +1,120 @@
+#ifndef HEADER_STATS_H
+#define HEADER_STATS_H
+
+// Include any necessary headers here
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Declare any constants here
+#define STATS_BUCKETS 40 ///< Number of power-of-two buckets of a histogram, bucket b counts [2^b, 2^(b+1)) ns
+
+// Define the stages and event lags the histograms are kept for
+typedef enum {
+    STATS_TICK, ///< agenda_tick(), announcing the due events
+    STATS_PROMPT, ///< prompt_poll(), moving the questions forward
+    STATS_INPUT, ///< Handling the lines typed since the previous tick
+    STATS_PARSE, ///< answer_query(), answering one decoded query
+    STATS_JOURNAL, ///< Group commit of the completion log
+    STATS_RENDER, ///< Building and writing the output of the tick
+    STATS_IDLE, ///< Sleeping in the event loop
+    STATS_LAG_START, ///< How late "Time for X" was announced after the start of its minute
+    STATS_LAG_WARNING, ///< How late a warning was announced after the start of its minute
+    STATS_LAG_SOFT, ///< How late the loop woke up for a deadline that may be late by the latency budget
+    STATS_HISTOGRAMS ///< Number of histograms
+} stats_kind;
+
+// Define the system calls and library calls that are counted
+typedef enum {
+    STATS_READ, ///< read() calls on stdin, the eventfds, the timerfd and the file watch
+    STATS_WRITE, ///< write() calls of the renderer and the completion log
+    STATS_LOCALTIME, ///< localtime_r() calls of the time cache
+    STATS_WAKEUP, ///< Returns from the event loop
+    STATS_FSYNC, ///< fdatasync() calls of the completion log
+    STATS_WAKEUP_TIGHT, ///< Timer expirations armed exactly for a start or a warning
+    STATS_WAKEUP_COARSE, ///< Timer expirations armed for a deadline that may be late by the latency budget
+    STATS_COUNTERS ///< Number of counters
+} stats_counter;
+
+// Define struct for a latency histogram
+typedef struct {
+    uint64_t count; ///< Number of samples
+    uint64_t total; ///< Sum of the samples in nanoseconds
+    int64_t max; ///< Largest sample in nanoseconds
+    uint64_t buckets[STATS_BUCKETS]; ///< Samples per power-of-two bucket
+} stats_histogram;
+
+// Define struct for the instrumentation of the process
+typedef struct {
+    stats_histogram histograms[STATS_HISTOGRAMS]; ///< Histograms, only updated by the main thread
+    _Atomic uint64_t counters[STATS_COUNTERS]; ///< Counters, also updated by the stdin reader thread
+    int64_t started; ///< Monotonic time the statistics were reset at
+} agenda_stats;
+
+// Declare any global variables here
+extern agenda_stats stats; ///< Instrumentation of the process
+
+/**
+ * @brief Reads CLOCK_MONOTONIC, which goes through the vDSO and costs no system call
+ *
+ * @return Returns the monotonic time in nanoseconds
+ */
+static inline int64_t stats_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Counts one call
+ *
+ * @param[in] c Counter to increment
+ */
+static inline void stats_count(stats_counter c) {
+    atomic_fetch_add_explicit(&stats.counters[c], 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Adds a sample to a histogram
+ *
+ * @param[in,out] h Pointer to the histogram
+ * @param[in] ns Sample in nanoseconds, negative samples count as 0
+ */
+void stats_record(stats_histogram* h, int64_t ns); ///< Function for adding a sample to a histogram
+
+/**
+ * @brief Adds a sample to one of the histograms of the process
+ *
+ * @param[in] kind Histogram to add to
+ * @param[in] ns Sample in nanoseconds
+ */
+static inline void stats_add(stats_kind kind, int64_t ns) {
+    stats_record(&stats.histograms[kind], ns);
+}
+
+/**
+ * @brief Clears every histogram and counter
+ */
+void stats_reset(void); ///< Function for resetting the statistics
+
+/**
+ * @brief Prints the buckets of a histogram that hold samples, with the cumulative share of each
+ *
+ * @param[in] out Stream to print to
+ * @param[in] h Pointer to the histogram
+ */
+void stats_print_histogram(FILE* out, const stats_histogram* h); ///< Function for printing a histogram
+
+/**
+ * @brief Prints every histogram and counter as one line each
+ *
+ * The lines start with "stats:" and are made of name=value pairs, so they can be collected from many devices and
+ * parsed. p50 and p99 are the upper bounds of the buckets holding the percentile.
+ *
+ * @param[in] out Stream to print to
+ */
+void stats_report(FILE* out); ///< Function for printing the statistics
+
+#endif /* HEADER_STATS_H */
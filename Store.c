@@ -0,0 +1,293 @@
+/**
+ * @file Store.c
+ * @brief This file contains the growable activity store.
+ *
+ * All activities of an agenda and the bitsets used to remember which of them were already checked during the
+ * current minute live in a single arena allocation, so loading a whole day does not allocate per activity.
+ */
+
+#include "Store.h"
+
+
+/**
+ * @brief Computes the size of an arena for the given capacity
+ *
+ * @param[in] capacity Number of activities the arena has room for
+ *
+ * @return Returns the size of the arena in bytes
+ */
+static size_t arena_size(size_t capacity) {
+    size_t items = capacity * sizeof(activity);
+    // Keep the bitset words aligned after the activities
+    items = (items + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    return items + 2 * bitset_words(capacity) * sizeof(uint64_t);
+}
+
+
+int store_init(activity_store* s, size_t capacity) {
+    activity_names_init();
+    memset(s, 0, sizeof(*s));
+    s->started_minute = -1;
+    s->warned_minute = -1;
+    return store_reserve(s, capacity);
+}
+
+
+int store_index_minutes(activity_store* s) {
+    if (s->occupancy) {
+        return 0;
+    }
+    s->occupancy = malloc(sizeof(minute_table));
+    if (!s->occupancy) {
+        return -1;
+    }
+    minute_table_init(s->occupancy);
+
+    for (size_t i = 0; i < s->count; i++) {
+        activity* a = &s->items[i];
+        if (minute_table_add(s->occupancy, (uint32_t)i, atime_minutes(&a->start_time), atime_minutes(&a->end_time))) {
+            minute_table_free(s->occupancy);
+            free(s->occupancy);
+            s->occupancy = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+bool store_in_progress(const activity_store* s, size_t i, int minute) {
+    const activity* a = &s->items[i];
+
+    if (s->occupancy) {
+        return minute_table_contains(s->occupancy, (uint32_t)i, minute);
+    }
+    return atime_minutes(&a->start_time) <= minute && minute < atime_minutes(&a->end_time);
+}
+
+
+void store_free(activity_store* s) {
+    if (s->occupancy) {
+        minute_table_free(s->occupancy);
+        free(s->occupancy);
+    }
+    free(s->arena);
+    memset(s, 0, sizeof(*s));
+}
+
+
+int store_reserve(activity_store* s, size_t capacity) {
+    size_t old_words = bitset_words(s->capacity);
+    size_t new_capacity = s->capacity ? s->capacity : STORE_MIN_CAPACITY;
+    char* arena;
+
+    if (s->arena && capacity <= s->capacity) {
+        return 0;
+    }
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    arena = realloc(s->arena, arena_size(new_capacity));
+    if (!arena) {
+        return -1;
+    }
+
+    // Lay out both bitsets after the grown activity array, moving the upper one first as the regions may overlap
+    size_t new_words = bitset_words(new_capacity);
+    uint64_t* started = (uint64_t*)(arena + arena_size(new_capacity)) - 2 * new_words;
+    uint64_t* warned = started + new_words;
+    if (s->arena) {
+        uint64_t* old_started = (uint64_t*)(arena + arena_size(s->capacity)) - 2 * old_words;
+        memmove(warned, old_started + old_words, old_words * sizeof(uint64_t));
+        memmove(started, old_started, old_words * sizeof(uint64_t));
+    }
+    memset(started + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
+    memset(warned + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
+
+    s->arena = arena;
+    s->items = (activity*)arena;
+    s->capacity = new_capacity;
+    s->started = (bitset){ started, new_capacity };
+    s->warned = (bitset){ warned, new_capacity };
+    return 0;
+}
+
+
+long store_add(activity_store* s, uint32_t name, atime start, atime end) {
+    activity* a;
+
+    if (name >= activity_names.count) {
+        return -1;
+    }
+    if (s->count == s->capacity && store_reserve(s, s->count + 1)) {
+        return -1;
+    }
+
+    a = &s->items[s->count];
+    memset(a, 0, sizeof(*a));
+    a->name = name;
+    a->start_time = start;
+    a->end_time = end;
+    if (s->occupancy && minute_table_add(s->occupancy, (uint32_t)s->count, atime_minutes(&start), atime_minutes(&end))) {
+        return -1;
+    }
+    return (long)s->count++;
+}
+
+
+/**
+ * @brief Answers a batch of queries from the minute table of an indexed store
+ *
+ * @param[in] s Pointer to the indexed store
+ * @param[in] minutes Minutes of the day to look up
+ * @param[in] n Number of queries
+ * @param[out] items Buffer receiving the indices of the activities
+ * @param[in] capacity Number of indices items has room for
+ * @param[out] offsets Start of the answer of every query, n + 1 entries
+ */
+static void batch_from_table(const activity_store* s, const int* minutes, size_t n, uint32_t* items, size_t capacity,
+    size_t* offsets) {
+    size_t total = 0;
+
+    for (size_t k = 0; k < n; k++) {
+        offsets[k] = total;
+        if (minutes[k] < 0 || minutes[k] >= MINUTES_PER_DAY) {
+            continue;
+        }
+
+        const minute_slot* slot = minute_table_at(s->occupancy, minutes[k]);
+        if (total < capacity) {
+            size_t room = capacity - total;
+            memcpy(items + total, slot->items, (slot->count < room ? slot->count : room) * sizeof(uint32_t));
+        }
+        total += slot->count;
+    }
+    offsets[n] = total;
+}
+
+
+/**
+ * @brief Answers a batch of queries by sweeping the activities through the day once
+ *
+ * The activities are bucketed by their start and end minute and the queries by their minute, with counting sorts.
+ * Walking the minutes in order then keeps the set of activities in progress, and each query copies the set.
+ *
+ * @param[in] s Pointer to the store
+ * @param[in] minutes Minutes of the day to look up
+ * @param[in] n Number of queries
+ * @param[out] items Buffer receiving the indices of the activities
+ * @param[in] capacity Number of indices items has room for
+ * @param[out] offsets Start of the answer of every query, n + 1 entries
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+static int batch_sweep(const activity_store* s, const int* minutes, size_t n, uint32_t* items, size_t capacity,
+    size_t* offsets) {
+    const size_t buckets = MINUTES_PER_DAY + 1;
+    size_t count = s->count;
+
+    // One block for the bucket starts, the activities sorted by start and by end, the active set and the queries
+    uint32_t* block = calloc(3 * buckets + 4 * count + n, sizeof(uint32_t));
+    if (!block) {
+        return -1;
+    }
+    uint32_t* start_first = block;
+    uint32_t* end_first = start_first + buckets;
+    uint32_t* query_first = end_first + buckets;
+    uint32_t* by_start = query_first + buckets;
+    uint32_t* by_end = by_start + count;
+    uint32_t* active = by_end + count;
+    uint32_t* position = active + count;
+    uint32_t* by_minute = position + count;
+
+    // Count the activities starting and ending at every minute, empty intervals are never in progress
+    for (size_t i = 0; i < count; i++) {
+        int start = atime_minutes(&s->items[i].start_time);
+        int end = atime_minutes(&s->items[i].end_time);
+        if (start >= 0 && start < end && start < MINUTES_PER_DAY) {
+            start_first[start]++;
+            end_first[end < MINUTES_PER_DAY ? end : MINUTES_PER_DAY]++;
+        }
+    }
+
+    // The number of activities in progress at each minute gives the offsets before anything is copied
+    size_t total = 0;
+    int64_t live = 0;
+    int64_t live_at[MINUTES_PER_DAY];
+    for (int m = 0; m < MINUTES_PER_DAY; m++) {
+        live += (int64_t)start_first[m] - (int64_t)end_first[m];
+        live_at[m] = live;
+    }
+    for (size_t k = 0; k < n; k++) {
+        offsets[k] = total;
+        if (minutes[k] >= 0 && minutes[k] < MINUTES_PER_DAY) {
+            total += (size_t)live_at[minutes[k]];
+            query_first[minutes[k]]++;
+        }
+    }
+    offsets[n] = total;
+
+    // Turn the counts into bucket starts and fill the buckets
+    uint32_t starts = 0, ends = 0, queries = 0;
+    for (size_t m = 0; m < buckets; m++) {
+        uint32_t c = start_first[m];
+        start_first[m] = starts;
+        starts += c;
+        c = end_first[m];
+        end_first[m] = ends;
+        ends += c;
+        c = query_first[m];
+        query_first[m] = queries;
+        queries += c;
+    }
+    for (size_t i = 0; i < count; i++) {
+        int start = atime_minutes(&s->items[i].start_time);
+        int end = atime_minutes(&s->items[i].end_time);
+        if (start >= 0 && start < end && start < MINUTES_PER_DAY) {
+            by_start[start_first[start]++] = (uint32_t)i;
+            by_end[end_first[end < MINUTES_PER_DAY ? end : MINUTES_PER_DAY]++] = (uint32_t)i;
+        }
+    }
+    for (size_t k = 0; k < n; k++) {
+        if (minutes[k] >= 0 && minutes[k] < MINUTES_PER_DAY) {
+            by_minute[query_first[minutes[k]]++] = (uint32_t)k;
+        }
+    }
+
+    // Filling moved every bucket start to the end of its bucket, so minute m takes the entries up to first[m]
+    uint32_t active_count = 0, next_start = 0, next_end = 0, next_query = 0;
+    for (int m = 0; m < MINUTES_PER_DAY && next_query < queries; m++) {
+        // An activity is in progress from its start up to, but not including, its end
+        for (; next_end < end_first[m]; next_end++) {
+            uint32_t i = by_end[next_end];
+            uint32_t last = active[--active_count];
+            active[position[i]] = last;
+            position[last] = position[i];
+        }
+        for (; next_start < start_first[m]; next_start++) {
+            uint32_t i = by_start[next_start];
+            position[i] = active_count;
+            active[active_count++] = i;
+        }
+        for (; next_query < query_first[m]; next_query++) {
+            size_t at = offsets[by_minute[next_query]];
+            if (at < capacity) {
+                size_t room = capacity - at;
+                memcpy(items + at, active, (active_count < room ? active_count : room) * sizeof(uint32_t));
+            }
+        }
+    }
+    free(block);
+    return 0;
+}
+
+
+int store_query_batch(const activity_store* s, const int* minutes, size_t n, uint32_t* items, size_t capacity,
+    size_t* offsets) {
+    if (s->occupancy) {
+        batch_from_table(s, minutes, n, items, capacity, offsets);
+        return 0;
+    }
+    return batch_sweep(s, minutes, n, items, capacity, offsets);
+}
@@ -0,0 +1,122 @@
+#ifndef HEADER_STORE_H
+#define HEADER_STORE_H
+
+// Include any necessary headers here
+#include "Helper.h"
+#include "Bitset.h"
+#include "MinuteTable.h"
+
+// Declare any constants here
+#define STORE_MIN_CAPACITY 16 ///< Smallest number of activities the store reserves room for
+
+// Define struct for the growable activity store
+struct activity_store {
+    activity* items; ///< Activities of the agenda, stored at the start of the arena
+    size_t count; ///< Number of activities in the store
+    size_t capacity; ///< Number of activities the arena has room for
+    bitset started; ///< Activities whose start was already checked during started_minute
+    bitset warned; ///< Activities whose warning was already checked during warned_minute
+    int started_minute; ///< Minute the started bits belong to
+    int warned_minute; ///< Minute the warned bits belong to
+    void* arena; ///< Single allocation holding the activities followed by both bitsets
+    minute_table* occupancy; ///< Optional minute table kept up to date by store_add(), NULL if not indexed
+};
+
+/**
+ * @brief Initializes an empty activity store
+ *
+ * This function reserves one arena that holds room for at least the given number of activities together with
+ * the per-minute "already checked" bitsets.
+ *
+ * @param[out] s Pointer to the store to initialize
+ * @param[in] capacity Number of activities to reserve room for
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int store_init(activity_store* s, size_t capacity); ///< Function for creating an activity store
+
+/**
+ * @brief Indexes the activities of the store by the minutes they are in progress
+ *
+ * This function builds the minute table of the store from the activities already added. From then on every
+ * activity added with store_add() is inserted into the table as well.
+ *
+ * @param[in,out] s Pointer to the store
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int store_index_minutes(activity_store* s); ///< Function for building the minute table of a store
+
+/**
+ * @brief Checks if an activity is in progress during a minute
+ *
+ * The minute table is used when the store is indexed, otherwise the activity interval is compared directly.
+ *
+ * @param[in] s Pointer to the store
+ * @param[in] i Index of the activity
+ * @param[in] minute Minute of the day
+ *
+ * @return Returns true if the activity is in progress, false otherwise
+ */
+bool store_in_progress(const activity_store* s, size_t i, int minute); ///< Function for checking if an activity is in progress
+
+/**
+ * @brief Releases the arena and the minute table of an activity store
+ *
+ * @param[in,out] s Pointer to the store to free
+ */
+void store_free(activity_store* s); ///< Function for freeing an activity store
+
+/**
+ * @brief Makes sure the store has room for the given number of activities
+ *
+ * The arena grows geometrically, so adding activities one by one only reallocates a logarithmic number of times.
+ * The contents of the bitsets are kept.
+ *
+ * @param[in,out] s Pointer to the store
+ * @param[in] capacity Number of activities the store must be able to hold
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int store_reserve(activity_store* s, size_t capacity); ///< Function for growing an activity store
+
+/**
+ * @brief Appends an activity to the store
+ *
+ * The name is only referred to by its id, it is not copied. If the store is indexed, the activity is also added to
+ * its minute table.
+ *
+ * @param[in,out] s Pointer to the store
+ * @param[in] name Id of the name of the activity, returned by name_intern()
+ * @param[in] start Start time of the activity
+ * @param[in] end End time of the activity
+ *
+ * @return Returns the index of the new activity, or -1 if the name is unknown or memory could not be allocated
+ */
+long store_add(activity_store* s, uint32_t name, atime start, atime end); ///< Function for adding an activity
+
+/**
+ * @brief Finds the activities in progress at many minutes of the day in one call, without any output
+ *
+ * The indices answering query k are written to items[offsets[k]] up to items[offsets[k + 1] - 1], in no particular
+ * order. offsets[n] is the number of indices the whole batch needs; if it is larger than capacity, only the first
+ * capacity indices are written and the call can be repeated with a larger buffer. Minutes outside the day have no
+ * activities.
+ *
+ * An indexed store answers every query from its minute table. Otherwise the activities and the queries are
+ * bucketed by minute and swept once through the day, so the batch costs O(N + Q) plus the size of the answer
+ * instead of O(N * Q).
+ *
+ * @param[in] s Pointer to the store
+ * @param[in] minutes Minutes of the day to look up, in any order
+ * @param[in] n Number of queries
+ * @param[out] items Buffer receiving the indices of the activities
+ * @param[in] capacity Number of indices items has room for
+ * @param[out] offsets Start of the answer of every query, n + 1 entries
+ *
+ * @return Returns 0 on success, -1 if memory could not be allocated
+ */
+int store_query_batch(const activity_store* s, const int* minutes, size_t n, uint32_t* items, size_t capacity,
+    size_t* offsets); ///< Function for answering many queries at once
+
+#endif /* HEADER_STORE_H */
@@ -0,0 +1,61 @@
+/**
+ * @file Util.c
+ * @brief This file contains the file helpers shared by the completion log, the history and the agenda files.
+ */
+
+#include "Util.h"
+#include "Stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+int util_write_all(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        stats_count(STATS_WRITE);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+
+int util_append(int fd, const void* buf, size_t len, off_t size, bool sync) {
+    if (util_write_all(fd, buf, len) == 0 && (!sync || fdatasync(fd) == 0)) {
+        return 0;
+    }
+
+    int saved = errno;
+    int cut = ftruncate(fd, size);
+    (void)cut;
+    errno = saved;
+    return -1;
+}
+
+
+void util_sync_dir(const char* path) {
+    char* copy = strdup(path);
+    if (!copy) {
+        return;
+    }
+
+    int fd = open(dirname(copy), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(copy);
+}
@@ -0,0 +1,65 @@
+#ifndef HEADER_UTIL_H
+#define HEADER_UTIL_H
+
+// Include any necessary headers here
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Declare any constants here
+#define UTIL_FNV_START 2166136261u ///< Hash to start a 32 bit FNV-1a hash with
+
+/**
+ * @brief Continues a 32 bit FNV-1a hash over some bytes
+ *
+ * @param[in] hash Hash of the bytes before, UTIL_FNV_START to start
+ * @param[in] data Bytes to hash
+ * @param[in] len Number of bytes
+ *
+ * @return Returns the hash including the bytes
+ */
+static inline uint32_t util_fnv(uint32_t hash, const void* data, size_t len) {
+    const unsigned char* p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes a whole buffer, continuing after partial writes
+ *
+ * @param[in] fd Descriptor to write to
+ * @param[in] buf Bytes to write
+ * @param[in] len Number of bytes
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int util_write_all(int fd, const void* buf, size_t len); ///< Function for writing a whole buffer
+
+/**
+ * @brief Appends a whole buffer to a log file, or leaves the file as it was
+ *
+ * If the write or the flush fails, the file is cut back to its old size so a retry does not append behind a torn
+ * tail.
+ *
+ * @param[in] fd Descriptor of the log, opened for appending
+ * @param[in] buf Bytes to append
+ * @param[in] len Number of bytes
+ * @param[in] size Size of the file before the append
+ * @param[in] sync Whether to flush the data with fdatasync() before returning
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int util_append(int fd, const void* buf, size_t len, off_t size, bool sync); ///< Function for appending to a log
+
+/**
+ * @brief Flushes the directory holding a file, so a rename or a new file survives a crash
+ *
+ * @param[in] path Path of the file
+ */
+void util_sync_dir(const char* path); ///< Function for flushing the directory of a file
+
+#endif /* HEADER_UTIL_H */
@@ -0,0 +1,84 @@
+/**
+ * @file Watch.c
+ * @brief This file contains the inotify watch that tells the main loop when its agenda file was edited.
+ */
+
+#include "Watch.h"
+#include "Stats.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO) // Events that leave a new version of the file behind
+
+
+int watch_open(file_watch* w, const char* path) {
+    char dir[WATCH_NAME_MAX * 4];
+    char base[WATCH_NAME_MAX * 4];
+
+    w->fd = -1;
+    w->wd = -1;
+    if (strlen(path) >= sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    // dirname() and basename() may modify their argument
+    strcpy(dir, path);
+    strcpy(base, path);
+    const char* name = basename(base);
+    if (strlen(name) >= sizeof(w->name)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(w->name, name);
+
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        return -1;
+    }
+    w->wd = inotify_add_watch(w->fd, dirname(dir), WATCH_EVENTS);
+    if (w->wd < 0) {
+        int saved = errno;
+        watch_close(w);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+
+void watch_close(file_watch* w) {
+    if (w->fd >= 0) {
+        close(w->fd);
+    }
+    w->fd = -1;
+    w->wd = -1;
+}
+
+
+int watch_fd(const file_watch* w) {
+    return w->fd;
+}
+
+
+bool watch_changed(file_watch* w) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t n;
+
+    // Several saves in a row are read in one go and count as one change
+    while (stats_count(STATS_READ), (n = read(w->fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n;) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            // An overflowed queue may have lost the save, a reload that finds nothing new is cheap
+            if ((ev->mask & IN_Q_OVERFLOW) || (ev->wd == w->wd && ev->len && strcmp(ev->name, w->name) == 0)) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
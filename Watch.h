@@ -0,0 +1,57 @@
+#ifndef HEADER_WATCH_H
+#define HEADER_WATCH_H
+
+// Include any necessary headers here
+#include <stdbool.h>
+
+// Declare any constants here
+#define WATCH_NAME_MAX 256 ///< Longest file name that can be watched, including the null terminator
+
+// Define struct for a watch on one file
+typedef struct {
+    int fd; ///< Inotify instance, or -1
+    int wd; ///< Watch on the directory holding the file
+    char name[WATCH_NAME_MAX]; ///< Name of the file inside the directory
+} file_watch;
+
+/**
+ * @brief Starts watching a file for changes
+ *
+ * The directory holding the file is watched rather than the file itself, so a file replaced by a rename, like
+ * agenda_file_write() does, is still noticed.
+ *
+ * @param[out] w Pointer to the watch to start
+ * @param[in] path Path of the file
+ *
+ * @return Returns 0 on success, -1 with errno set otherwise
+ */
+int watch_open(file_watch* w, const char* path); ///< Function for watching a file
+
+/**
+ * @brief Stops watching a file
+ *
+ * @param[in,out] w Pointer to the watch
+ */
+void watch_close(file_watch* w); ///< Function for closing a file watch
+
+/**
+ * @brief Returns the descriptor that becomes readable when the directory of the file changes
+ *
+ * @param[in] w Pointer to the watch
+ *
+ * @return Returns the inotify descriptor
+ */
+int watch_fd(const file_watch* w); ///< Function for getting the descriptor to watch
+
+/**
+ * @brief Takes the pending notifications and checks if the file was written or replaced
+ *
+ * @param[in,out] w Pointer to the watch
+ *
+ * An overflow of the notification queue counts as a change too, since the notification of a save may be lost in it.
+ *
+ * @return Returns true if the file has a new version to read
+ */
+bool watch_changed(file_watch* w); ///< Function for checking a file watch
+
+#endif /* HEADER_WATCH_H */
@@ -0,0 +1,278 @@
+/**
+ * @file Wheel.c
+ * @brief This file contains the hierarchical timer wheel driving the start and warning events.
+ *
+ * Level l of the wheel has 64 slots of 64^l ticks each. A timer is filed at the lowest level whose span covers
+ * the time left until it expires, and moved down a level whenever the ticks reach the start of its slot. Adding
+ * and cancelling a timer are O(1), and a tick only touches the timers that expire or move during it.
+ */
+
+#include "Wheel.h"
+
+#include <stdlib.h>
+
+
+/**
+ * @brief Returns the tick a timer is filed under, timers already overdue are filed under the current tick
+ *
+ * @param[in] w Pointer to the wheel
+ * @param[in] t Pointer to the timer
+ *
+ * @return Returns the tick
+ */
+static uint32_t filed_tick(const timer_wheel* w, const wheel_timer* t) {
+    return t->expiry < w->now ? w->now : t->expiry;
+}
+
+
+/**
+ * @brief Appends a timer to the slot matching its expiry
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] id Id of the timer
+ */
+static void link_timer(timer_wheel* w, uint32_t id) {
+    wheel_timer* t = &w->timers[id];
+    uint32_t tick = filed_tick(w, t);
+    uint32_t delta = tick - w->now;
+    int level = 0;
+
+    while (level < WHEEL_LEVELS - 1 && delta >= 1u << (WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    uint32_t index = (tick >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1);
+
+    t->slot = (uint32_t)level * WHEEL_SIZE + index;
+    t->prev = w->tails[level][index];
+    t->next = WHEEL_INVALID;
+    if (t->prev == WHEEL_INVALID) {
+        w->heads[level][index] = id;
+        w->occupied[level] |= 1ULL << index;
+    }
+    else {
+        w->timers[t->prev].next = id;
+    }
+    w->tails[level][index] = id;
+}
+
+
+/**
+ * @brief Removes a timer from its slot
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] id Id of the timer
+ */
+static void unlink_timer(timer_wheel* w, uint32_t id) {
+    wheel_timer* t = &w->timers[id];
+    uint32_t level = t->slot / WHEEL_SIZE;
+    uint32_t index = t->slot % WHEEL_SIZE;
+
+    if (t->prev == WHEEL_INVALID) {
+        w->heads[level][index] = t->next;
+    }
+    else {
+        w->timers[t->prev].next = t->next;
+    }
+    if (t->next == WHEEL_INVALID) {
+        w->tails[level][index] = t->prev;
+    }
+    else {
+        w->timers[t->next].prev = t->prev;
+    }
+    if (w->heads[level][index] == WHEEL_INVALID) {
+        w->occupied[level] &= ~(1ULL << index);
+    }
+}
+
+
+/**
+ * @brief Returns a timer to the free list
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] id Id of the timer
+ */
+static void release_timer(timer_wheel* w, uint32_t id) {
+    w->timers[id].slot = WHEEL_INVALID;
+    w->timers[id].next = w->free_list;
+    w->free_list = id;
+    w->count--;
+}
+
+
+/**
+ * @brief Moves the timers of a slot down to the levels matching the time they have left
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] level Level of the slot
+ * @param[in] index Index of the slot
+ */
+static void cascade(timer_wheel* w, int level, uint32_t index) {
+    uint32_t id = w->heads[level][index];
+
+    w->heads[level][index] = WHEEL_INVALID;
+    w->tails[level][index] = WHEEL_INVALID;
+    w->occupied[level] &= ~(1ULL << index);
+    while (id != WHEEL_INVALID) {
+        uint32_t next = w->timers[id].next;
+        link_timer(w, id);
+        id = next;
+    }
+}
+
+
+/**
+ * @brief Returns how many slots after the given one the next occupied slot of a level is
+ *
+ * @param[in] occupied Occupancy bits of the level
+ * @param[in] index Slot to start from
+ *
+ * @return Returns the distance, 0 if the slot itself is occupied, or -1 if the level is empty
+ */
+static int next_occupied(uint64_t occupied, uint32_t index) {
+    if (!occupied) {
+        return -1;
+    }
+    uint64_t rotated = index ? (occupied >> index) | (occupied << (WHEEL_SIZE - index)) : occupied;
+    return __builtin_ctzll(rotated);
+}
+
+
+void wheel_init(timer_wheel* w, uint32_t now) {
+    w->timers = NULL;
+    w->capacity = 0;
+    wheel_clear(w, now);
+}
+
+
+void wheel_free(timer_wheel* w) {
+    free(w->timers);
+    wheel_init(w, 0);
+}
+
+
+void wheel_clear(timer_wheel* w, uint32_t now) {
+    w->count = 0;
+    w->now = now;
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        for (uint32_t i = 0; i < WHEEL_SIZE; i++) {
+            w->heads[l][i] = WHEEL_INVALID;
+            w->tails[l][i] = WHEEL_INVALID;
+        }
+        w->occupied[l] = 0;
+    }
+
+    // Chain the whole pool into the free list, lowest ids first
+    w->free_list = WHEEL_INVALID;
+    for (uint32_t id = w->capacity; id-- > 0;) {
+        w->timers[id].slot = WHEEL_INVALID;
+        w->timers[id].next = w->free_list;
+        w->free_list = id;
+    }
+}
+
+
+uint32_t wheel_add(timer_wheel* w, uint32_t expiry, uint32_t data) {
+    if (expiry > w->now && expiry - w->now >= WHEEL_RANGE) {
+        return WHEEL_INVALID;
+    }
+
+    if (w->free_list == WHEEL_INVALID) {
+        uint32_t capacity = w->capacity ? w->capacity * 2 : 64;
+        wheel_timer* timers = realloc(w->timers, capacity * sizeof(wheel_timer));
+        if (!timers) {
+            return WHEEL_INVALID;
+        }
+        for (uint32_t id = capacity; id-- > w->capacity;) {
+            timers[id].slot = WHEEL_INVALID;
+            timers[id].next = w->free_list;
+            w->free_list = id;
+        }
+        w->timers = timers;
+        w->capacity = capacity;
+    }
+
+    uint32_t id = w->free_list;
+    w->free_list = w->timers[id].next;
+    w->timers[id].expiry = expiry;
+    w->timers[id].data = data;
+    w->count++;
+    link_timer(w, id);
+    return id;
+}
+
+
+void wheel_cancel(timer_wheel* w, uint32_t id) {
+    if (id >= w->capacity || w->timers[id].slot == WHEEL_INVALID) {
+        return;
+    }
+    unlink_timer(w, id);
+    release_timer(w, id);
+}
+
+
+size_t wheel_advance(timer_wheel* w, uint32_t now, wheel_fn fn, void* ctx) {
+    size_t expired = 0;
+
+    while (w->now <= now) {
+        uint32_t tick = w->now;
+
+        // Entering a new slot of a level moves its timers down, the highest level first
+        for (int l = WHEEL_LEVELS - 1; l > 0; l--) {
+            if (!(tick & ((1u << (WHEEL_BITS * l)) - 1))) {
+                cascade(w, l, (tick >> (WHEEL_BITS * l)) & (WHEEL_SIZE - 1));
+            }
+        }
+
+        // Timers added by the callback for this tick expire in the same loop
+        uint32_t index = tick & (WHEEL_SIZE - 1);
+        uint32_t id;
+        while ((id = w->heads[0][index]) != WHEEL_INVALID) {
+            wheel_timer t = w->timers[id];
+            unlink_timer(w, id);
+            release_timer(w, id);
+            fn(ctx, id, t.data, t.expiry);
+            expired++;
+        }
+
+        // Skip the empty ticks up to the next occupied slot, the next cascade or the target
+        uint32_t boundary = (tick | (WHEEL_SIZE - 1)) + 1;
+        int d = next_occupied(w->occupied[0], (index + 1) & (WHEEL_SIZE - 1));
+        uint32_t next = d < 0 || tick + 1 + (uint32_t)d > boundary ? boundary : tick + 1 + (uint32_t)d;
+        if (next > now || next < tick) {
+            w->now = now + 1;
+            break;
+        }
+        w->now = next;
+    }
+    return expired;
+}
+
+
+int64_t wheel_next(const timer_wheel* w) {
+    int64_t best = -1;
+
+    if (!w->count) {
+        return -1;
+    }
+
+    // Every slot holds a single round, so the first occupied slot of a level holds its earliest timers. The
+    // current slot of a level has already been moved down, unless the wheel stands right at its first tick.
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        uint32_t current = (w->now >> (WHEEL_BITS * l)) & (WHEEL_SIZE - 1);
+        int pending = !(w->now & ((1u << (WHEEL_BITS * l)) - 1));
+        uint32_t start = pending ? current : (current + 1) & (WHEEL_SIZE - 1);
+        int d = next_occupied(w->occupied[l], start);
+        if (d < 0) {
+            continue;
+        }
+
+        uint32_t index = (start + (uint32_t)d) & (WHEEL_SIZE - 1);
+        for (uint32_t id = w->heads[l][index]; id != WHEEL_INVALID; id = w->timers[id].next) {
+            int64_t tick = filed_tick(w, &w->timers[id]);
+            if (best < 0 || tick < best) {
+                best = tick;
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,110 @@
+#ifndef HEADER_WHEEL_H
+#define HEADER_WHEEL_H
+
+// Include any necessary headers here
+#include <stddef.h>
+#include <stdint.h>
+
+// Declare any constants here
+#define WHEEL_BITS      6                       ///< Number of bits of a tick resolved by one level
+#define WHEEL_SIZE      (1u << WHEEL_BITS)      ///< Number of slots per level
+#define WHEEL_LEVELS    4                       ///< Number of levels, covering 2^24 ticks (about 31 years of minutes)
+#define WHEEL_RANGE     (1u << (WHEEL_BITS * WHEEL_LEVELS)) ///< Timers have to expire less than this many ticks ahead
+#define WHEEL_INVALID   UINT32_MAX              ///< Id returned when a timer could not be added, also marks list ends
+
+// Define struct for a timer of the wheel
+typedef struct {
+    uint32_t expiry; ///< Tick at which the timer expires
+    uint32_t data; ///< Value handed back when the timer expires
+    uint32_t prev; ///< Previous timer in the slot, or WHEEL_INVALID for the first one
+    uint32_t next; ///< Next timer in the slot or in the free list, or WHEEL_INVALID for the last one
+    uint32_t slot; ///< Slot holding the timer (level * WHEEL_SIZE + index), or WHEEL_INVALID if it is free
+} wheel_timer;
+
+// Define struct for a hierarchical timer wheel
+typedef struct {
+    wheel_timer* timers; ///< Timer pool, timer ids are indexes into it
+    uint32_t capacity; ///< Number of timers the pool has room for
+    uint32_t count; ///< Number of pending timers
+    uint32_t free_list; ///< First free timer, or WHEEL_INVALID
+    uint32_t now; ///< First tick that has not been processed yet
+    uint32_t heads[WHEEL_LEVELS][WHEEL_SIZE]; ///< First timer of every slot, or WHEEL_INVALID
+    uint32_t tails[WHEEL_LEVELS][WHEEL_SIZE]; ///< Last timer of every slot, or WHEEL_INVALID
+    uint64_t occupied[WHEEL_LEVELS]; ///< Bit i of level l is set if slot i of that level holds a timer
+} timer_wheel;
+
+// Define the callback called for every expired timer, it may add and cancel timers
+typedef void (*wheel_fn)(void* ctx, uint32_t id, uint32_t data, uint32_t expiry);
+
+/**
+ * @brief Initializes an empty timer wheel
+ *
+ * @param[out] w Pointer to the wheel to initialize
+ * @param[in] now First tick that has not been processed yet
+ */
+void wheel_init(timer_wheel* w, uint32_t now); ///< Function for creating a timer wheel
+
+/**
+ * @brief Releases the memory held by a timer wheel
+ *
+ * @param[in,out] w Pointer to the wheel to free
+ */
+void wheel_free(timer_wheel* w); ///< Function for freeing a timer wheel
+
+/**
+ * @brief Cancels every timer and moves the wheel to a new tick, keeping the timer pool allocated
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] now First tick that has not been processed yet
+ */
+void wheel_clear(timer_wheel* w, uint32_t now); ///< Function for emptying a timer wheel
+
+/**
+ * @brief Adds a timer
+ *
+ * Overdue timers are filed under the first tick that has not been processed yet. Timers expiring at the
+ * same tick expire in the order they were added.
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] expiry Tick at which the timer expires, less than WHEEL_RANGE ticks ahead
+ * @param[in] data Value handed back when the timer expires
+ *
+ * @return Returns the id of the timer, or WHEEL_INVALID if it is too far ahead or memory could not be allocated
+ */
+uint32_t wheel_add(timer_wheel* w, uint32_t expiry, uint32_t data); ///< Function for adding a timer
+
+/**
+ * @brief Cancels a pending timer
+ *
+ * The id must belong to a pending timer, as the ids of expired and cancelled timers are reused.
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] id Id of the timer, WHEEL_INVALID is ignored
+ */
+void wheel_cancel(timer_wheel* w, uint32_t id); ///< Function for cancelling a timer
+
+/**
+ * @brief Expires every timer up to and including the given tick
+ *
+ * Timers expire in the order of their ticks. The call costs one step per 64 ticks crossed plus one per
+ * timer expired or moved down a level, independently of the number of timers that stay pending.
+ *
+ * @param[in,out] w Pointer to the wheel
+ * @param[in] now Last tick to process
+ * @param[in] fn Function called for every expired timer
+ * @param[in] ctx Value handed to fn
+ *
+ * @return Returns the number of timers that expired
+ */
+size_t wheel_advance(timer_wheel* w, uint32_t now, wheel_fn fn, void* ctx); ///< Function for expiring timers
+
+/**
+ * @brief Finds the tick of the earliest pending timer
+ *
+ * @param[in] w Pointer to the wheel
+ *
+ * @return Returns the tick, or -1 if no timer is pending
+ */
+int64_t wheel_next(const timer_wheel* w); ///< Function for finding the next expiry
+
+#endif /* HEADER_WHEEL_H */